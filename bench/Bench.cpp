@@ -0,0 +1,293 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Bench.h"
+#include "git/Config.h"
+#include "ui/MainWindow.h"
+#include <QFile>
+#include <QHash>
+#include <QProcess>
+
+namespace {
+
+// Fixed time of the first commit. Commits are one minute apart.
+const qint64 kTime = 1500000000;
+
+// Files per directory.
+const int kDirSize = 32;
+
+// Rename a file on master every so many commits.
+const int kRenameInterval = 50;
+
+const char *kWords[] = {
+  "alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta",
+  "index", "commit", "branch", "merge", "rebase", "status", "remote",
+  "fetch", "push", "tree", "blob", "tag", "diff", "patch", "hunk", "line",
+  "return", "if", "else", "for", "while", "switch", "case", "break",
+  "int", "bool", "void", "const", "static", "class", "struct", "enum",
+  "QString", "QList", "QMap", "QByteArray", "nullptr", "true", "false",
+  "{", "}", "(", ")", ";", "=", "==", "+", "-", "*", "/", "//", "0", "1"
+};
+
+const int kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+// A small deterministic generator (xorshift32). The standard
+// distributions aren't guaranteed to match across platforms.
+class Random
+{
+public:
+  Random(quint32 seed)
+    : mState(seed ? seed : 1)
+  {}
+
+  int bounded(int max)
+  {
+    mState ^= mState << 13;
+    mState ^= mState >> 17;
+    mState ^= mState << 5;
+    return (max > 0) ? mState % max : 0;
+  }
+
+private:
+  quint32 mState;
+};
+
+int env(const char *name, int defaultValue)
+{
+  bool ok = false;
+  int value = qEnvironmentVariableIntValue(name, &ok);
+  return ok ? value : defaultValue;
+}
+
+QByteArray line(Random &random)
+{
+  QByteArray result;
+  int count = 1 + random.bounded(12);
+  for (int i = 0; i < count; ++i) {
+    if (i > 0)
+      result.append(' ');
+    result.append(kWords[random.bounded(kWordCount)]);
+  }
+
+  return result.append('\n');
+}
+
+QByteArray content(Random &random, int size)
+{
+  // Vary the size between one half and three halves of the average.
+  int length = size / 2 + random.bounded(size + 1);
+
+  QByteArray result;
+  while (result.length() < length)
+    result.append(line(random));
+
+  return result;
+}
+
+// Replace a random line and append a new one.
+QByteArray modify(Random &random, const QByteArray &content)
+{
+  QList<QByteArray> lines = content.split('\n');
+  if (!lines.isEmpty() && lines.last().isEmpty())
+    lines.removeLast();
+
+  QByteArray replacement = line(random);
+  replacement.chop(1);
+  if (!lines.isEmpty())
+    lines[random.bounded(lines.size())] = replacement;
+
+  QByteArray next = line(random);
+  next.chop(1);
+  lines.append(next);
+
+  return lines.join('\n').append('\n');
+}
+
+QByteArray data(const QByteArray &bytes)
+{
+  return "data " + QByteArray::number(bytes.length()) + '\n' + bytes + '\n';
+}
+
+QByteArray commit(const QString &ref, int mark, int index)
+{
+  QByteArray time = QByteArray::number(kTime + index * 60) + " +0000";
+  QByteArray message = "Commit " + QByteArray::number(index) + "\n";
+  return "commit " + ref.toUtf8() + "\n"
+         "mark :" + QByteArray::number(mark) + "\n"
+         "author Bench <bench@example.com> " + time + "\n"
+         "committer Bench <bench@example.com> " + time + "\n" +
+         data(message);
+}
+
+} // anon. namespace
+
+namespace Bench {
+
+Options Options::fromEnvironment()
+{
+  Options options;
+  options.commits = qMax(1, env("BENCH_COMMITS", options.commits));
+  options.branches = qMax(0, env("BENCH_BRANCHES", options.branches));
+  options.files = qMax(1, env("BENCH_FILES", options.files));
+  options.fileSize = qMax(1, env("BENCH_FILE_SIZE", options.fileSize));
+  options.tags = qMax(0, env("BENCH_TAGS", options.tags));
+  options.changes = qMax(1, env("BENCH_CHANGES", options.changes));
+  options.seed = env("BENCH_SEED", options.seed);
+  return options;
+}
+
+SyntheticRepository::SyntheticRepository(const Options &options)
+  : mOptions(options)
+{
+  if (!mDir.isValid() || !exec({"init", "-q", mDir.path()}) || !generate())
+    return;
+
+  mRepo = git::Repository::open(mDir.path());
+}
+
+void SyntheticRepository::modify(int count)
+{
+  QDir dir = mRepo.workdir();
+  for (int i = 0; i < count && i < mPaths.size(); ++i) {
+    QFile file(dir.filePath(mPaths.at(i)));
+    if (file.open(QFile::Append))
+      file.write("modified\n");
+  }
+}
+
+SyntheticRepository::operator git::Repository()
+{
+  return mRepo;
+}
+
+git::Repository *SyntheticRepository::operator->()
+{
+  return &mRepo;
+}
+
+bool SyntheticRepository::generate()
+{
+  Random random(mOptions.seed);
+  QByteArray stream;
+
+  // The initial commit adds every file.
+  QHash<QString,QByteArray> contents;
+  stream.append(commit("refs/heads/master", 1, 0));
+  for (int i = 0; i < mOptions.files; ++i) {
+    QString path = QString("src/dir%1/file%2.txt").arg(i / kDirSize).arg(i);
+    QByteArray bytes = content(random, mOptions.fileSize);
+    stream.append("M 100644 inline " + path.toUtf8() + "\n" + data(bytes));
+    contents.insert(path, bytes);
+    mPaths.append(path);
+  }
+
+  stream.append('\n');
+
+  // Commits rotate between master and each topic branch. Topic
+  // branches fork from master and are periodically merged back.
+  int mark = 1;
+  QList<int> masterMarks = {mark};
+  QVector<int> tips(mOptions.branches + 1, 0);
+  QVector<int> merged(mOptions.branches + 1, 0);
+  tips[0] = mark;
+  for (int i = 1; i < mOptions.commits; ++i) {
+    int branch = i % (mOptions.branches + 1);
+    QString ref = branch ?
+      QString("refs/heads/topic%1").arg(branch) : "refs/heads/master";
+
+    stream.append(commit(ref, ++mark, i));
+    if (branch && !tips.at(branch)) {
+      stream.append("from :" + QByteArray::number(tips.at(0)) + "\n");
+    } else if (!branch && mOptions.branches) {
+      int topic = 1 + (i / (mOptions.branches + 1)) % mOptions.branches;
+      if (tips.at(topic) && tips.at(topic) != merged.at(topic)) {
+        stream.append("merge :" + QByteArray::number(tips.at(topic)) + "\n");
+        merged[topic] = tips.at(topic);
+      }
+    }
+
+    for (int j = 0; j < mOptions.changes; ++j) {
+      const QString &path = mPaths.at(random.bounded(mPaths.size()));
+      QByteArray bytes = ::modify(random, contents.value(path));
+      stream.append("M 100644 inline " + path.toUtf8() + "\n" + data(bytes));
+
+      // Only master contributes to the content of HEAD.
+      if (!branch)
+        contents.insert(path, bytes);
+    }
+
+    if (!branch && i % kRenameInterval == 0) {
+      int index = random.bounded(mPaths.size());
+      QString path = mPaths.at(index);
+      QString renamed = path;
+      renamed.replace(".txt", QString("-%1.txt").arg(i));
+      stream.append("R " + path.toUtf8() + " " + renamed.toUtf8() + "\n");
+      contents.insert(renamed, contents.take(path));
+      mPaths[index] = renamed;
+    }
+
+    stream.append('\n');
+
+    tips[branch] = mark;
+    if (!branch)
+      masterMarks.append(mark);
+  }
+
+  // Spread tags evenly over master.
+  int tags = qMin(mOptions.tags, masterMarks.size());
+  for (int i = 0; i < tags; ++i) {
+    int tagMark = masterMarks.at(i * masterMarks.size() / tags);
+    stream.append(QString("reset refs/tags/v%1\n").arg(i).toUtf8());
+    stream.append("from :" + QByteArray::number(tagMark) + "\n\n");
+  }
+
+  mPaths.sort();
+
+  return exec({"fast-import", "--quiet"}, stream) &&
+         exec({"symbolic-ref", "HEAD", "refs/heads/master"}) &&
+         exec({"reset", "-q", "--hard"});
+}
+
+bool SyntheticRepository::exec(
+  const QStringList &args,
+  const QByteArray &input)
+{
+  QProcess process;
+  process.setWorkingDirectory(mDir.path());
+  process.start("git", args);
+  if (!process.waitForStarted())
+    return false;
+
+  process.write(input);
+  process.closeWriteChannel();
+  if (!process.waitForFinished(-1))
+    return false;
+
+  if (process.exitStatus() != QProcess::NormalExit || process.exitCode()) {
+    qWarning() << "git" << args << process.readAllStandardError();
+    return false;
+  }
+
+  return true;
+}
+
+MainWindow *openWindow(const git::Repository &repo)
+{
+  // Keep the indexer and automatic fetch from competing for time.
+  git::Config config = repo.appConfig();
+  config.setValue("index.enable", false);
+  config.setValue("autofetch.enable", false);
+
+  MainWindow *window = new MainWindow(repo);
+  window->show();
+  QTest::qWaitForWindowExposed(window);
+  return window;
+}
+
+} // namespace Bench
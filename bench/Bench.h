@@ -0,0 +1,84 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "app/Application.h"
+#include "git/Repository.h"
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+#define BENCH_MAIN(BenchClass) \
+int main(int argc, char *argv[]) \
+{ \
+  Application app(argc, argv); \
+  BenchClass bench; \
+  QTEST_SET_MAIN_SOURCE_PATH \
+  return QTest::qExec(&bench, app.arguments()); \
+}
+
+class MainWindow;
+
+namespace Bench {
+
+// The shape of the generated repository. Each value can be overridden
+// by the corresponding environment variable: BENCH_COMMITS,
+// BENCH_BRANCHES, BENCH_FILES, BENCH_FILE_SIZE, BENCH_TAGS,
+// BENCH_CHANGES and BENCH_SEED.
+struct Options
+{
+  int commits = 2000;  // total number of commits
+  int branches = 4;    // topic branches merged back into master
+  int files = 2000;    // files in the initial commit
+  int fileSize = 2048; // average file size in bytes
+  int tags = 20;       // tags spread evenly over master
+  int changes = 8;     // files modified by each commit
+  quint32 seed = 1;
+
+  static Options fromEnvironment();
+};
+
+// A synthetic repository generated with git fast-import. The same
+// options and seed always produce the same commits.
+class SyntheticRepository
+{
+public:
+  SyntheticRepository(const Options &options = Options::fromEnvironment());
+
+  bool isValid() const { return mRepo.isValid(); }
+  const Options &options() const { return mOptions; }
+
+  // Get the tracked file paths in HEAD.
+  const QStringList &paths() const { return mPaths; }
+
+  // Modify the given number of tracked files in the workdir.
+  void modify(int count);
+
+  // Treat this class a wrapper.
+  operator git::Repository();
+  git::Repository *operator->();
+
+private:
+  bool generate();
+  bool exec(const QStringList &args, const QByteArray &input = QByteArray());
+
+  QTemporaryDir mDir;
+  Options mOptions;
+  QStringList mPaths;
+  git::Repository mRepo;
+};
+
+// Open a window on the repository with background tasks disabled.
+MainWindow *openWindow(const git::Repository &repo);
+
+} // namespace Bench
+
+#endif
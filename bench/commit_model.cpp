@@ -0,0 +1,77 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Bench.h"
+#include "git/Reference.h"
+#include "ui/CommitList.h"
+#include "ui/MainWindow.h"
+#include "ui/RepoView.h"
+
+using namespace Bench;
+
+class BenchCommitModel : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void firstPage();
+  void allCommits();
+  void cleanupTestCase();
+
+private:
+  SyntheticRepository mRepo;
+  MainWindow *mWindow = nullptr;
+  CommitList *mCommits = nullptr;
+};
+
+void BenchCommitModel::initTestCase()
+{
+  QVERIFY(mRepo.isValid());
+
+  mWindow = openWindow(mRepo);
+  mCommits = mWindow->currentView()->findChild<CommitList *>();
+  QVERIFY(mCommits);
+}
+
+void BenchCommitModel::firstPage()
+{
+  // Reset the walker and load the first batch of rows.
+  git::Reference head = mRepo->head();
+  QBENCHMARK {
+    mCommits->setReference(head);
+  }
+
+  QVERIFY(mCommits->model()->rowCount() > 0);
+}
+
+void BenchCommitModel::allCommits()
+{
+  int rows = 0;
+  git::Reference head = mRepo->head();
+  QAbstractItemModel *model = mCommits->model();
+  QBENCHMARK {
+    mCommits->setReference(head);
+    while (model->canFetchMore(QModelIndex()))
+      model->fetchMore(QModelIndex());
+    rows = model->rowCount();
+  }
+
+  // Every commit is reachable from some ref.
+  QVERIFY(rows >= mRepo.options().commits);
+}
+
+void BenchCommitModel::cleanupTestCase()
+{
+  mWindow->close();
+}
+
+BENCH_MAIN(BenchCommitModel)
+
+#include "commit_model.moc"
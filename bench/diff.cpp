@@ -0,0 +1,64 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Bench.h"
+#include "git/Commit.h"
+#include "git/Diff.h"
+#include "git/Reference.h"
+#include "git/RevWalk.h"
+
+using namespace Bench;
+
+class BenchDiff : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void treeToTree();
+  void findSimilar();
+
+private:
+  SyntheticRepository mRepo;
+  git::Commit mRoot;
+  git::Commit mHead;
+};
+
+void BenchDiff::initTestCase()
+{
+  QVERIFY(mRepo.isValid());
+
+  // Compare the whole history. The generator renames
+  // files periodically so there's something to find.
+  git::Reference head = mRepo->head();
+  mHead = head.target();
+  mRoot = head.walker(GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE).next();
+  QVERIFY(mHead.isValid() && mRoot.isValid());
+}
+
+void BenchDiff::treeToTree()
+{
+  QBENCHMARK {
+    QVERIFY(mHead.diff(mRoot).isValid());
+  }
+}
+
+void BenchDiff::findSimilar()
+{
+  // Each iteration needs a fresh diff. Subtract
+  // treeToTree to get the cost of rename detection.
+  QBENCHMARK {
+    git::Diff diff = mHead.diff(mRoot);
+    diff.findSimilar();
+  }
+}
+
+BENCH_MAIN(BenchDiff)
+
+#include "diff.moc"
@@ -0,0 +1,91 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Bench.h"
+#include "git/Commit.h"
+#include "git/Diff.h"
+#include "git/Reference.h"
+#include "git/RevWalk.h"
+#include "ui/DiffView.h"
+#include "ui/MainWindow.h"
+#include "ui/RepoView.h"
+
+using namespace Bench;
+
+namespace {
+
+// Limit the number of files in the large diff.
+const int kMaxFiles = 200;
+
+} // anon. namespace
+
+class BenchDiffView : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void firstPage();
+  void allFiles();
+  void cleanupTestCase();
+
+private:
+  SyntheticRepository mRepo;
+  MainWindow *mWindow = nullptr;
+  DiffView *mView = nullptr;
+  git::Diff mDiff;
+};
+
+void BenchDiffView::initTestCase()
+{
+  QVERIFY(mRepo.isValid());
+
+  mWindow = openWindow(mRepo);
+  mView = mWindow->currentView()->findChild<DiffView *>();
+  QVERIFY(mView);
+
+  // Find an ancestor far enough back to change many files.
+  git::Reference head = mRepo->head();
+  git::RevWalk walker = head.walker(GIT_SORT_TOPOLOGICAL);
+  git::Commit base = walker.next();
+  while (base.isValid()) {
+    mDiff = head.target().diff(base);
+    if (mDiff.count() >= kMaxFiles)
+      break;
+
+    base = walker.next();
+  }
+
+  QVERIFY(mDiff.isValid() && mDiff.count() > 0);
+}
+
+void BenchDiffView::firstPage()
+{
+  QBENCHMARK {
+    mView->setDiff(mDiff);
+  }
+}
+
+void BenchDiffView::allFiles()
+{
+  QBENCHMARK {
+    mView->setDiff(mDiff);
+    QVERIFY(mView->file(mDiff.count() - 1));
+  }
+}
+
+void BenchDiffView::cleanupTestCase()
+{
+  mView->setDiff(git::Diff());
+  mWindow->close();
+}
+
+BENCH_MAIN(BenchDiffView)
+
+#include "diff_view.moc"
@@ -0,0 +1,115 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Bench.h"
+#include "git/Commit.h"
+#include "git/Diff.h"
+#include "git/Reference.h"
+#include "git/RevWalk.h"
+#include "index/Index.h"
+
+using namespace Bench;
+
+class BenchIndex : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void write();
+  void postings();
+  void positional();
+  void query();
+
+private:
+  SyntheticRepository mRepo;
+  Index::IdList mIds;
+  Index::PostingMap mPostings;
+  Index *mIndex = nullptr;
+};
+
+void BenchIndex::initTestCase()
+{
+  QVERIFY(mRepo.isValid());
+
+  // Build postings from messages and changed paths in the
+  // same shape that the indexer produces (one id per commit).
+  git::RevWalk walker = mRepo->head().walker();
+  git::Commit commit = walker.next();
+  while (commit.isValid()) {
+    QMap<quint8,QHash<QByteArray,QVector<quint32>>> fields;
+
+    quint32 pos = 0;
+    QString message = commit.message().toLower();
+    foreach (const QString &word, message.split(' ', Qt::SkipEmptyParts))
+      fields[Index::Message][word.toUtf8()].append(pos++);
+
+    quint32 filePos = 0;
+    git::Diff diff = commit.diff();
+    for (int i = 0; i < diff.count(); ++i) {
+      QFileInfo info(diff.name(i).toLower());
+      fields[Index::Path][info.filePath().toUtf8()].append(filePos);
+      fields[Index::File][info.fileName().toUtf8()].append(filePos++);
+    }
+
+    quint32 id = mIds.size();
+    mIds.append(commit.id());
+
+    auto end = fields.constEnd();
+    for (auto it = fields.constBegin(); it != end; ++it) {
+      auto termEnd = it.value().constEnd();
+      for (auto termIt = it.value().constBegin(); termIt != termEnd; ++termIt)
+        mPostings[termIt.key()].append({id, it.key(), termIt.value()});
+    }
+
+    commit = walker.next();
+  }
+
+  mIndex = new Index(mRepo, this);
+}
+
+void BenchIndex::write()
+{
+  QBENCHMARK {
+    // Start from an empty index.
+    mIndex->remove();
+    mIndex->ids() = mIds;
+    QVERIFY(mIndex->write(mPostings));
+  }
+
+  mIndex->reset();
+  QVERIFY(mIndex->isValid());
+}
+
+void BenchIndex::postings()
+{
+  Index::Term term(Index::Message, "commit");
+  QBENCHMARK {
+    QCOMPARE(mIndex->postings(term).size(), mIds.size());
+  }
+}
+
+void BenchIndex::positional()
+{
+  Index::Term term(Index::Message, "commit");
+  QBENCHMARK {
+    QCOMPARE(mIndex->postings(term, true).size(), mIds.size());
+  }
+}
+
+void BenchIndex::query()
+{
+  QBENCHMARK {
+    QVERIFY(!mIndex->commits("message:commit file:file1.txt").isEmpty());
+  }
+}
+
+BENCH_MAIN(BenchIndex)
+
+#include "index.moc"
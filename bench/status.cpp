@@ -0,0 +1,94 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Bench.h"
+#include "git/Diff.h"
+#include "git/Index.h"
+
+using namespace Bench;
+
+namespace {
+
+const int kModifiedCount = 100;
+
+} // anon. namespace
+
+class BenchStatus : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void clean();
+  void dirty();
+  void cached();
+  void paths();
+
+private:
+  SyntheticRepository mRepo;
+  int mModified = 0;
+};
+
+void BenchStatus::initTestCase()
+{
+  QVERIFY(mRepo.isValid());
+  mModified = qMin(kModifiedCount, mRepo.paths().size());
+}
+
+void BenchStatus::clean()
+{
+  git::Repository repo = mRepo;
+  QBENCHMARK {
+    repo.invalidateStatusCache();
+    git::Diff status = repo.status(repo.index(), nullptr);
+    QVERIFY(status.isValid());
+    QCOMPARE(status.count(), 0);
+  }
+}
+
+void BenchStatus::dirty()
+{
+  mRepo.modify(mModified);
+
+  git::Repository repo = mRepo;
+  QBENCHMARK {
+    repo.invalidateStatusCache();
+    git::Diff status = repo.status(repo.index(), nullptr);
+    QCOMPARE(status.count(), mModified);
+  }
+}
+
+void BenchStatus::cached()
+{
+  // Prime the status cache.
+  git::Repository repo = mRepo;
+  repo.invalidateStatusCache();
+  repo.status(repo.index(), nullptr);
+
+  QBENCHMARK {
+    git::Diff status = repo.status(repo.index(), nullptr);
+    QCOMPARE(status.count(), mModified);
+  }
+}
+
+void BenchStatus::paths()
+{
+  // Scan only the modified paths.
+  QStringList paths = mRepo.paths().mid(0, mModified);
+
+  git::Repository repo = mRepo;
+  QBENCHMARK {
+    git::Diff status = repo.status(repo.index(), nullptr, false, paths);
+    QCOMPARE(status.count(), mModified);
+  }
+}
+
+BENCH_MAIN(BenchStatus)
+
+#include "status.moc"
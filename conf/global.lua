@@ -3,10 +3,23 @@ return {
     enable = true,
     minutes = 10
   },
+  fetch = {
+    jobs = 4
+  },
   autopush = {
     enable = false
   },
   autoupdate = {
     enable = false
+  },
+  background = {
+    jobs = 2
+  },
+  hibernate = {
+    enable = true,
+    minutes = 5
+  },
+  submodule = {
+    jobs = 4
   }
 }
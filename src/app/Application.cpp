@@ -14,6 +14,7 @@
 #include "ui/MainWindow.h"
 #include "ui/MenuBar.h"
 #include "ui/RepoView.h"
+#include "ui/Scheduler.h"
 #include "ui/TabWidget.h"
 #include "update/Updater.h"
 #include <QCloseEvent>
@@ -124,6 +125,7 @@ Application::Application(int &argc, char **argv, bool haltOnParseError)
 
   // Register types that are queued at runtime.
   qRegisterMetaType<git::Id>();
+  qRegisterMetaType<git::Reference>();
 
   // Connect updater signals.
   connect(Updater::instance(), &Updater::sslErrors,
@@ -233,6 +235,19 @@ Application::Application(int &argc, char **argv, bool haltOnParseError)
   // Initialize git library.
   git::Repository::init();
 
+  // Cache prefetched blobs for every repository. This is set once at
+  // startup because libgit2 shares the object cache limits globally.
+  git::Repository::enablePrefetchCache();
+
+  // Run low priority repository work with the other bulk tasks.
+  git::Repository::setBackgroundRunner(
+  [](const git::Repository &repo, const std::function<void()> &work) {
+    Scheduler::instance()->run(Scheduler::Bulk, repo, [work] {
+      work();
+      return true;
+    });
+  });
+
   connect(this, &Application::aboutToQuit, [this] {
     // Clean up git library.
     // Make sure windows are really deleted.
@@ -25,22 +25,20 @@ namespace {
 const QString kIgnoreWsKey = "diff/whitespace/ignore";
 const QString kLastPathKey = "lastpath";
 
-// Look up variant at key relative to root.
-QVariant lookup(const QVariantMap &root, const QString &key)
-{
-  QStringList list = key.split("/", QString::SkipEmptyParts);
-  if (list.isEmpty())
-    return root;
-
-  QVariantMap map = root;
-  while (map.contains(list.first())) {
-    QVariant result = map.value(list.takeFirst());
-    if (list.isEmpty())
-      return result;
-    map = result.toMap();
+// Add every nested value to the flat map by its full key.
+void flatten(
+  const QVariantMap &map,
+  const QString &prefix,
+  QHash<QString,QVariant> &result)
+{
+  QVariantMap::const_iterator it = map.constBegin();
+  QVariantMap::const_iterator end = map.constEnd();
+  for (; it != end; ++it) {
+    QString key = prefix.isEmpty() ? it.key() : prefix + '/' + it.key();
+    result.insert(key, it.value());
+    if (it.value().type() == QVariant::Map)
+      flatten(it.value().toMap(), key, result);
   }
-
-  return QVariant();
 }
 
 QString promptKey(Settings::PromptKind kind)
@@ -94,61 +92,77 @@ Settings::Settings(QObject *parent)
   foreach (const QFileInfo &file, confDir().entryInfoList(QStringList("*.lua")))
     mDefaults[file.baseName()] = ConfFile(file.absoluteFilePath()).parse();
   mDefaults[kLastPathKey] = QDir::homePath();
-  mCurrentMap = mDefaults;
+  flatten(mDefaults, QString(), mFlatDefaults);
+
+  // Load stored values once.
+  QSettings settings;
+  Values *values = new Values;
+  foreach (const QString &key, settings.allKeys())
+    values->insert(key, settings.value(key));
+  mValues.reset(values);
 }
 
 QString Settings::group() const
 {
-  return mGroup.join("/");
+  return mGroup.hasLocalData() ? mGroup.localData().join("/") : QString();
 }
 
 void Settings::beginGroup(const QString &prefix)
 {
-  mGroup.append(prefix);
-  mCurrentMap = lookup(mDefaults, group()).toMap();
+  mGroup.localData().append(prefix);
 }
 
 void Settings::endGroup()
 {
-  mGroup.removeLast();
-  mCurrentMap = lookup(mDefaults, group()).toMap();
+  mGroup.localData().removeLast();
 }
 
 QVariant Settings::value(const QString &key) const
 {
-  return value(key, defaultValue(key));
+  QString fullKey = this->fullKey(key);
+  std::shared_ptr<const Values> values = std::atomic_load(&mValues);
+  Values::const_iterator it = values->constFind(fullKey);
+  return (it != values->constEnd()) ? it.value() : mFlatDefaults.value(fullKey);
 }
 
 QVariant Settings::value(const QString &key, const QVariant &defaultValue) const
 {
-  QSettings settings;
-  settings.beginGroup(group());
-  QVariant result = settings.value(key, defaultValue);
-  settings.endGroup();
-  return result;
+  std::shared_ptr<const Values> values = std::atomic_load(&mValues);
+  return values->value(fullKey(key), defaultValue);
 }
 
 QVariant Settings::defaultValue(const QString &key) const
 {
-  return lookup(mCurrentMap, key);
+  return mFlatDefaults.value(fullKey(key));
 }
 
 void Settings::setValue(const QString &key, const QVariant &value, bool refresh)
 {
+  QString fullKey = this->fullKey(key);
+
+  QMutexLocker locker(&mMutex);
+  std::shared_ptr<Values> values =
+    std::make_shared<Values>(*std::atomic_load(&mValues));
+
   QSettings settings;
-  settings.beginGroup(group());
-  if (value == defaultValue(key)) {
-    if (settings.contains(key)) {
-      settings.remove(key);
-      emit settingsChanged(refresh);
-    }
+  if (value == mFlatDefaults.value(fullKey)) {
+    if (!values->remove(fullKey))
+      return;
+
+    settings.remove(fullKey);
   } else {
-    if (value != settings.value(key)) {
-      settings.setValue(key, value);
-      emit settingsChanged(refresh);
-    }
+    if (value == values->value(fullKey))
+      return;
+
+    values->insert(fullKey, value);
+    settings.setValue(fullKey, value);
   }
-  settings.endGroup();
+
+  std::atomic_store(&mValues, std::shared_ptr<const Values>(values));
+  locker.unlock();
+
+  emit valueChanged(fullKey, value);
+  emit settingsChanged(refresh);
 }
 
 QString Settings::lexer(const QString &filename)
@@ -328,6 +342,12 @@ QDir Settings::tempDir()
   return dir;
 }
 
+QString Settings::fullKey(const QString &key) const
+{
+  QString group = this->group();
+  return group.isEmpty() ? key : group + '/' + key;
+}
+
 Settings *Settings::instance()
 {
   static Settings *instance = nullptr;
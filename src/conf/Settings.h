@@ -11,8 +11,12 @@
 #define SETTINGS_H
 
 #include <QDir>
+#include <QHash>
+#include <QMutex>
 #include <QString>
+#include <QThreadStorage>
 #include <QVariant>
+#include <memory>
 
 class Settings : public QObject
 {
@@ -35,15 +39,22 @@ public:
   const QString SORT_ROLE      = "sort/role";
   const QString SORT_STAGED    = "sort/staged";
 
+  // Groups are tracked per thread.
   QString group() const;
   void beginGroup(const QString &prefix);
   void endGroup();
 
+  // Values are read from memory and can be read from any thread.
+  // Writes go through to QSettings.
   QVariant value(const QString &key) const;
   QVariant value(const QString &key, const QVariant &defaultValue) const;
   QVariant defaultValue(const QString &key) const;
   void setValue(const QString &key, const QVariant &value, bool refresh = false);
 
+  // Convert the value, or the default, to the given type.
+  template <typename T>
+  T value(const QString &key) const { return value(key).value<T>(); }
+
   // Look up lexer name by file name.
   QString lexer(const QString &filename);
   QString kind(const QString &filename);
@@ -80,12 +91,26 @@ public:
 signals:
   void settingsChanged(bool refresh = false);
 
+  // The key includes the group.
+  void valueChanged(const QString &key, const QVariant &value);
+
 private:
+  using Values = QHash<QString,QVariant>;
+
   Settings(QObject *parent = nullptr);
 
-  QStringList mGroup;
+  QString fullKey(const QString &key) const;
+
+  QThreadStorage<QStringList> mGroup;
   QVariantMap mDefaults;
-  QVariantMap mCurrentMap;
+
+  // Defaults by full key. Read-only after construction.
+  Values mFlatDefaults;
+
+  // Values stored in QSettings. Readers load the current snapshot
+  // atomically. Writers replace it while holding the mutex.
+  std::shared_ptr<const Values> mValues;
+  QMutex mMutex;
 };
 
 #endif
@@ -9,6 +9,7 @@
 
 #include "BranchTableModel.h"
 #include "git/Branch.h"
+#include "ui/ReferenceView.h"
 #include <QWidget>
 
 BranchTableModel::BranchTableModel(const git::Repository &repo, QObject *parent)
@@ -23,6 +24,13 @@ BranchTableModel::BranchTableModel(const git::Repository &repo, QObject *parent)
           this, &BranchTableModel::beginResetModel);
   connect(notifier, &git::RepositoryNotifier::referenceRemoved,
           this, &BranchTableModel::endResetModel);
+
+  // Update upstream tool tips.
+  connect(notifier, &git::RepositoryNotifier::conflictsPredicted, this, [this] {
+    int rows = rowCount();
+    if (rows > 0)
+      emit dataChanged(index(0, Upstream), index(rows - 1, Upstream));
+  });
 }
 
 int BranchTableModel::rowCount(const QModelIndex &parent) const
@@ -54,6 +62,20 @@ QVariant BranchTableModel::data(const QModelIndex &index, int role) const
           return QVariant();
       }
 
+    case Qt::ToolTipRole: {
+      git::Branch upstream = branch.upstream();
+      if (index.column() != Upstream || !upstream.isValid())
+        return QVariant();
+
+      // Predict conflicts from merging the upstream.
+      QStringList paths;
+      git::Commit target = branch.target();
+      if (!mRepo.predictConflicts(target, upstream.target(), &paths))
+        return QVariant();
+
+      return ReferenceView::conflictText(paths);
+    }
+
     case Qt::FontRole: {
       QFont font = static_cast<QWidget *>(QObject::parent())->font();
       font.setBold(index.column() == Name && branch.isHead());
@@ -56,6 +56,11 @@ MergeDialog::MergeDialog(
 
   QLabel *label = new QLabel(labelText(), this);
 
+  // Show conflicts predicted in the background.
+  mConflicts = new QLabel(this);
+  connect(repo.notifier(), &git::RepositoryNotifier::conflictsPredicted,
+          this, &MergeDialog::update);
+
   QCheckBox *noCommit = new QCheckBox(tr("No commit"), this);
   noCommit->setChecked(!Settings::instance()->value(kCommitKey).toBool());
   connect(noCommit, &QCheckBox::toggled, [](bool checked) {
@@ -80,6 +85,7 @@ MergeDialog::MergeDialog(
   form->addRow(label);
   form->addRow(tr("Reference:"), mRefs);
   form->addRow(tr("Action:"), mAction);
+  form->addRow(tr("Conflicts:"), mConflicts);
   form->addRow(QString(), noCommit);
 
   QDialogButtonBox *buttons = new QDialogButtonBox(this);
@@ -128,7 +134,25 @@ void MergeDialog::setReference(const git::Reference &ref)
 
 void MergeDialog::update()
 {
-  mAccept->setEnabled(mRefs->target().isValid());
+  git::Commit target = mRefs->target();
+  mAccept->setEnabled(target.isValid());
+
+  git::Reference head = mRepo.head();
+  if (!target.isValid() || !head.isValid()) {
+    mConflicts->setText(QString());
+    mConflicts->setToolTip(QString());
+    return;
+  }
+
+  QStringList paths;
+  if (!mRepo.predictConflicts(head.target(), target, &paths)) {
+    mConflicts->setText(tr("Checking..."));
+    mConflicts->setToolTip(QString());
+    return;
+  }
+
+  mConflicts->setText(ReferenceView::conflictText(paths));
+  mConflicts->setToolTip(paths.join('\n'));
 }
 
 QString MergeDialog::labelText() const
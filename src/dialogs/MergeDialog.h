@@ -16,6 +16,7 @@
 
 class ReferenceList;
 class QComboBox;
+class QLabel;
 class QPushButton;
 
 namespace git {
@@ -48,6 +49,7 @@ private:
   QPushButton *mAccept;
   ReferenceList *mRefs;
   QComboBox *mAction;
+  QLabel *mConflicts;
 };
 
 #endif
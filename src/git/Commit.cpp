@@ -11,6 +11,7 @@
 #include "Diff.h"
 #include "Patch.h"
 #include "Reference.h"
+#include "ReferenceSnapshot.h"
 #include "Repository.h"
 #include "RevWalk.h"
 #include "Signature.h"
@@ -18,7 +19,6 @@
 #include "Tree.h"
 #include "git2/annotated_commit.h"
 #include "git2/diff.h"
-#include "git2/refs.h"
 #include "git2/revert.h"
 #include <QDateTime>
 #include <QJsonArray>
@@ -195,26 +195,8 @@ QList<Reference> Commit::refs() const
       refs.append(head);
   }
 
-  // Iterate over references.
-  git_reference_iterator *it = nullptr;
-  if (git_reference_iterator_new(&it, repo))
-    return QList<Reference>();
-
-  git_reference *ref = nullptr;
-  const git_oid *id = git_object_id(d.data());
-  while (!git_reference_next(&ref, it)) {
-    git_object *obj = nullptr;
-    if (!git_reference_peel(&obj, ref, GIT_OBJECT_COMMIT) &&
-        git_oid_equal(git_object_id(obj), id)) {
-      refs.append(Reference(ref));
-    } else {
-      git_reference_free(ref);
-    }
-
-    git_object_free(obj);
-  }
-
-  git_reference_iterator_free(it);
+  // Look up references by target.
+  refs.append(repo.refSnapshot().refs(id()));
 
   return refs;
 }
@@ -265,32 +247,7 @@ bool Commit::revert() const
 
 bool Commit::reset(git_reset_t type, const QStringList &paths) const
 {
-  QVector<char *> rawPaths;
-  QVector<QByteArray> storage;
-  git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
-  if (!paths.isEmpty()) {
-    // Paths are assumed to be exact matches.
-    opts.checkout_strategy |= GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH;
-
-    foreach (const QString &path, paths) {
-      storage.append(path.toUtf8());
-      rawPaths.append(storage.last().data());
-    }
-
-    opts.paths.count = rawPaths.size();
-    opts.paths.strings = rawPaths.data();
-  }
-
-  Repository repo = this->repo();
-  int state = repo.state();
-  int error = git_reset(repo, d.data(), type, &opts);
-  emit repo.notifier()->referenceUpdated(repo.head());
-  if (repo.state() != state) {
-    Patch::clearConflictResolutions(repo);
-    emit repo.notifier()->stateChanged();
-  }
-
-  return !error;
+  return repo().reset(*this, type, paths);
 }
 
 bool Commit::isStarred() const
@@ -62,10 +62,51 @@ Config::Entry Config::Iterator::next() const
   return Entry(entry);
 }
 
+QMutex Config::sWritesMutex;
+QHash<QString,int> Config::sWrites;
+QAtomicInt Config::sGeneration;
+
 Config::Config(git_config *config)
   : d(config, git_config_free)
 {}
 
+git_config *Config::reader() const
+{
+  bool current = (mSnapshot && mGeneration == sGeneration.loadAcquire());
+  return current ? mSnapshot.data() : d.data();
+}
+
+void Config::setSnapshot(git_config *snapshot, int generation)
+{
+  mSnapshot.reset(snapshot, git_config_free);
+  mGeneration = generation;
+}
+
+void Config::clearSnapshot()
+{
+  mSnapshot.clear();
+  if (!mPath.isEmpty()) {
+    QMutexLocker locker(&sWritesMutex);
+    ++sWrites[mPath];
+  }
+
+  sGeneration.fetchAndAddOrdered(1);
+}
+
+void Config::expireSnapshots()
+{
+  sGeneration.fetchAndAddOrdered(1);
+}
+
+int Config::writes(const QStringList &paths)
+{
+  int writes = 0;
+  QMutexLocker locker(&sWritesMutex);
+  foreach (const QString &path, paths)
+    writes += sWrites.value(path);
+  return writes;
+}
+
 bool Config::addFile(
   const QString &path,
   git_config_level_t level,
@@ -73,20 +114,31 @@ bool Config::addFile(
 {
   git_repository *ptr =
     repo.isValid() ? static_cast<git_repository *>(repo) : nullptr;
-  return !git_config_add_file_ondisk(d.data(), path.toUtf8(), level, ptr, false);
+  mSnapshot.clear();
+  if (git_config_add_file_ondisk(d.data(), path.toUtf8(), level, ptr, false))
+    return false;
+
+  // Writes go to the file with the highest level.
+  if (level > mLevel) {
+    mPath = path;
+    mLevel = level;
+  }
+
+  return true;
 }
 
 template <>
 bool Config::value<bool>(const QString &key, const bool &defaultValue) const
 {
   int value = defaultValue;
-  git_config_get_bool(&value, d.data(), key.toUtf8());
+  git_config_get_bool(&value, reader(), key.toUtf8());
   return value;
 }
 
 template <>
 void Config::setValue<bool>(const QString &key, const bool &value)
 {
+  clearSnapshot();
   git_config_set_bool(d.data(), key.toUtf8(), value);
 }
 
@@ -94,13 +146,14 @@ template <>
 int Config::value<int>(const QString &key, const int &defaultValue) const
 {
   int value = defaultValue;
-  git_config_get_int32(&value, d.data(), key.toUtf8());
+  git_config_get_int32(&value, reader(), key.toUtf8());
   return value;
 }
 
 template <>
 void Config::setValue<int>(const QString &key, const int &value)
 {
+  clearSnapshot();
   git_config_set_int32(d.data(), key.toUtf8(), value);
 }
 
@@ -110,7 +163,7 @@ QString Config::value<QString>(
   const QString &defaultValue) const
 {
   git_buf buf = GIT_BUF_INIT_CONST(nullptr, 0);
-  git_config_get_string_buf(&buf, d.data(), key.toUtf8());
+  git_config_get_string_buf(&buf, reader(), key.toUtf8());
   QString value = QString::fromUtf8(buf.ptr, buf.size);
   git_buf_dispose(&buf);
   return !value.isEmpty() ? value : defaultValue;
@@ -119,18 +172,20 @@ QString Config::value<QString>(
 template <>
 void Config::setValue<QString>(const QString &key, const QString &value)
 {
+  clearSnapshot();
   git_config_set_string(d.data(), key.toUtf8(), value.toUtf8());
 }
 
 bool Config::remove(const QString &key)
 {
+  clearSnapshot();
   return !git_config_delete_entry(d.data(), key.toUtf8());
 }
 
 Config::Iterator Config::glob(const QString &pattern) const
 {
   git_config_iterator *iterator = nullptr;
-  git_config_iterator_glob_new(&iterator, d.data(), pattern.toUtf8());
+  git_config_iterator_glob_new(&iterator, reader(), pattern.toUtf8());
   return Iterator(iterator);
 }
 
@@ -165,6 +220,21 @@ Config Config::appGlobal()
   if (git_config_new(&config))
     return Config();
 
+  QString path = appGlobalPath();
+  if (git_config_add_file_ondisk(
+        config, path.toUtf8(), GIT_CONFIG_LEVEL_GLOBAL, nullptr, 0)) {
+    git_config_free(config);
+    return Config();
+  }
+
+  Config result(config);
+  result.mPath = path;
+  result.mLevel = GIT_CONFIG_LEVEL_GLOBAL;
+  return result;
+}
+
+QString Config::appGlobalPath()
+{
   QDir dir =
     QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
 
@@ -172,21 +242,18 @@ Config Config::appGlobal()
   if (!dir.exists())
     dir.mkpath(dir.path());
 
-  QByteArray path = dir.filePath(kConfigFile).toUtf8();
-  if (git_config_add_file_ondisk(
-        config, path, GIT_CONFIG_LEVEL_GLOBAL, nullptr, 0)) {
-    git_config_free(config);
-    return Config();
-  }
-
-  return Config(config);
+  return dir.filePath(kConfigFile);
 }
 
 Config Config::open(const QString &path)
 {
   git_config *config = nullptr;
   git_config_open_ondisk(&config, path.toUtf8());
-  return Config(config);
+
+  Config result(config);
+  result.mPath = path;
+  result.mLevel = GIT_CONFIG_LEVEL_LOCAL;
+  return result;
 }
 
 } // namespace git
@@ -12,6 +12,9 @@
 
 #include "Repository.h"
 #include "git2/config.h"
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
 #include <QSharedPointer>
 
 namespace git {
@@ -76,13 +79,39 @@ public:
   static QString globalPath();
 
   static Config appGlobal();
+  static QString appGlobalPath();
 
   static Config open(const QString &path);
 
 private:
   Config(git_config *config = nullptr);
 
+  // Reads go to the snapshot until the generation changes. After
+  // that, copies that still hold it read the live config instead.
+  git_config *reader() const;
+  void setSnapshot(git_config *snapshot, int generation);
+  void clearSnapshot();
+
+  // Expire every snapshot without a write.
+  static void expireSnapshots();
+
+  // The number of writes through any config to any of the files.
+  static int writes(const QStringList &paths);
+
   QSharedPointer<git_config> d;
+  QSharedPointer<git_config> mSnapshot;
+  int mGeneration = -1;
+
+  // The file that writes go to, if it's known.
+  QString mPath;
+  git_config_level_t mLevel = GIT_CONFIG_LEVEL_PROGRAMDATA;
+
+  // Writes are counted by the file that they went to.
+  static QMutex sWritesMutex;
+  static QHash<QString,int> sWrites;
+
+  // Incremented by every write and every expiration.
+  static QAtomicInt sGeneration;
 
   friend class Repository;
 };
@@ -11,7 +11,9 @@
 #include "Patch.h"
 #include "conf/Settings.h"
 #include "git2/patch.h"
+#include "trace/Trace.h"
 #include <algorithm>
+#include <mutex>
 
 namespace git {
 
@@ -77,6 +79,17 @@ int Diff::Callbacks::progress(
   return cbs->progress(oldPath, newPath) ? 0 : -1;
 }
 
+int Diff::Callbacks::notify(
+  const git_diff *diff,
+  const git_diff_delta *diffDelta,
+  const char *matchedPathspec,
+  void *payload)
+{
+  Diff::Callbacks *cbs = reinterpret_cast<Diff::Callbacks *>(payload);
+  cbs->delta(diffDelta->new_file.path);
+  return 0;
+}
+
 Diff::Data::Data(git_diff *diff)
   : diff(diff)
 {
@@ -135,11 +148,13 @@ void Diff::setIndex(const Index &index)
 
 int Diff::count() const
 {
+  QMutexLocker locker(&d->mutex);
   return git_diff_num_deltas(d->diff);
 }
 
 Patch Diff::patch(int index) const
 {
+  QMutexLocker locker(&d->mutex);
   git_patch *patch = nullptr;
   git_patch_from_diff(&patch, d->diff, d->map.at(index));
   return Patch(patch);
@@ -147,21 +162,25 @@ Patch Diff::patch(int index) const
 
 QString Diff::name(int index) const
 {
+  QMutexLocker locker(&d->mutex);
   return d->delta(index)->new_file.path;
 }
 
 bool Diff::isBinary(int index) const
 {
+  QMutexLocker locker(&d->mutex);
   return d->delta(index)->flags & GIT_DIFF_FLAG_BINARY;
 }
 
 git_delta_t Diff::status(int index) const
 {
+  QMutexLocker locker(&d->mutex);
   return d->delta(index)->status;
 }
 
 Id Diff::id(int index, File file) const
 {
+  QMutexLocker locker(&d->mutex);
   const git_diff_delta *delta = d->delta(index);
   return (file == NewFile) ? delta->new_file.id : delta->old_file.id;
 }
@@ -179,16 +198,25 @@ int Diff::indexOf(const QString &name) const
 
 void Diff::merge(const Diff &diff)
 {
+  // Lock both without deadlocking when the other
+  // diff is being merged into this one.
+  std::unique_lock<QMutex> locker(d->mutex, std::defer_lock);
+  std::unique_lock<QMutex> source(diff.d->mutex, std::defer_lock);
+  std::lock(locker, source);
   git_diff_merge(d->diff, diff);
   d->resetMap();
 }
 
 void Diff::findSimilar(bool untracked)
 {
+  Trace::Span span("git", "findSimilar");
+  span.setArg("files", count());
+
   git_diff_find_options opts = GIT_DIFF_FIND_OPTIONS_INIT;
   if (untracked)
     opts.flags = GIT_DIFF_FIND_FOR_UNTRACKED;
 
+  QMutexLocker locker(&d->mutex);
   git_diff_find_similar(d->diff, &opts);
   d->resetMap();
 }
@@ -196,11 +224,12 @@ void Diff::findSimilar(bool untracked)
 void Diff::sort(SortRole role, Qt::SortOrder order, const git::Index &index)
 {
   Settings *settings = Settings::instance();
-  bool stagedFirst = settings->value(settings->SORT_STAGED).toBool();
-  bool directoryFirst = settings->value(settings->SORT_NAME_DIR).toBool();
-  Qt::CaseSensitivity cs = settings->value(settings->SORT_NAME_CASE).toBool() ?
+  bool stagedFirst = settings->value<bool>(settings->SORT_STAGED);
+  bool directoryFirst = settings->value<bool>(settings->SORT_NAME_DIR);
+  Qt::CaseSensitivity cs = settings->value<bool>(settings->SORT_NAME_CASE) ?
                            Qt::CaseInsensitive : Qt::CaseSensitive;
   bool ascending = (order == Qt::AscendingOrder);
+  QMutexLocker locker(&d->mutex);
   std::sort(d->map.begin(), d->map.end(),
   [this, stagedFirst, directoryFirst, cs, role, ascending, &index](int lhs, int rhs) {
     QString lhsName = git_diff_get_delta(d->diff, lhs)->new_file.path;
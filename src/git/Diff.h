@@ -14,6 +14,7 @@
 #include "Index.h"
 #include "git2/diff.h"
 #include <QFlags>
+#include <QMutex>
 #include <QSharedPointer>
 
 namespace git {
@@ -44,11 +45,23 @@ public:
       return false;
     }
 
+    // Status diffs report the staged changes before scanning the
+    // workdir, and then each workdir change as it's found. These are
+    // called on the thread that's running the status diff.
+    virtual void partial(const Diff &diff) {}
+    virtual void delta(const QString &path) {}
+
     static int progress(
       const git_diff *diff,
       const char *oldPath,
       const char *newPath,
       void *payload);
+
+    static int notify(
+      const git_diff *diff,
+      const git_diff_delta *diffDelta,
+      const char *matchedPathspec,
+      void *payload);
   };
 
   Diff();
@@ -61,6 +74,10 @@ public:
   Index index() const { return d->index; }
 
   int count() const;
+
+  // Patches can be generated on any thread. Generating a patch fills in
+  // the delta's flags and ids, so it's serialized with readers of those.
+  // The result is an independent copy that can be read without the lock.
   Patch patch(int index) const;
   QString name(int index) const;
   bool isBinary(int index) const;
@@ -93,6 +110,8 @@ private:
     git_diff *diff;
     QList<int> map;
     Index index;
+
+    mutable QMutex mutex;
   };
 
   Diff(git_diff *diff);
@@ -10,12 +10,19 @@
 #include "Filter.h"
 #include "Command.h"
 #include "Config.h"
+#include "FilterProcess.h"
 #include "git2/errors.h"
 #include "git2/filter.h"
 #include "git2/repository.h"
 #include "git2/sys/filter.h"
+#include <QCoreApplication>
 #include <QMap>
+#include <QMutex>
 #include <QProcess>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QThread>
+#include <functional>
 
 namespace git {
 
@@ -33,27 +40,81 @@ struct FilterInfo
 
   QString clean;
   QString smudge;
+  QString process;
   bool required = false;
 
   QByteArray name;
   QByteArray attributes;
 };
 
+// QProcess can only be used from the thread that created it, so each
+// filter process is owned by its own thread. Filters run by libgit2 on
+// any thread forward each file to that thread and wait for the result.
+// Requests from different threads are handled one at a time.
+class FilterHost
+{
+public:
+  FilterHost(
+    const QString &program,
+    const QStringList &args,
+    const QString &dir)
+  {
+    mContext.moveToThread(&mThread);
+    mThread.start();
+    QMetaObject::invokeMethod(&mContext, [this, program, args, dir] {
+      mProcess.reset(new FilterProcess(program, args, dir));
+    }, Qt::BlockingQueuedConnection);
+  }
+
+  ~FilterHost()
+  {
+    QMetaObject::invokeMethod(&mContext, [this] {
+      mProcess.reset();
+    }, Qt::BlockingQueuedConnection);
+
+    mThread.quit();
+    mThread.wait();
+  }
+
+  // Call the function with the process on the host thread.
+  void call(const std::function<void(FilterProcess *)> &func)
+  {
+    QMetaObject::invokeMethod(&mContext, [this, &func] {
+      func(mProcess.data());
+    }, Qt::BlockingQueuedConnection);
+  }
+
+private:
+  QThread mThread;
+  QObject mContext;
+  QScopedPointer<FilterProcess> mProcess;
+};
+
+// Hosts are keyed by filter driver and repository.
+QMutex lock;
+QMap<QString,QSharedPointer<FilterHost>> hosts;
+
+void stopHosts()
+{
+  QMutexLocker locker(&lock);
+  hosts.clear();
+}
+
 QString quote(const QString &path)
 {
   return QString("\"%1\"").arg(path);
 }
 
-int apply(
-  git_filter *self,
-  void **payload,
+int run(
+  FilterInfo *info,
   git_buf *to,
   const git_buf *from,
   const git_filter_source *src)
 {
-  FilterInfo *info = reinterpret_cast<FilterInfo *>(self);
   git_filter_mode_t mode = git_filter_source_mode(src);
   QString command = (mode == GIT_FILTER_SMUDGE) ? info->smudge : info->clean;
+  if (command.isEmpty())
+    return GIT_PASSTHROUGH;
 
   // Substitute path.
   command.replace("%f", quote(git_filter_source_path(src)));
@@ -83,12 +144,100 @@ int apply(
   return 0;
 }
 
+int apply(
+  git_filter *self,
+  void **payload,
+  git_buf *to,
+  const git_buf *from,
+  const git_filter_source *src)
+{
+  FilterInfo *info = reinterpret_cast<FilterInfo *>(self);
+  if (info->process.isEmpty())
+    return run(info, to, from, src);
+
+  // Start the filter process on first use.
+  git_repository *repo = git_filter_source_repo(src);
+  QString dir = git_repository_workdir(repo);
+  QString key = QString("%1:%2").arg(QString(info->name), dir);
+
+  QMutexLocker locker(&lock);
+  QSharedPointer<FilterHost> host = hosts.value(key);
+  if (!host) {
+    QString bash = Command::bashPath();
+    if (bash.isEmpty())
+      return info->required ? GIT_EUSER : GIT_PASSTHROUGH;
+
+    bool valid = false;
+    QByteArray error;
+    host.reset(new FilterHost(bash, {"-c", info->process}, dir));
+    host->call([&valid, &error](FilterProcess *process) {
+      valid = process->isValid();
+      if (!valid)
+        error = process->errorString().toUtf8();
+    });
+
+    if (!valid) {
+      git_error_set_str(GIT_ERROR_FILTER, error);
+      return info->required ? GIT_EUSER : GIT_PASSTHROUGH;
+    }
+
+    hosts.insert(key, host);
+  }
+
+  locker.unlock();
+
+  QByteArray data;
+  QByteArray error;
+  bool supported = true;
+  FilterProcess::Status status = FilterProcess::Success;
+  git_filter_mode_t mode = git_filter_source_mode(src);
+  QByteArray path = git_filter_source_path(src);
+  host->call([&](FilterProcess *process) {
+    supported = process->supports(mode);
+    if (!supported)
+      return;
+
+    status = process->apply(mode, path, from->ptr, from->size, data);
+    if (status != FilterProcess::Success)
+      error = process->errorString().toUtf8();
+  });
+
+  // Fall back to the single file command.
+  if (!supported)
+    return run(info, to, from, src);
+
+  switch (status) {
+    case FilterProcess::Success:
+      git_buf_set(to, data.constData(), data.length());
+      return 0;
+
+    case FilterProcess::Failed:
+      // Restart the process for the next file.
+      locker.relock();
+      if (hosts.value(key) == host)
+        hosts.remove(key);
+      locker.unlock();
+      // fall through
+
+    case FilterProcess::Delayed:
+    case FilterProcess::Error:
+    case FilterProcess::Abort:
+      git_error_set_str(GIT_ERROR_FILTER, error);
+      return info->required ? GIT_EUSER : GIT_PASSTHROUGH;
+  }
+
+  return GIT_PASSTHROUGH;
+}
+
 } // anon. namespace
 
 void Filter::init()
 {
   static QMap<QString,FilterInfo> filters;
 
+  // Stop filter processes before the application goes away.
+  qAddPostRoutine(&stopHosts);
+
   // Read global filters.
   Config config = Config::global();
   Config::Iterator it = config.glob("filter\\..*\\..*");
@@ -99,6 +248,8 @@ void Filter::init()
       filters[name].clean = entry.value<QString>();
     } else if (key == "smudge") {
       filters[name].smudge = entry.value<QString>();
+    } else if (key == "process") {
+      filters[name].process = entry.value<QString>();
     } else if (key == "required") {
       filters[name].required = entry.value<bool>();
     }
@@ -107,7 +258,8 @@ void Filter::init()
   // Register filters.
   foreach (const QString &key, filters.keys()) {
     FilterInfo &info = filters[key];
-    if (info.clean.isEmpty() || info.smudge.isEmpty())
+    if ((info.clean.isEmpty() || info.smudge.isEmpty()) &&
+        info.process.isEmpty())
       continue;
 
     info.name = key.toUtf8();
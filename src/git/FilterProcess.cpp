@@ -0,0 +1,330 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "FilterProcess.h"
+#include <QMap>
+
+namespace git {
+
+namespace {
+
+// Maximum size of pkt-line payload.
+const int kMaxPacket = 65516;
+
+QByteArray command(git_filter_mode_t mode)
+{
+  return (mode == GIT_FILTER_SMUDGE) ? "smudge" : "clean";
+}
+
+} // anon. namespace
+
+FilterProcess::FilterProcess(
+  const QString &program,
+  const QStringList &args,
+  const QString &dir)
+{
+  mProcess.setWorkingDirectory(dir);
+  mProcess.start(program, args);
+  if (!mProcess.waitForStarted())
+    return;
+
+  // Handshake.
+  QList<QByteArray> lines;
+  if (!writeText("git-filter-client") || !writeText("version=2") ||
+      !writeFlush() || !readList(lines) ||
+      lines.value(0) != "git-filter-server" ||
+      !lines.contains("version=2"))
+    return;
+
+  // Negotiate capabilities.
+  if (!writeText("capability=clean") || !writeText("capability=smudge") ||
+      !writeText("capability=delay") || !writeFlush() ||
+      !readList(lines))
+    return;
+
+  foreach (const QByteArray &line, lines) {
+    if (line.startsWith("capability="))
+      mCapabilities.append(line.mid(11));
+  }
+
+  mValid = true;
+}
+
+FilterProcess::~FilterProcess()
+{
+  mProcess.closeWriteChannel();
+  if (!mProcess.waitForFinished(1000))
+    mProcess.kill();
+}
+
+bool FilterProcess::supports(git_filter_mode_t mode) const
+{
+  return mCapabilities.contains(command(mode));
+}
+
+QString FilterProcess::errorString()
+{
+  QString error = mProcess.readAllStandardError().trimmed();
+  return !error.isEmpty() ? error : mProcess.errorString();
+}
+
+FilterProcess::Status FilterProcess::apply(
+  git_filter_mode_t mode,
+  const QByteArray &path,
+  const char *data,
+  size_t size,
+  QByteArray &result)
+{
+  // Discard diagnostic output from previous requests.
+  mProcess.readAllStandardError();
+
+  bool delay = (mode == GIT_FILTER_SMUDGE && mCapabilities.contains("delay"));
+  Status status = request(mode, path, data, size, delay, result);
+  if (status != Delayed)
+    return status;
+
+  // Libgit2 needs the content now, so wait for the filter
+  // to report it as available and ask for it again.
+  QList<QByteArray> paths;
+  while (!paths.contains(path)) {
+    if (!available(paths))
+      return Failed;
+  }
+
+  return request(mode, path, nullptr, 0, false, result);
+}
+
+bool FilterProcess::smudge(QList<File> &files)
+{
+  mProcess.readAllStandardError();
+
+  QMap<QByteArray,int> delayed;
+  bool delay = mCapabilities.contains("delay");
+  for (int i = 0; i < files.size(); ++i) {
+    File &file = files[i];
+    if (!supports(GIT_FILTER_SMUDGE))
+      break;
+
+    const QByteArray &input = file.input;
+    switch (request(GIT_FILTER_SMUDGE, file.path,
+                    input.constData(), input.length(), delay, file.output)) {
+      case Delayed:
+        delayed.insert(file.path, i);
+        break;
+
+      case Failed:
+        return false;
+
+      default:
+        break;
+    }
+  }
+
+  // Collect delayed files as they become available.
+  while (!delayed.isEmpty()) {
+    QList<QByteArray> paths;
+    if (!available(paths))
+      return false;
+
+    foreach (const QByteArray &path, paths) {
+      if (!delayed.contains(path))
+        continue;
+
+      File &file = files[delayed.take(path)];
+      Status status =
+        request(GIT_FILTER_SMUDGE, path, nullptr, 0, false, file.output);
+      if (status == Failed)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+FilterProcess::Status FilterProcess::request(
+  git_filter_mode_t mode,
+  const QByteArray &path,
+  const char *data,
+  size_t size,
+  bool delay,
+  QByteArray &result)
+{
+  result.clear();
+  if (!writeText("command=" + command(mode)) ||
+      !writeText("pathname=" + path) ||
+      (delay && !writeText("can-delay=1")) || !writeFlush() ||
+      !writeContent(data, size))
+    return Failed;
+
+  QByteArray status;
+  if (!readStatus(status))
+    return Failed;
+
+  if (status == "delayed")
+    return delay ? Delayed : Failed;
+
+  if (status == "success") {
+    // Read content followed by a (possibly empty) final status.
+    if (!readContent(result) || !readStatus(status, status))
+      return Failed;
+  }
+
+  if (status == "success")
+    return Success;
+
+  result.clear();
+  if (status == "abort") {
+    // Don't send any more requests of this kind.
+    mCapabilities.removeAll(command(mode));
+    return Abort;
+  }
+
+  return Error;
+}
+
+bool FilterProcess::available(QList<QByteArray> &paths)
+{
+  QList<QByteArray> lines;
+  QByteArray status;
+  if (!writeText("command=list_available_blobs") || !writeFlush() ||
+      !readList(lines) || !readStatus(status) || status != "success")
+    return false;
+
+  paths.clear();
+  foreach (const QByteArray &line, lines) {
+    if (line.startsWith("pathname="))
+      paths.append(line.mid(9));
+  }
+
+  // The filter blocks until at least one blob is available.
+  return !paths.isEmpty();
+}
+
+bool FilterProcess::write(const QByteArray &data)
+{
+  if (mProcess.write(data) != data.length())
+    return false;
+
+  while (mProcess.bytesToWrite() > 0) {
+    if (!mProcess.waitForBytesWritten(-1))
+      return false;
+  }
+
+  return true;
+}
+
+bool FilterProcess::writePacket(const char *data, int size)
+{
+  QByteArray packet = QByteArray::number(size + 4, 16).rightJustified(4, '0');
+  return write(packet.append(data, size));
+}
+
+bool FilterProcess::writeText(const QByteArray &text)
+{
+  QByteArray line = text + '\n';
+  return writePacket(line.constData(), line.length());
+}
+
+bool FilterProcess::writeFlush()
+{
+  return write("0000");
+}
+
+bool FilterProcess::writeContent(const char *data, size_t size)
+{
+  for (size_t pos = 0; pos < size; pos += kMaxPacket) {
+    if (!writePacket(data + pos, qMin<size_t>(kMaxPacket, size - pos)))
+      return false;
+  }
+
+  return writeFlush();
+}
+
+bool FilterProcess::read(int size, QByteArray &data)
+{
+  data.clear();
+  while (data.length() < size) {
+    if (mProcess.bytesAvailable() <= 0 && !mProcess.waitForReadyRead(-1))
+      return false;
+    data.append(mProcess.read(size - data.length()));
+  }
+
+  return true;
+}
+
+// Read one packet. Flush packets are returned as a null array.
+bool FilterProcess::readPacket(QByteArray &data)
+{
+  QByteArray header;
+  if (!read(4, header))
+    return false;
+
+  bool ok = false;
+  int size = header.toInt(&ok, 16);
+  if (!ok || (size > 0 && size <= 4))
+    return false;
+
+  if (size == 0) {
+    data = QByteArray();
+    return true;
+  }
+
+  return read(size - 4, data);
+}
+
+bool FilterProcess::readList(QList<QByteArray> &lines)
+{
+  lines.clear();
+  forever {
+    QByteArray data;
+    if (!readPacket(data))
+      return false;
+
+    if (data.isNull())
+      return true;
+
+    if (data.endsWith('\n'))
+      data.chop(1);
+    lines.append(data);
+  }
+}
+
+bool FilterProcess::readContent(QByteArray &data)
+{
+  // Empty content is still valid.
+  data = QByteArray("");
+  forever {
+    QByteArray packet;
+    if (!readPacket(packet))
+      return false;
+
+    if (packet.isNull())
+      return true;
+
+    data.append(packet);
+  }
+}
+
+// An empty status list keeps the previous status.
+bool FilterProcess::readStatus(QByteArray &status, const QByteArray &prev)
+{
+  QList<QByteArray> lines;
+  if (!readList(lines))
+    return false;
+
+  status = prev;
+  foreach (const QByteArray &line, lines) {
+    if (line.startsWith("status="))
+      status = line.mid(7);
+  }
+
+  return !status.isEmpty();
+}
+
+} // namespace git
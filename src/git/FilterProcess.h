@@ -0,0 +1,97 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#ifndef FILTERPROCESS_H
+#define FILTERPROCESS_H
+
+#include "git2/filter.h"
+#include <QByteArray>
+#include <QList>
+#include <QProcess>
+
+namespace git {
+
+// A long-running filter process that speaks the git filter protocol
+// (version 2) over stdin/stdout. See gitattributes(5) for details.
+// QProcess can only be used from the thread that created it, so
+// instances must not be shared between threads.
+class FilterProcess
+{
+public:
+  enum Status
+  {
+    Success,
+    Delayed,
+    Error,
+    Abort,
+    Failed
+  };
+
+  struct File
+  {
+    QByteArray path;
+    QByteArray input;
+    QByteArray output;
+  };
+
+  FilterProcess(
+    const QString &program,
+    const QStringList &args,
+    const QString &dir);
+  ~FilterProcess();
+
+  bool isValid() const { return mValid; }
+  bool supports(git_filter_mode_t mode) const;
+
+  QString errorString();
+
+  // Filter a single file. Delayed content is waited for.
+  Status apply(
+    git_filter_mode_t mode,
+    const QByteArray &path,
+    const char *data,
+    size_t size,
+    QByteArray &result);
+
+  // Smudge each file. Delayed files are collected after every request
+  // has been sent. The output of files that couldn't be filtered is
+  // null. Returns false if the process failed.
+  bool smudge(QList<File> &files);
+
+private:
+  Status request(
+    git_filter_mode_t mode,
+    const QByteArray &path,
+    const char *data,
+    size_t size,
+    bool delay,
+    QByteArray &result);
+
+  bool available(QList<QByteArray> &paths);
+
+  bool write(const QByteArray &data);
+  bool writePacket(const char *data, int size);
+  bool writeText(const QByteArray &text);
+  bool writeFlush();
+  bool writeContent(const char *data, size_t size);
+
+  bool read(int size, QByteArray &data);
+  bool readPacket(QByteArray &data);
+  bool readList(QList<QByteArray> &lines);
+  bool readContent(QByteArray &data);
+  bool readStatus(QByteArray &status, const QByteArray &prev = QByteArray());
+
+  QProcess mProcess;
+  QList<QByteArray> mCapabilities;
+  bool mValid = false;
+};
+
+} // namespace git
+
+#endif
@@ -80,6 +80,23 @@ Index::Conflict Index::conflict(const QString &path) const
   return {ancestorId, oursId, theirsId};
 }
 
+QStringList Index::conflicts() const
+{
+  git_index_conflict_iterator *it = nullptr;
+  if (git_index_conflict_iterator_new(&it, d->index))
+    return QStringList();
+
+  QStringList paths;
+  const git_index_entry *ancestor, *ours, *theirs;
+  while (!git_index_conflict_next(&ancestor, &ours, &theirs, it)) {
+    const git_index_entry *entry = ours ? ours : theirs ? theirs : ancestor;
+    paths.append(QString::fromUtf8(entry->path));
+  }
+
+  git_index_conflict_iterator_free(it);
+  return paths;
+}
+
 git_filemode_t Index::mode(const QString &path) const
 {
   const git_index_entry *entry = this->entry(path);
@@ -97,6 +114,10 @@ void Index::setMode(const QString &path, git_filemode_t mode)
 
   git_index_entry copy = *entry;
   copy.mode = mode;
+
+  if (Repository repo = git_index_owner(d->index))
+    emit repo.notifier()->indexAboutToBeChanged();
+
   git_index_add(d->index, &copy);
 }
 
@@ -157,6 +178,9 @@ void Index::setStaged(const QStringList &files, bool staged, bool yieldFocus)
   QStringList changedFiles;
   Repository repo(git_index_owner(d->index));
   RepositoryNotifier *notifier = repo.notifier();
+  if (!files.isEmpty())
+    emit notifier->indexAboutToBeChanged();
+
   foreach (const QString &file, files) {
     QByteArray path = file.toUtf8();
 
@@ -305,6 +329,9 @@ void Index::setStaged(const QStringList &files, bool staged, bool yieldFocus)
 
 void Index::add(const QString &path, const QByteArray &buffer)
 {
+  git::Repository repo(git_index_owner(d->index));
+  emit repo.notifier()->indexAboutToBeChanged();
+
   const git_index_entry *entry = this->entry(path);
   if (!entry) {
     git_index_add_bypath(d->index, path.toUtf8());
@@ -319,7 +346,6 @@ void Index::add(const QString &path, const QByteArray &buffer)
 
   git_index_write(d->index);
   d->stagedCache.remove(path);
-  git::Repository repo(git_index_owner(d->index));
   emit repo.notifier()->indexChanged({path});
 }
 
@@ -49,6 +49,9 @@ public:
 
   Conflict conflict(const QString &path) const;
 
+  // Get the paths of every conflicted entry.
+  QStringList conflicts() const;
+
   git_filemode_t mode(const QString &path) const;
   void setMode(const QString &path, git_filemode_t mode);
 
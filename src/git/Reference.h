@@ -72,6 +72,7 @@ protected:
   QSharedPointer<git_reference> d;
 
   friend class Commit;
+  friend class ReferenceSnapshot;
   friend class Repository;
   friend class RevWalk;
 };
@@ -0,0 +1,130 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "ReferenceSnapshot.h"
+#include "git2/object.h"
+#include "git2/refs.h"
+
+namespace git {
+
+namespace {
+
+Id peel(git_reference *ref)
+{
+  git_object *obj = nullptr;
+  if (git_reference_peel(&obj, ref, GIT_OBJECT_COMMIT))
+    return Id();
+
+  Id id = git_object_id(obj);
+  git_object_free(obj);
+  return id;
+}
+
+} // anon. namespace
+
+ReferenceSnapshot::ReferenceSnapshot() {}
+
+ReferenceSnapshot::ReferenceSnapshot(Data *data)
+  : d(data)
+{}
+
+int ReferenceSnapshot::version() const
+{
+  return d ? d->version : -1;
+}
+
+QList<Reference> ReferenceSnapshot::refs() const
+{
+  QList<Reference> refs;
+  if (!d)
+    return refs;
+
+  foreach (const Entry &entry, d->refs)
+    refs.append(entry.ref);
+
+  return refs;
+}
+
+QList<Reference> ReferenceSnapshot::refs(const Id &target) const
+{
+  QList<Reference> refs;
+  if (!d)
+    return refs;
+
+  QStringList names = d->names.values(target);
+  names.sort();
+
+  foreach (const QString &name, names)
+    refs.append(d->refs.value(name).ref);
+
+  return refs;
+}
+
+bool ReferenceSnapshot::contains(const QString &name) const
+{
+  return d && d->refs.contains(name);
+}
+
+Reference ReferenceSnapshot::ref(const QString &name) const
+{
+  return d ? d->refs.value(name).ref : Reference();
+}
+
+Id ReferenceSnapshot::target(const QString &name) const
+{
+  return d ? d->refs.value(name).target : Id();
+}
+
+ReferenceSnapshot ReferenceSnapshot::read(git_repository *repo, int version)
+{
+  Data *data = new Data;
+  data->version = version;
+
+  git_reference_iterator *it = nullptr;
+  if (!git_reference_iterator_new(&it, repo)) {
+    git_reference *ref = nullptr;
+    while (!git_reference_next(&ref, it)) {
+      Id id = peel(ref);
+      QString name = git_reference_name(ref);
+      data->refs.insert(name, {Reference(ref), id});
+      if (id.isValid())
+        data->names.insert(id, name);
+    }
+
+    git_reference_iterator_free(it);
+  }
+
+  return ReferenceSnapshot(data);
+}
+
+ReferenceSnapshot ReferenceSnapshot::update(
+  git_repository *repo,
+  const QString &name,
+  int version) const
+{
+  Data *data = d ? new Data(*d) : new Data;
+  data->version = version;
+
+  // Remove the old entry.
+  Id old = data->refs.take(name).target;
+  if (old.isValid())
+    data->names.remove(old, name);
+
+  git_reference *ref = nullptr;
+  if (!git_reference_lookup(&ref, repo, name.toUtf8())) {
+    Id id = peel(ref);
+    data->refs.insert(name, {Reference(ref), id});
+    if (id.isValid())
+      data->names.insert(id, name);
+  }
+
+  return ReferenceSnapshot(data);
+}
+
+} // namespace git
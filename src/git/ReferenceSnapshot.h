@@ -0,0 +1,83 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#ifndef REFERENCESNAPSHOT_H
+#define REFERENCESNAPSHOT_H
+
+#include "Id.h"
+#include "Reference.h"
+#include <QMap>
+#include <QMultiHash>
+#include <QSharedPointer>
+
+struct git_repository;
+
+namespace git {
+
+// An immutable view of the references under refs/ at one point in
+// time. Each reference is peeled to the commit that it points to, so
+// lookups by name or by target don't touch the reference database.
+// Copies are cheap and can be read from any thread. Updates return a
+// new snapshot with the next version and leave this one unchanged.
+class ReferenceSnapshot
+{
+public:
+  ReferenceSnapshot();
+
+  bool isValid() const { return !d.isNull(); }
+  explicit operator bool() const { return isValid(); }
+
+  // The version increases every time the repository's snapshot changes.
+  int version() const;
+
+  // All references sorted by qualified name.
+  QList<Reference> refs() const;
+
+  // The references that peel to the given commit.
+  QList<Reference> refs(const Id &target) const;
+
+  // Look up by qualified name.
+  bool contains(const QString &name) const;
+  Reference ref(const QString &name) const;
+  Id target(const QString &name) const;
+
+private:
+  struct Entry
+  {
+    Reference ref;
+    Id target;
+  };
+
+  struct Data
+  {
+    int version = 0;
+    QMap<QString,Entry> refs;
+    QMultiHash<Id,QString> names;
+  };
+
+  ReferenceSnapshot(Data *data);
+
+  // Read every reference from the repository.
+  static ReferenceSnapshot read(git_repository *repo, int version);
+
+  // Replace the named reference with the current one from the
+  // repository. It's removed if it no longer exists.
+  ReferenceSnapshot update(
+    git_repository *repo,
+    const QString &name,
+    int version) const;
+
+  QSharedPointer<const Data> d;
+
+  friend class Repository;
+};
+
+} // namespace git
+
+#endif
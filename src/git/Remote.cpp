@@ -556,7 +556,11 @@ void Remote::setUrl(const QString &url)
   git_remote_set_url(repo, git_remote_name(d.data()), url.toUtf8());
 }
 
-Result Remote::fetch(Callbacks *callbacks, bool tags, bool prune)
+Result Remote::fetch(
+  Callbacks *callbacks,
+  bool tags,
+  bool prune,
+  bool fetchHead)
 {
   git_fetch_options opts = GIT_FETCH_OPTIONS_INIT;
   opts.callbacks.connect = &Remote::Callbacks::connect;
@@ -578,6 +582,9 @@ Result Remote::fetch(Callbacks *callbacks, bool tags, bool prune)
   if (prune)
     opts.prune = GIT_FETCH_PRUNE;
 
+  if (!fetchHead)
+    opts.update_fetchhead = 0;
+
   // Write reflog message.
   QString msg = QString("fetch: %1").arg(name());
 
@@ -215,7 +215,12 @@ public:
   QString url() const;
   void setUrl(const QString &url);
 
-  Result fetch(Callbacks *callbacks, bool tags = false, bool prune = false);
+  // Set fetchHead to false to leave FETCH_HEAD unchanged.
+  Result fetch(
+    Callbacks *callbacks,
+    bool tags = false,
+    bool prune = false,
+    bool fetchHead = true);
   Result push(Callbacks *callbacks, const QStringList &refspecs);
   Result push(
     Callbacks *callbacks,
@@ -16,10 +16,12 @@
 #include "Config.h"
 #include "Filter.h"
 #include "FilterList.h"
+#include "FilterProcess.h"
 #include "Index.h"
 #include "Patch.h"
 #include "Rebase.h"
 #include "Reference.h"
+#include "ReferenceSnapshot.h"
 #include "Remote.h"
 #include "RevWalk.h"
 #include "Signature.h"
@@ -34,23 +36,33 @@
 #include "git2/global.h"
 #include "git2/ignore.h"
 #include "git2/merge.h"
+#include "git2/odb.h"
 #include "git2/rebase.h"
 #include "git2/refs.h"
 #include "git2/remote.h"
 #include "git2/repository.h"
+#include "git2/reset.h"
 #include "git2/signature.h"
 #include "git2/stash.h"
 #include "git2/tag.h"
 #include "git2/sys/repository.h"
+#include "trace/Trace.h"
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QMap>
+#include <QMutex>
 #include <QProcess>
+#include <QRegularExpression>
 #include <QSaveFile>
 #include <QStandardPaths>
 #include <QTextCodec>
 #include <QVector>
+#include <QtConcurrent>
 
 #ifdef Q_OS_UNIX
 #include <pwd.h>
@@ -64,13 +76,244 @@ namespace {
 const QString kConfigDir = "gitahead";
 const QString kConfigFile = "config";
 const QString kStarFile = "starred";
+const QString kStatusCacheFile = "status";
+
+// Decompress blobs for large checkouts in parallel
+// as long as they are small enough to be cached.
+const int kPrefetchMin = 256;
+const size_t kPrefetchBlobSize = 1024 * 1024;
+const qint64 kPrefetchTotalSize = 128 * 1024 * 1024;
+
+const int kLfsPointerMaxSize = 1024;
+
+// Check the app config files for changes at most this often.
+const int kConfigCheckInterval = 1000;
+
+// The least recently used conflict predictions are dropped when there
+// are this many. No more than the pending limit are made at once.
+const int kConflictCacheSize = 256;
+const int kConflictPendingLimit = 8;
+
+Repository::BackgroundRunner backgroundRunner;
+
+// Repositories are opened on background threads too.
+QMutex registryMutex;
+
+// The modification time and size of a file.
+using Stamp = QPair<qint64,qint64>;
+
+Stamp stamp(const QFileInfo &info)
+{
+  return {info.lastModified().toMSecsSinceEpoch(), info.size()};
+}
+
+QList<Stamp> stamps(const QStringList &paths)
+{
+  QList<Stamp> result;
+  foreach (const QString &path, paths)
+    result.append(stamp(QFileInfo(path)));
+
+  return result;
+}
+
+// Resolve the global excludes file the same way that git does.
+QString excludesFile(const Config &config)
+{
+  QString path = config.value<QString>("core.excludesFile");
+  if (path.isEmpty()) {
+    QString xdg = QString::fromLocal8Bit(qgetenv("XDG_CONFIG_HOME"));
+    if (xdg.isEmpty())
+      xdg = QDir::home().filePath(".config");
+    return QDir(xdg).filePath("git/ignore");
+  }
+
+  if (path.startsWith("~/"))
+    path.replace(0, 1, QDir::homePath());
+
+  return path;
+}
 
 int blame_progress(const git_oid *suspect, void *payload)
 {
   return reinterpret_cast<Blame::Callbacks *>(payload)->progress() ? 0 : -1;
 }
 
-int checkout_notify(
+int insert_stash_id(
+  size_t index,
+  const char *message,
+  const git_oid *id,
+  void *payload)
+{
+  reinterpret_cast<QList<Id> *>(payload)->insert(index, id);
+  return 0;
+}
+
+} // anon. namespace
+
+struct Repository::AppConfigCache
+{
+  QMutex mutex;
+  QStringList paths;
+
+  // The live config with a read snapshot.
+  Config config;
+  QList<Stamp> stamps;
+  int writes = -1;
+  QElapsedTimer checked;
+};
+
+struct Repository::ConflictCache
+{
+  using Key = QPair<Id,Id>;
+
+  // Clears the pending key when the last copy of the work is dropped,
+  // whether it ran or was canceled before it started. The repository
+  // keeps the cache alive until then.
+  struct Pending
+  {
+    Pending(const Repository &repo, const Key &key)
+      : repo(repo), key(key)
+    {}
+
+    ~Pending()
+    {
+      ConflictCache *cache = repo.d->conflicts;
+      QMutexLocker locker(&cache->mutex);
+      cache->pending.remove(key);
+    }
+
+    Repository repo;
+    Key key;
+  };
+
+  QMutex mutex;
+  QSet<Key> pending;
+  QSet<Key> failed; // the merge failed
+  QHash<Key,QStringList> predictions;
+  QList<Key> used; // least recently used first
+};
+
+struct Repository::RefCache
+{
+  QMap<QString,Stamp> readStamps() const;
+  void restamp(const QString &name);
+
+  void update(git_repository *repo, const Reference &ref, bool added);
+  void remove(git_repository *repo);
+
+  QMutex mutex;
+  QDir dir;
+
+  ReferenceSnapshot snapshot;
+  QMap<QString,Stamp> stamps;
+  int version = 0;
+
+  // qualified names of references that are being removed
+  QStringList removing;
+
+  // The snapshot is read again when it's stale. Checking compares
+  // the stamps to look for changes made outside of the repository.
+  bool stale = true;
+  bool check = false;
+};
+
+// Stamp every loose reference file and the packed-refs file by path
+// relative to the common dir. Lock files are transient, so skip them.
+QMap<QString,Stamp> Repository::RefCache::readStamps() const
+{
+  QMap<QString,Stamp> result;
+  QFileInfo packed(dir.filePath("packed-refs"));
+  if (packed.exists())
+    result.insert("packed-refs", stamp(packed));
+
+  QDirIterator it(dir.filePath("refs"), QDir::Files | QDir::Hidden,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    QString path = it.next();
+    if (!path.endsWith(".lock"))
+      result.insert(dir.relativeFilePath(path), stamp(it.fileInfo()));
+  }
+
+  return result;
+}
+
+// Stamp a single file after this repository changed it. Changes to any
+// other file are still found the next time the stamps are checked.
+void Repository::RefCache::restamp(const QString &name)
+{
+  QFileInfo info(dir.filePath(name));
+  if (info.exists()) {
+    stamps.insert(name, stamp(info));
+  } else {
+    stamps.remove(name);
+  }
+}
+
+void Repository::RefCache::update(
+  git_repository *repo,
+  const Reference &ref,
+  bool added)
+{
+  QMutexLocker locker(&mutex);
+  if (stale)
+    return;
+
+  if (!ref.isValid()) {
+    stale = true;
+    return;
+  }
+
+  // HEAD isn't in the snapshot.
+  QString name = ref.qualifiedName();
+  if (name == "HEAD")
+    return;
+
+  // An update to an unknown reference is a rename. The old
+  // name isn't reported, so the whole snapshot has to be read.
+  if (!added && !snapshot.contains(name)) {
+    stale = true;
+    return;
+  }
+
+  snapshot = snapshot.update(repo, name, ++version);
+  restamp(name);
+}
+
+void Repository::RefCache::remove(git_repository *repo)
+{
+  QMutexLocker locker(&mutex);
+  QStringList names = removing;
+  removing.clear();
+  if (stale)
+    return;
+
+  foreach (const QString &name, names) {
+    snapshot = snapshot.update(repo, name, ++version);
+    restamp(name);
+  }
+
+  // Removing a packed reference rewrites packed-refs.
+  if (!names.isEmpty())
+    restamp("packed-refs");
+}
+
+QMap<git_repository *,QWeakPointer<Repository::Data>> Repository::registry;
+
+void Repository::CheckoutCallbacks::init(
+  git_checkout_options *opts,
+  CheckoutCallbacks *cbs)
+{
+  // Always get notified about something that can be
+  // used as an opportunity to cancel the checkout.
+  opts->notify_flags = cbs->flags() | GIT_CHECKOUT_NOTIFY_UPDATED;
+  opts->notify_cb = &CheckoutCallbacks::notify;
+  opts->notify_payload = cbs;
+
+  opts->progress_cb = &CheckoutCallbacks::progress;
+  opts->progress_payload = cbs;
+}
+
+int Repository::CheckoutCallbacks::notify(
   git_checkout_notify_t why,
   const char *path,
   const git_diff_file *baseline,
@@ -78,6 +321,15 @@ int checkout_notify(
   const git_diff_file *workdir,
   void *payload)
 {
+  auto *cbs = reinterpret_cast<Repository::CheckoutCallbacks *>(payload);
+  if (cbs->isCanceled()) {
+    git_error_set_str(GIT_ERROR_CHECKOUT, tr("checkout canceled").toUtf8());
+    return GIT_EUSER;
+  }
+
+  if (!(why & cbs->flags()))
+    return 0;
+
   char status = 'M';
   if (why == GIT_CHECKOUT_NOTIFY_CONFLICT) {
     status = '!';
@@ -90,11 +342,10 @@ int checkout_notify(
     status = 'R';
   }
 
-  auto *cbs = reinterpret_cast<Repository::CheckoutCallbacks *>(payload);
   return cbs->notify(status, path) ? 0 : -1;
 }
 
-void checkout_progress(
+void Repository::CheckoutCallbacks::progress(
   const char *path,
   size_t current,
   size_t total,
@@ -104,25 +355,48 @@ void checkout_progress(
   cbs->progress(path, current, total);
 }
 
-int insert_stash_id(
-  size_t index,
-  const char *message,
-  const git_oid *id,
-  void *payload)
-{
-  reinterpret_cast<QList<Id> *>(payload)->insert(index, id);
-  return 0;
-}
-
-} // anon. namespace
-
-QMap<git_repository *,QWeakPointer<Repository::Data>> Repository::registry;
-
 Repository::Data::Data(git_repository *repo)
   : repo(repo), notifier(new RepositoryNotifier)
 {
-  // Load starred commits.
   QDir dir(git_repository_path(repo));
+  const char *workdir = git_repository_workdir(repo);
+  statusCache = new StatusCache(
+    workdir ? QDir(workdir) : dir, dir,
+    appDir(dir).filePath(kStatusCacheFile));
+
+  appConfig = new AppConfigCache;
+  appConfig->paths.append(Config::appGlobalPath());
+  appConfig->paths.append(appDir(dir).filePath(kConfigFile));
+
+  conflicts = new ConflictCache;
+
+  refs = new RefCache;
+  refs->dir = QDir(git_repository_commondir(repo));
+
+  // Keep the reference snapshot up to date. Connect directly so that
+  // the snapshot is current before any other receiver is called.
+  QObject::connect(notifier, &RepositoryNotifier::referenceAdded, notifier,
+  [this, repo](const Reference &ref) {
+    refs->update(repo, ref, true);
+  }, Qt::DirectConnection);
+  QObject::connect(notifier, &RepositoryNotifier::referenceUpdated, notifier,
+  [this, repo](const Reference &ref) {
+    refs->update(repo, ref, false);
+  }, Qt::DirectConnection);
+
+  // The removed signal only has the short name, so remember the
+  // qualified name before the reference is removed.
+  QObject::connect(notifier, &RepositoryNotifier::referenceAboutToBeRemoved,
+  notifier, [this](const Reference &ref) {
+    QMutexLocker locker(&refs->mutex);
+    refs->removing.append(ref.qualifiedName());
+  }, Qt::DirectConnection);
+  QObject::connect(notifier, &RepositoryNotifier::referenceRemoved, notifier,
+  [this, repo] {
+    refs->remove(repo);
+  }, Qt::DirectConnection);
+
+  // Load starred commits.
   QFile file(appDir(dir).filePath(kStarFile));
   if (!file.open(QIODevice::ReadOnly))
     return;
@@ -137,13 +411,20 @@ Repository::Data::Data(git_repository *repo)
 
 Repository::Data::~Data()
 {
+  delete statusCache;
+  delete appConfig;
+  delete conflicts;
+  delete refs;
   delete notifier;
   git_repository_free(repo);
 }
 
 void Repository::unregisterRepository(Data *data)
 {
+  QMutexLocker locker(&registryMutex);
   registry.remove(data->repo);
+  locker.unlock();
+
   delete data;
 }
 
@@ -153,6 +434,7 @@ QSharedPointer<Repository::Data> Repository::registerRepository(
   if (!repo)
     return QSharedPointer<Data>();
 
+  QMutexLocker locker(&registryMutex);
   auto it = registry.find(repo);
   if (it != registry.end())
     return *it;
@@ -213,9 +495,57 @@ Config Repository::config() const
 
 Config Repository::appConfig() const
 {
-  Config config = Config::appGlobal();
-  QString path = appDir().filePath(kConfigFile);
-  config.addFile(path, GIT_CONFIG_LEVEL_LOCAL, d->repo);
+  bool changed = false;
+  AppConfigCache *cache = d->appConfig;
+  QMutexLocker locker(&cache->mutex);
+
+  // Writes to these files are checked right away. Other changes
+  // on disk are picked up by the next check after the interval.
+  int writes = Config::writes(cache->paths);
+  bool written = (cache->writes != writes);
+  if (written || !cache->checked.isValid() ||
+      cache->checked.hasExpired(kConfigCheckInterval)) {
+    cache->checked.start();
+
+    // Writes change the stamps too. Only report a change
+    // when nothing was written through a config since.
+    QList<Stamp> current = stamps(cache->paths);
+    changed = (cache->config.isValid() && !written &&
+               current != cache->stamps);
+    if (!cache->config.isValid() || changed) {
+      Config config = Config::appGlobal();
+      config.addFile(cache->paths.last(), GIT_CONFIG_LEVEL_LOCAL, *this);
+      cache->config = config;
+
+      // Copies of the old config stop reading their snapshot.
+      if (changed)
+        Config::expireSnapshots();
+    }
+
+    int generation = Config::sGeneration.loadAcquire();
+    if (written || changed || cache->config.mGeneration != generation) {
+      // Reading from the snapshot doesn't touch the disk.
+      git_config *snapshot = nullptr;
+      if (cache->config.isValid() &&
+          !git_config_snapshot(&snapshot, cache->config.d.data()))
+        cache->config.setSnapshot(snapshot, generation);
+    }
+
+    cache->stamps = current;
+    cache->writes = writes;
+  }
+
+  Config config = cache->config;
+  locker.unlock();
+
+  if (changed) {
+    // This can be called from any thread. Notify on the notifier's.
+    RepositoryNotifier *notifier = d->notifier;
+    QMetaObject::invokeMethod(notifier, [notifier] {
+      emit notifier->appConfigChanged();
+    }, Qt::QueuedConnection);
+  }
+
   return config;
 }
 
@@ -316,8 +646,11 @@ void Repository::setIndex(const Index &index)
 Diff Repository::status(
   const Index &index,
   Diff::Callbacks *callbacks,
-  bool ignoreWhitespace) const
+  bool ignoreWhitespace,
+  const QStringList &paths) const
 {
+  Trace::Span span("git", "status");
+
   Tree tree;
   if (Reference ref = head()) {
     if (Commit commit = ref.target())
@@ -325,16 +658,92 @@ Diff Repository::status(
   }
 
   Diff diff = diffTreeToIndex(tree, index, ignoreWhitespace);
-  Diff workdir = diffIndexToWorkdir(index, callbacks, ignoreWhitespace);
-  if (!diff.isValid() || !workdir.isValid())
+  if (!diff.isValid())
     return Diff();
 
-  diff.merge(workdir);
+  // Use the cache to limit a full workdir scan to changed paths.
+  bool scan = true;
+  QStringList workdirPaths = paths;
+  Config config = appConfig();
+  bool cached = (paths.isEmpty() && index.isValid() &&
+                 config.value<bool>("status.cache", true));
+  StatusCache::Scan cache;
+  if (cached) {
+    // Changes to the global excludes file can affect any untracked path.
+    QString excludes = excludesFile(this->config());
+    Stamp excludesStamp = stamp(QFileInfo(excludes));
+    QString key = QString("%1:%2:%3:%4:%5").arg(
+      config.value<bool>("untracked.hide", false)).arg(ignoreWhitespace)
+      .arg(excludes).arg(excludesStamp.first).arg(excludesStamp.second);
+    cache = d->statusCache->start(index, key, workdirPaths);
+    if (cache.cached)
+      scan = !workdirPaths.isEmpty();
+  }
+
+  if (scan) {
+    // Report the staged changes before the slower workdir scan. Staging
+    // from the partial diff cancels the scan before it writes the index.
+    if (callbacks) {
+      diff.setIndex(index);
+      callbacks->partial(diff);
+    }
+
+    Diff workdir =
+      diffIndexToWorkdir(index, callbacks, ignoreWhitespace, workdirPaths);
+    if (!workdir.isValid())
+      return Diff();
+
+    // The partial diff may still be in use. Merge into a copy of it
+    // instead of diffing the tree and index again.
+    if (callbacks) {
+      git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+      if (!appConfig().value<bool>("untracked.hide", false))
+        opts.flags |= GIT_DIFF_INCLUDE_UNTRACKED;
+      if (ignoreWhitespace)
+        opts.flags |= GIT_DIFF_IGNORE_WHITESPACE;
+      if (git_index_caps(index) & GIT_INDEX_CAPABILITY_IGNORE_CASE)
+        opts.flags |= GIT_DIFF_IGNORE_CASE;
+
+      git_diff *copy = nullptr;
+      if (git_diff_tree_to_tree(&copy, d->repo, nullptr, nullptr, &opts))
+        return Diff();
+
+      Diff partial = diff;
+      diff = Diff(copy);
+      diff.merge(partial);
+    }
+
+    if (cached) {
+      QStringList dirty;
+      int count = workdir.count();
+      for (int i = 0; i < count; ++i)
+        dirty.append(workdir.name(i));
+      d->statusCache->finish(cache, dirty);
+    }
+
+    span.setArg("scanned", workdir.count());
+    diff.merge(workdir);
+
+  } else {
+    d->statusCache->finish(cache, QStringList());
+  }
+
   diff.setIndex(index);
+  span.setArg("files", diff.count());
 
   return diff.count() ? diff : Diff();
 }
 
+StatusCache::Stats Repository::statusCacheStats() const
+{
+  return d->statusCache->stats();
+}
+
+void Repository::invalidateStatusCache()
+{
+  d->statusCache->invalidate();
+}
+
 Diff Repository::diffTreeToIndex(
   const Tree &tree,
   const Index &index,
@@ -354,7 +763,8 @@ Diff Repository::diffTreeToIndex(
 Diff Repository::diffIndexToWorkdir(
   const Index &index,
   Diff::Callbacks *callbacks,
-  bool ignoreWhitespace) const
+  bool ignoreWhitespace,
+  const QStringList &paths) const
 {
   git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
   opts.flags |= (GIT_DIFF_DISABLE_MMAP);
@@ -365,9 +775,26 @@ Diff Repository::diffIndexToWorkdir(
 
   if (callbacks) {
     opts.progress_cb = &Diff::Callbacks::progress;
+    opts.notify_cb = &Diff::Callbacks::notify;
     opts.payload = callbacks;
   }
 
+  QVector<char *> rawPaths;
+  QVector<QByteArray> storage;
+  if (!paths.isEmpty()) {
+    // Literal paths let the workdir iterator skip
+    // directories that don't contain any of them.
+    opts.flags |= GIT_DIFF_DISABLE_PATHSPEC_MATCH;
+
+    foreach (const QString &path, paths) {
+      storage.append(path.toUtf8());
+      rawPaths.append(storage.last().data());
+    }
+
+    opts.pathspec.count = rawPaths.size();
+    opts.pathspec.strings = rawPaths.data();
+  }
+
   git_diff *diff = nullptr;
   git_diff_index_to_workdir(&diff, d->repo, index, &opts);
   return Diff(diff);
@@ -416,20 +843,39 @@ bool Repository::setHeadDetached(const Commit &commit)
   return !error;
 }
 
-QList<Reference> Repository::refs() const
+ReferenceSnapshot Repository::refSnapshot() const
 {
-  git_reference_iterator *it = nullptr;
-  if (git_reference_iterator_new(&it, d->repo))
-    return QList<Reference>();
+  RefCache *cache = d->refs;
+  QMutexLocker locker(&cache->mutex);
 
-  QList<Reference> refs;
-  git_reference *ref = nullptr;
-  while (!git_reference_next(&ref, it))
-    refs.append(Reference(ref));
+  QMap<QString,Stamp> stamps;
+  if (cache->check) {
+    cache->check = false;
+    stamps = cache->readStamps();
+    if (stamps != cache->stamps)
+      cache->stale = true;
+  }
 
-  git_reference_iterator_free(it);
+  if (cache->stale) {
+    // Stamp before reading so that concurrent writes are caught later.
+    cache->stamps = !stamps.isEmpty() ? stamps : cache->readStamps();
+    cache->snapshot = ReferenceSnapshot::read(d->repo, ++cache->version);
+    cache->stale = false;
+  }
 
-  return refs;
+  return cache->snapshot;
+}
+
+void Repository::invalidateRefs()
+{
+  RefCache *cache = d->refs;
+  QMutexLocker locker(&cache->mutex);
+  cache->check = true;
+}
+
+QList<Reference> Repository::refs() const
+{
+  return refSnapshot().refs();
 }
 
 Reference Repository::lookupRef(const QString &name) const
@@ -444,17 +890,12 @@ Reference Repository::lookupRef(const QString &name) const
 
 QList<Branch> Repository::branches(git_branch_t flags) const
 {
-  git_branch_iterator *it = nullptr;
-  if (git_branch_iterator_new(&it, d->repo, flags))
-    return QList<Branch>();
-
   QList<Branch> branches;
-  git_reference *ref = nullptr;
-  git_branch_t type = GIT_BRANCH_LOCAL;
-  while (!git_branch_next(&ref, &type, it))
-    branches.append(Branch(ref));
-
-  git_branch_iterator_free(it);
+  foreach (const Reference &ref, refSnapshot().refs()) {
+    if (((flags & GIT_BRANCH_LOCAL) && ref.isLocalBranch()) ||
+        ((flags & GIT_BRANCH_REMOTE) && ref.isRemoteBranch()))
+      branches.append(Branch(ref));
+  }
 
   return branches;
 }
@@ -500,21 +941,13 @@ Branch Repository::createBranch(
 
 QList<TagRef> Repository::tags() const
 {
-  git_reference_iterator *it = nullptr;
-  if (git_reference_iterator_new(&it, d->repo))
-    return QList<TagRef>();
-
-  QList<TagRef> refs;
-  git_reference *ref = nullptr;
-  while (!git_reference_next(&ref, it)) {
-    TagRef tag(ref);
-    if (tag.isValid())
-      refs.append(tag);
+  QList<TagRef> tags;
+  foreach (const Reference &ref, refSnapshot().refs()) {
+    if (ref.isTag())
+      tags.append(TagRef(ref));
   }
 
-  git_reference_iterator_free(it);
-
-  return refs;
+  return tags;
 }
 
 TagRef Repository::lookupTag(const QString &name) const
@@ -837,9 +1270,12 @@ Commit Repository::stash(const QString &message)
   return Commit(commit);
 }
 
-bool Repository::applyStash(int index)
+bool Repository::applyStash(int index, CheckoutCallbacks *callbacks)
 {
   git_stash_apply_options opts = GIT_STASH_APPLY_OPTIONS_INIT;
+  if (callbacks)
+    CheckoutCallbacks::init(&opts.checkout_options, callbacks);
+
   return !git_stash_apply(d->repo, index, &opts);
 }
 
@@ -854,13 +1290,16 @@ bool Repository::dropStash(int index)
   return !error;
 }
 
-bool Repository::popStash(int index)
+bool Repository::popStash(int index, CheckoutCallbacks *callbacks)
 {
   // The stash reference goes away when this is the last stash.
   // Signal that the previous saved reference changed instead.
   Reference ref = stashRef();
 
   git_stash_apply_options opts = GIT_STASH_APPLY_OPTIONS_INIT;
+  if (callbacks)
+    CheckoutCallbacks::init(&opts.checkout_options, callbacks);
+
   int error = git_stash_pop(d->repo, index, &opts);
   emit d->notifier->referenceUpdated(ref);
   return !error;
@@ -903,6 +1342,110 @@ Commit Repository::mergeBase(const Commit &lhs, const Commit &rhs) const
   return Commit(commit);
 }
 
+Index Repository::mergeTrees(const Commit &ours, const Commit &theirs) const
+{
+  // Commits without a common ancestor merge as if from an empty tree.
+  Tree base;
+  if (Commit commit = mergeBase(ours, theirs))
+    base = commit.tree();
+
+  Tree ourTree = ours.tree();
+  Tree theirTree = theirs.tree();
+  if (!ourTree.isValid() || !theirTree.isValid())
+    return Index();
+
+  git_index *index = nullptr;
+  git_merge_options opts = GIT_MERGE_OPTIONS_INIT;
+  git_merge_trees(&index, d->repo, base, ourTree, theirTree, &opts);
+  return Index(index);
+}
+
+bool Repository::predictConflicts(
+  const Commit &ours,
+  const Commit &theirs,
+  QStringList *paths) const
+{
+  if (!ours.isValid() || !theirs.isValid())
+    return false;
+
+  ConflictCache *cache = d->conflicts;
+  ConflictCache::Key key(ours.id(), theirs.id());
+
+  QMutexLocker locker(&cache->mutex);
+  auto it = cache->predictions.constFind(key);
+  if (it != cache->predictions.constEnd()) {
+    cache->used.removeOne(key);
+    cache->used.append(key);
+    if (paths)
+      *paths = *it;
+    return true;
+  }
+
+  // Don't try again to merge commits that can't be merged.
+  if (cache->failed.contains(key)) {
+    cache->used.removeOne(key);
+    cache->used.append(key);
+    return false;
+  }
+
+  // Callers ask again when other predictions finish.
+  if (cache->pending.contains(key) ||
+      cache->pending.size() >= kConflictPendingLimit)
+    return false;
+
+  cache->pending.insert(key);
+  locker.unlock();
+
+  // Merge in a separate repository so that the work doesn't contend
+  // with this one.
+  QString path = dir().path();
+  QSharedPointer<ConflictCache::Pending> pending(
+    new ConflictCache::Pending(*this, key));
+  auto predict = [pending, path, cache, key] {
+    Trace::Span span("git", "predictConflicts");
+    Index index;
+    if (Repository local = Repository::open(path))
+      index = local.mergeTrees(
+        local.lookupCommit(key.first), local.lookupCommit(key.second));
+
+    // Keys change whenever either tip moves, so old predictions
+    // are only dropped to bound the size of the cache.
+    QMutexLocker locker(&cache->mutex);
+    if (cache->used.size() >= kConflictCacheSize) {
+      ConflictCache::Key old = cache->used.takeFirst();
+      cache->predictions.remove(old);
+      cache->failed.remove(old);
+    }
+
+    // Remember failures too so that they aren't retried.
+    if (index.isValid()) {
+      QStringList paths = index.conflicts();
+      span.setArg("conflicts", paths.size());
+      cache->predictions.insert(key, paths);
+    } else {
+      cache->failed.insert(key);
+    }
+
+    cache->used.append(key);
+    locker.unlock();
+
+    emit pending->repo.notifier()->conflictsPredicted(key.first, key.second);
+  };
+
+  if (backgroundRunner) {
+    backgroundRunner(*this, predict);
+  } else {
+    QtConcurrent::run(predict);
+  }
+
+  return false;
+}
+
+int Repository::conflictCacheSize()
+{
+  return kConflictCacheSize;
+}
+
 bool Repository::merge(const AnnotatedCommit &mergeHead)
 {
   int current = state();
@@ -920,11 +1463,13 @@ bool Repository::merge(const AnnotatedCommit &mergeHead)
 Rebase Repository::rebase(
   const AnnotatedCommit &mergeHead,
   const QString &overrideUser,
-  const QString &overrideEmail
+  const QString &overrideEmail,
+  bool inmemory
 )
 {
   git_rebase *rebase = nullptr;
   git_rebase_options opts = GIT_REBASE_OPTIONS_INIT;
+  opts.inmemory = inmemory;
   git_rebase_init(&rebase, d->repo, nullptr, mergeHead, nullptr, &opts);
   return Rebase(d->repo, rebase, overrideUser, overrideEmail);
 }
@@ -948,17 +1493,43 @@ bool Repository::checkout(
   git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
   opts.checkout_strategy = strategy;
 
-  if (callbacks) {
-    opts.notify_flags = callbacks->flags();
-    opts.notify_cb = checkout_notify;
-    opts.notify_payload = callbacks;
+  if (callbacks)
+    CheckoutCallbacks::init(&opts, callbacks);
+
+  QVector<char *> rawPaths;
+  QVector<QByteArray> storage;
+  if (!paths.isEmpty()) {
+    // Paths are assumed to be exact matches.
+    opts.checkout_strategy |= GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH;
+
+    foreach (const QString &path, paths) {
+      storage.append(path.toUtf8());
+      rawPaths.append(storage.last().data());
+    }
 
-    opts.progress_cb = checkout_progress;
-    opts.progress_payload = callbacks;
+    opts.paths.count = rawPaths.size();
+    opts.paths.strings = rawPaths.data();
   }
 
+  // Decompressing objects is the most expensive part of writing
+  // files. Do it in parallel up front to warm the object cache.
+  if (paths.isEmpty() && commit.isValid())
+    prefetch(commit);
+
+  git_commit *tmp = commit;
+  git_object *obj = reinterpret_cast<git_object *>(tmp);
+  return !git_checkout_tree(d->repo, obj, &opts);
+}
+
+bool Repository::reset(
+  const Commit &commit,
+  git_reset_t type,
+  const QStringList &paths,
+  CheckoutCallbacks *callbacks)
+{
   QVector<char *> rawPaths;
   QVector<QByteArray> storage;
+  git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
   if (!paths.isEmpty()) {
     // Paths are assumed to be exact matches.
     opts.checkout_strategy |= GIT_CHECKOUT_DISABLE_PATHSPEC_MATCH;
@@ -972,9 +1543,23 @@ bool Repository::checkout(
     opts.paths.strings = rawPaths.data();
   }
 
+  if (callbacks)
+    CheckoutCallbacks::init(&opts, callbacks);
+
+  if (type == GIT_RESET_HARD && paths.isEmpty())
+    prefetch(commit);
+
+  int current = state();
   git_commit *tmp = commit;
   git_object *obj = reinterpret_cast<git_object *>(tmp);
-  return !git_checkout_tree(d->repo, obj, &opts);
+  int error = git_reset(d->repo, obj, type, &opts);
+  emit d->notifier->referenceUpdated(head());
+  if (state() != current) {
+    Patch::clearConflictResolutions(d->repo);
+    emit d->notifier->stateChanged();
+  }
+
+  return !error;
 }
 
 int Repository::state() const
@@ -1023,7 +1608,92 @@ QByteArray Repository::lfsSmudge(
   const QByteArray &lfsPointerText,
   const QString &file)
 {
-  return lfsExecute({"smudge", file}, lfsPointerText);
+  return lfsSmudge(QList<QByteArray>({lfsPointerText}), {file}).first();
+}
+
+QList<QByteArray> Repository::lfsSmudge(
+  const QList<QByteArray> &lfsPointerTexts,
+  const QStringList &files)
+{
+  // Look for objects in local storage first.
+  QList<QByteArray> results;
+  QMap<QByteArray,QList<int>> missing;
+  for (int i = 0; i < lfsPointerTexts.size(); ++i) {
+    const QByteArray &text = lfsPointerTexts.at(i);
+    QByteArray object = lfsObject(text);
+    results.append(object);
+    if (object.isNull())
+      missing[text].append(i);
+  }
+
+  if (missing.isEmpty())
+    return results;
+
+  QString path = QStandardPaths::findExecutable("git-lfs");
+  if (path.isEmpty()) {
+    emit d->notifier->lfsNotFound();
+    git_error_set_str(GIT_ERROR_INVALID, tr("git-lfs not found").toUtf8());
+    return results;
+  }
+
+  FilterProcess process(path, {"filter-process"}, workdir().path());
+  if (!process.isValid()) {
+    git_error_set_str(GIT_ERROR_INVALID, process.errorString().toUtf8());
+    return results;
+  }
+
+  // Paths have to be unique in each batch.
+  QList<QByteArray> texts = missing.keys();
+  while (!texts.isEmpty()) {
+    QSet<QByteArray> paths;
+    QList<FilterProcess::File> batch;
+    for (int i = 0; i < texts.size();) {
+      const QByteArray &text = texts.at(i);
+      QByteArray path = files.at(missing.value(text).first()).toUtf8();
+      if (paths.contains(path)) {
+        ++i;
+        continue;
+      }
+
+      paths.insert(path);
+      batch.append({path, texts.takeAt(i), QByteArray()});
+    }
+
+    if (!process.smudge(batch)) {
+      git_error_set_str(GIT_ERROR_INVALID, process.errorString().toUtf8());
+      break;
+    }
+
+    foreach (const FilterProcess::File &file, batch) {
+      foreach (int index, missing.value(file.input))
+        results[index] = file.output;
+    }
+  }
+
+  return results;
+}
+
+QByteArray Repository::lfsObject(const QByteArray &lfsPointerText) const
+{
+  QByteArray oid;
+  qint64 size = 0;
+  if (!lfsParsePointer(lfsPointerText, oid, size))
+    return QByteArray();
+
+  // Objects are stored by oid under the LFS storage dir.
+  QDir dir(git_repository_commondir(d->repo));
+  QString storage = config().value<QString>("lfs.storage");
+  QString base = dir.filePath(!storage.isEmpty() ? storage : "lfs");
+  QString name = QString("objects/%1/%2/%3").arg(
+    QString(oid.left(2)), QString(oid.mid(2, 2)), QString(oid));
+
+  QFile file(QDir(base).filePath(name));
+  if (file.size() != size || !file.open(QIODevice::ReadOnly))
+    return QByteArray();
+
+  // Empty objects are still valid.
+  QByteArray content = file.readAll();
+  return !content.isNull() ? content : QByteArray("");
 }
 
 QStringList Repository::lfsEnvironment()
@@ -1033,14 +1703,49 @@ QStringList Repository::lfsEnvironment()
 
 QStringList Repository::lfsTracked()
 {
-  QString output = lfsExecute({"track"});
-  QStringList lines = output.split('\n', QString::SkipEmptyParts);
-  if (!lines.isEmpty())
-    lines.removeFirst();
+  // Read patterns from attributes files instead of running git-lfs.
+  // Nested attributes files are found in a private copy of the index
+  // because this runs in the background. Their patterns are relative
+  // to their directory, like git-lfs reports them.
+  QStringList dirs = {QString()};
+  git_index *index = nullptr;
+  if (!git_index_open(&index, dir().filePath("index").toUtf8())) {
+    size_t count = git_index_entrycount(index);
+    for (size_t i = 0; i < count; ++i) {
+      QString path = git_index_get_byindex(index, i)->path;
+      if (path.endsWith("/.gitattributes"))
+        dirs.append(path.left(path.lastIndexOf('/') + 1));
+    }
+
+    git_index_free(index);
+  }
+
+  QList<QPair<QString,QString>> files;
+  foreach (const QString &prefix, dirs)
+    files.append({workdir().filePath(prefix + ".gitattributes"), prefix});
+  files.append({dir().filePath("info/attributes"), QString()});
 
   QStringList tracked;
-  foreach (const QString &line, lines)
-    tracked.append(line.trimmed().section(' ', 0, 0));
+  foreach (const auto &file, files) {
+    QFile dev(file.first);
+    if (!dev.open(QIODevice::ReadOnly | QIODevice::Text))
+      continue;
+
+    while (!dev.atEnd()) {
+      QString line = QString::fromUtf8(dev.readLine()).trimmed();
+      if (line.isEmpty() || line.startsWith('#'))
+        continue;
+
+      QStringList fields = line.split(QRegularExpression("\\s+"));
+      if (!fields.contains("filter=lfs"))
+        continue;
+
+      QString pattern = fields.first();
+      if (!file.second.isEmpty() && pattern.startsWith('/'))
+        pattern.remove(0, 1);
+      tracked.append(file.second + pattern);
+    }
+  }
 
   return tracked;
 }
@@ -1117,6 +1822,38 @@ QString Repository::lastError(const QString &defaultError)
   return err ? err->message : tr("Unknown error");
 }
 
+bool Repository::lfsParsePointer(
+  const QByteArray &lfsPointerText,
+  QByteArray &oid,
+  qint64 &size)
+{
+  // Pointers are small. Don't bother splitting large content.
+  if (lfsPointerText.length() > kLfsPointerMaxSize)
+    return false;
+
+  QList<QByteArray> lines = lfsPointerText.split('\n');
+  QByteArray version = lines.value(0);
+  if (version != "version https://git-lfs.github.com/spec/v1" &&
+      version != "version https://hawser.github.com/spec/v1")
+    return false;
+
+  oid.clear();
+  size = -1;
+  foreach (const QByteArray &line, lines) {
+    if (line.startsWith("oid sha256:")) {
+      oid = line.mid(11);
+    } else if (line.startsWith("size ")) {
+      bool ok = false;
+      size = line.mid(5).toLongLong(&ok);
+      if (!ok)
+        size = -1;
+    }
+  }
+
+  QRegularExpression re("^[0-9a-f]{64}$");
+  return (size >= 0 && re.match(QString::fromLatin1(oid)).hasMatch());
+}
+
 QDir Repository::appDir(const QDir &dir)
 {
   QDir app = dir;
@@ -1173,6 +1910,17 @@ void Repository::shutdown()
   git_libgit2_shutdown();
 }
 
+void Repository::enablePrefetchCache()
+{
+  git_libgit2_opts(
+    GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJECT_BLOB, kPrefetchBlobSize);
+}
+
+void Repository::setBackgroundRunner(const BackgroundRunner &runner)
+{
+  backgroundRunner = runner;
+}
+
 RepositoryNotifier::RepositoryNotifier(QObject *parent)
   : QObject(parent)
 {}
@@ -1190,6 +1938,56 @@ void Repository::ensureSubmodulesCached() const
   }
 }
 
+void Repository::prefetch(const Commit &commit) const
+{
+  Tree tree;
+  if (Reference ref = head()) {
+    if (Commit head = ref.target())
+      tree = head.tree();
+  }
+
+  git_diff *diff = nullptr;
+  git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+  if (git_diff_tree_to_tree(&diff, d->repo, tree, commit.tree(), &opts))
+    return;
+
+  QVector<Id> ids;
+  qint64 total = 0;
+  int count = git_diff_num_deltas(diff);
+  for (int i = 0; i < count; ++i) {
+    const git_diff_delta *delta = git_diff_get_delta(diff, i);
+    const git_diff_file &file = delta->new_file;
+    if (delta->status == GIT_DELTA_DELETED ||
+        file.mode == GIT_FILEMODE_COMMIT ||
+        file.size > kPrefetchBlobSize)
+      continue;
+
+    total += file.size;
+    if (total > kPrefetchTotalSize)
+      break;
+
+    ids.append(file.id);
+  }
+
+  git_diff_free(diff);
+
+  if (ids.size() < kPrefetchMin)
+    return;
+
+  // The object database is safe to read concurrently.
+  git_odb *odb = nullptr;
+  if (git_repository_odb(&odb, d->repo))
+    return;
+
+  QtConcurrent::blockingMap(ids, [odb](const Id &id) {
+    git_odb_object *obj = nullptr;
+    if (!git_odb_read(&obj, odb, id))
+      git_odb_object_free(obj);
+  });
+
+  git_odb_free(odb);
+}
+
 QByteArray Repository::lfsExecute(
   const QStringList &args,
   const QByteArray &input) const
@@ -16,6 +16,7 @@
 #include "Commit.h"
 #include "Diff.h"
 #include "Index.h"
+#include "StatusCache.h"
 #include "git2/checkout.h"
 #include "git2/errors.h"
 #include "git2/revwalk.h"
@@ -25,6 +26,7 @@
 #include <QObject>
 #include <QSet>
 #include <QSharedPointer>
+#include <functional>
 
 struct git_repository;
 class QProcess;
@@ -37,6 +39,7 @@ class FilterList;
 class Id;
 class Rebase;
 class Reference;
+class ReferenceSnapshot;
 class Remote;
 class RepositoryNotifier;
 class RevWalk;
@@ -63,6 +66,29 @@ public:
     }
 
     virtual void progress(const QString &path, int current, int total) {}
+
+    // Checkout can only be canceled before it starts writing files.
+    virtual bool isCanceled() const
+    {
+      return false;
+    }
+
+    // Set checkout options to call back to the given callbacks.
+    static void init(git_checkout_options *opts, CheckoutCallbacks *cbs);
+
+    static int notify(
+      git_checkout_notify_t why,
+      const char *path,
+      const git_diff_file *baseline,
+      const git_diff_file *target,
+      const git_diff_file *workdir,
+      void *payload);
+
+    static void progress(
+      const char *path,
+      size_t current,
+      size_t total,
+      void *payload);
   };
 
   Repository();
@@ -83,6 +109,9 @@ public:
 
   // config
   Config config() const;
+
+  // The app config is a cached read snapshot. It's replaced when the
+  // files change on disk or after a write through any config.
   Config appConfig() const;
 
   // bare
@@ -103,10 +132,17 @@ public:
   void setIndex(const Index &index);
 
   // status/diff
+  // If paths is non-empty, only those workdir paths are examined.
+  // The caller is responsible for including every path that may
+  // differ from the index (e.g. the paths of the previous status).
   Diff status(
     const Index &index,
     Diff::Callbacks *callbacks,
-    bool ignoreWhitespace = false) const;
+    bool ignoreWhitespace = false,
+    const QStringList &paths = QStringList()) const;
+  StatusCache::Stats statusCacheStats() const;
+  void invalidateStatusCache();
+
   Diff diffTreeToIndex(
     const Tree &tree,
     const Index &index = Index(),
@@ -114,9 +150,16 @@ public:
   Diff diffIndexToWorkdir(
     const Index &index = Index(),
     Diff::Callbacks *callbacks = nullptr,
-    bool ignoreWhitespace = false) const;
+    bool ignoreWhitespace = false,
+    const QStringList &paths = QStringList()) const;
 
   // refs
+  // References are read from a shared snapshot that's updated as
+  // references are changed through this repository. Invalidating
+  // checks for changes made outside of the repository on next read.
+  ReferenceSnapshot refSnapshot() const;
+  void invalidateRefs();
+
   QList<Reference> refs() const;
   Reference lookupRef(const QString &name) const;
 
@@ -183,9 +226,9 @@ public:
   Reference stashRef() const;
   QList<Commit> stashes() const;
   Commit stash(const QString &message = QString());
-  bool applyStash(int index = 0);
+  bool applyStash(int index = 0, CheckoutCallbacks *callbacks = nullptr);
   bool dropStash(int index = 0);
-  bool popStash(int index = 0);
+  bool popStash(int index = 0, CheckoutCallbacks *callbacks = nullptr);
 
   // blame
   Blame blame(
@@ -199,10 +242,32 @@ public:
   // merge/rebase
   Commit mergeBase(const Commit &lhs, const Commit &rhs) const;
   bool merge(const AnnotatedCommit &mergeHead);
+
+  // Merge the trees of the given commits at their merge base into a
+  // new in-memory index. The working directory and index are untouched.
+  Index mergeTrees(const Commit &ours, const Commit &theirs) const;
+
+  // Predict the paths that conflict when theirs is merged into ours.
+  // Predictions are cached by both commits. Missing predictions are
+  // made on a background thread and reported by conflictsPredicted.
+  // Returns false if the prediction isn't available yet or the
+  // commits can't be merged.
+  bool predictConflicts(
+    const Commit &ours,
+    const Commit &theirs,
+    QStringList *paths = nullptr) const;
+
+  // The number of predictions that are kept before the least
+  // recently used are dropped.
+  static int conflictCacheSize();
+
+  // An in-memory rebase only writes objects. It doesn't touch the
+  // working directory, index, or references, even when it finishes.
   Rebase rebase(
     const AnnotatedCommit &mergeHead,
     const QString &overrideUser = QString(),
-    const QString &overrideEmail = QString()
+    const QString &overrideEmail = QString(),
+    bool inmemory = false
   );
 
   // cherry-pick
@@ -215,6 +280,13 @@ public:
     const QStringList &paths = QStringList(),
     int strategy = GIT_CHECKOUT_SAFE);
 
+  // reset
+  bool reset(
+    const Commit &commit,
+    git_reset_t type = GIT_RESET_MIXED,
+    const QStringList &paths = QStringList(),
+    CheckoutCallbacks *callbacks = nullptr);
+
   // Clean up after merge/rebase/cherry-pick/etc.
   int state() const;
   void cleanupState();
@@ -231,7 +303,16 @@ public:
   bool lfsInitialize();
   bool lfsDeinitialize();
 
+  // Objects that are in local LFS storage are read directly. Missing
+  // objects are smudged together through a single git-lfs process.
   QByteArray lfsSmudge(const QByteArray &lfsPointerText, const QString &file);
+  QList<QByteArray> lfsSmudge(
+    const QList<QByteArray> &lfsPointerTexts,
+    const QStringList &files);
+
+  // Read the object from local LFS storage. Returns a null array
+  // if the pointer is invalid or the object hasn't been downloaded.
+  QByteArray lfsObject(const QByteArray &lfsPointerText) const;
 
   QStringList lfsEnvironment();
   QStringList lfsTracked();
@@ -245,6 +326,12 @@ public:
   static int lastErrorKind();
   static QString lastError(const QString &defaultError = QString());
 
+  // Parse the oid and size out of LFS pointer text.
+  static bool lfsParsePointer(
+    const QByteArray &lfsPointerText,
+    QByteArray &oid,
+    qint64 &size);
+
   // Get the app dir for the given git dir.
   static QDir appDir(const QDir &dir);
 
@@ -255,7 +342,23 @@ public:
   static void init();
   static void shutdown();
 
+  // Keep blobs up to the prefetch size in the object cache so that the
+  // blobs read before a checkout are still there when it writes them.
+  // The cache limit is global to the process, so call this once.
+  static void enablePrefetchCache();
+
+  // Run low priority background work, such as conflict predictions,
+  // through the given function instead of the global thread pool. The
+  // function is called with the repository that the work is for.
+  using BackgroundRunner =
+    std::function<void(const Repository &, const std::function<void()> &)>;
+  static void setBackgroundRunner(const BackgroundRunner &runner);
+
 private:
+  struct AppConfigCache;
+  struct ConflictCache;
+  struct RefCache;
+
   struct Data
   {
     Data(git_repository *repo);
@@ -271,6 +374,11 @@ private:
     bool lfsLocksCached = false;
 
     QSet<Id> starredCommits;
+
+    StatusCache *statusCache;
+    AppConfigCache *appConfig;
+    ConflictCache *conflicts;
+    RefCache *refs;
   };
 
   Repository(git_repository *repo);
@@ -278,6 +386,9 @@ private:
 
   void ensureSubmodulesCached() const;
 
+  // Read the blobs that checking out the given commit will write.
+  void prefetch(const Commit &commit) const;
+
   QByteArray lfsExecute(
     const QStringList &args,
     const QByteArray &input = QByteArray()) const;
@@ -322,18 +433,28 @@ signals:
   void remoteRemoved(const QString &name);
 
   void stateChanged();
-  void workdirChanged();
+
+  // The paths are relative to the workdir. An empty
+  // list means that anything in the workdir may have changed.
+  void workdirChanged(const QStringList &paths = QStringList());
 
   void directoryStaged();
   void directoryAboutToBeStaged(
     const QString &dir, int count, bool &allow);
   void largeFileAboutToBeStaged(
     const QString &path, int size, bool &allow);
+  // Emitted before the index is written.
+  void indexAboutToBeChanged();
   void indexChanged(const QStringList &paths, bool yieldFocus = true);
   void indexStageError(const QString &path);
 
   void lfsNotFound();
   void lfsLocksChanged();
+
+  void appConfigChanged();
+
+  // This may be emitted from a background thread.
+  void conflictsPredicted(const Id &ours, const Id &theirs);
 };
 
 } // namespace git
@@ -0,0 +1,276 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "StatusCache.h"
+#include "git2/index.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+
+namespace git {
+
+namespace {
+
+const quint32 kMagic = 0x53544331; // STC1
+
+const QString kIgnoreFile = ".gitignore";
+const QString kAttributesFile = ".gitattributes";
+const QString kExcludeFile = "info/exclude";
+
+// Recently modified directories are always rescanned.
+const qint64 kRacy = -2;
+const qint64 kRacyInterval = 2000;
+
+QString parentDir(const QString &path)
+{
+  int index = path.lastIndexOf('/');
+  return (index < 0) ? QString() : path.left(index);
+}
+
+QString join(const QString &dir, const QString &name)
+{
+  return dir.isEmpty() ? name : QString("%1/%2").arg(dir, name);
+}
+
+qint64 entryTime(const git_index_entry *entry)
+{
+  return (qint64(entry->mtime.seconds) * 1000) +
+         (entry->mtime.nanoseconds / 1000000);
+}
+
+} // anon. namespace
+
+StatusCache::StatusCache(
+  const QDir &workdir,
+  const QDir &gitdir,
+  const QString &path)
+  : mWorkdir(workdir), mGitdir(gitdir), mPath(path)
+{}
+
+StatusCache::Scan StatusCache::start(
+  git_index *index,
+  const QString &key,
+  QStringList &paths)
+{
+  QMutexLocker locker(&mMutex);
+
+  if (!mLoaded)
+    load();
+
+  Scan scan;
+  scan.key = key;
+  scan.sequence = ++mSequence;
+
+  // Snapshot directory times before the scan starts. Anything that
+  // changes during the scan will be detected on the next status.
+  QSet<QString> tracked;
+  QHash<QString,qint64> dirs;
+  QHash<QString,qint64> ignores;
+  size_t count = git_index_entrycount(index);
+  for (size_t i = 0; i < count; ++i) {
+    const git_index_entry *entry = git_index_get_byindex(index, i);
+    QString path = QString::fromUtf8(entry->path);
+    tracked.insert(path);
+
+    QString dir = parentDir(path);
+    while (!dirs.contains(dir)) {
+      dirs.insert(dir, mtime(dir));
+      QString ignore = join(dir, kIgnoreFile);
+      ignores.insert(ignore, mtime(ignore));
+      if (dir.isEmpty())
+        break;
+
+      dir = parentDir(dir);
+    }
+  }
+
+  if (!dirs.contains(QString())) {
+    dirs.insert(QString(), mtime(QString()));
+    ignores.insert(kIgnoreFile, mtime(kIgnoreFile));
+  }
+
+  ignores.insert(kExcludeFile, time(mGitdir.filePath(kExcludeFile)));
+
+  // Times that are too close to now could still change within the same
+  // tick without being detected. Record them so that they always miss.
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  auto settle = [now](const QHash<QString,qint64> &times) {
+    QHash<QString,qint64> result = times;
+    for (auto it = result.begin(); it != result.end(); ++it) {
+      if (it.value() >= 0 && now - it.value() < kRacyInterval)
+        it.value() = kRacy;
+    }
+
+    return result;
+  };
+
+  scan.dirs = settle(dirs);
+  scan.ignores = settle(ignores);
+
+  // Changes to ignore rules can affect any untracked path.
+  if (!mValid || mKey != key || mIgnores != ignores) {
+    mStats.scans++;
+    return scan;
+  }
+
+  QSet<QString> result = QSet<QString>(mDirty.begin(), mDirty.end());
+
+  // Look for entries that were added to or removed from changed
+  // directories. Unchanged directories don't need to be enumerated.
+  QDir::Filters filters =
+    QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot;
+  for (auto it = dirs.constBegin(); it != dirs.constEnd(); ++it) {
+    if (it.value() == mDirs.value(it.key(), kRacy)) {
+      mStats.hits++;
+      continue;
+    }
+
+    mStats.misses++;
+
+    // The directory itself is gone.
+    if (it.value() < 0) {
+      result.insert(it.key());
+      continue;
+    }
+
+    QDir dir(mWorkdir.filePath(it.key()));
+    foreach (const QString &name, dir.entryList(filters)) {
+      if (it.key().isEmpty() && name == ".git")
+        continue;
+
+      QString path = join(it.key(), name);
+      if (tracked.contains(path) || dirs.contains(path))
+        continue;
+
+      // A new attributes file can affect anything.
+      if (name == kAttributesFile && !result.contains(path)) {
+        mStats.scans++;
+        return scan;
+      }
+
+      result.insert(path);
+    }
+  }
+
+  // Check tracked files against the index stat data. Entries that
+  // were modified in the same tick as the index was written are racy.
+  qint64 indexTime = time(mGitdir.filePath("index"));
+  for (size_t i = 0; i < count; ++i) {
+    const git_index_entry *entry = git_index_get_byindex(index, i);
+    QString path = QString::fromUtf8(entry->path);
+    if (result.contains(path))
+      continue;
+
+    // Submodules, symlinks and conflicts are always checked.
+    if (entry->mode == GIT_FILEMODE_COMMIT ||
+        entry->mode == GIT_FILEMODE_LINK ||
+        git_index_entry_stage(entry) != 0) {
+      result.insert(path);
+      continue;
+    }
+
+    QFileInfo info(mWorkdir.filePath(path));
+    qint64 time = entryTime(entry);
+    if (!info.exists() || time >= indexTime ||
+        info.size() != entry->file_size ||
+        info.lastModified().toMSecsSinceEpoch() != time) {
+      result.insert(path);
+      continue;
+    }
+
+#ifndef Q_OS_WIN
+    bool executable = (entry->mode == GIT_FILEMODE_BLOB_EXECUTABLE);
+    if (info.isExecutable() != executable)
+      result.insert(path);
+#endif
+  }
+
+  paths = result.values();
+  scan.cached = true;
+  return scan;
+}
+
+void StatusCache::finish(const Scan &scan, const QStringList &dirty)
+{
+  QMutexLocker locker(&mMutex);
+
+  // A newer scan already recorded a more recent state.
+  if (scan.sequence <= mFinished)
+    return;
+
+  mFinished = scan.sequence;
+  mKey = scan.key;
+  mDirty = dirty;
+  mDirs = scan.dirs;
+  mIgnores = scan.ignores;
+  mValid = true;
+
+  save();
+}
+
+void StatusCache::invalidate()
+{
+  QMutexLocker locker(&mMutex);
+  mFinished = mSequence;
+  mValid = false;
+  mDirs.clear();
+  mIgnores.clear();
+  mDirty.clear();
+  QFile::remove(mPath);
+}
+
+StatusCache::Stats StatusCache::stats() const
+{
+  QMutexLocker locker(&mMutex);
+  return mStats;
+}
+
+void StatusCache::load()
+{
+  mLoaded = true;
+
+  QFile file(mPath);
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+
+  quint32 magic = 0;
+  QDataStream in(&file);
+  in >> magic;
+  if (magic != kMagic)
+    return;
+
+  in >> mKey >> mDirty >> mDirs >> mIgnores;
+  mValid = (in.status() == QDataStream::Ok);
+}
+
+void StatusCache::save() const
+{
+  QSaveFile file(mPath);
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+
+  QDataStream out(&file);
+  out << kMagic << mKey << mDirty << mDirs << mIgnores;
+  file.commit();
+}
+
+qint64 StatusCache::mtime(const QString &path) const
+{
+  return time(mWorkdir.filePath(path));
+}
+
+qint64 StatusCache::time(const QString &path)
+{
+  QFileInfo info(path);
+  return info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+} // namespace git
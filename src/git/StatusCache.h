@@ -0,0 +1,98 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#ifndef STATUSCACHE_H
+#define STATUSCACHE_H
+
+#include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+struct git_index;
+
+namespace git {
+
+// A persistent cache of workdir state modeled on git's untracked
+// cache. It records the modification time of every directory that
+// contains tracked files and the dirty paths of the last status. A
+// directory whose mtime hasn't changed can't have gained or lost any
+// entries, so it doesn't need to be enumerated for untracked files.
+// Tracked files are checked against the stat data in the index.
+class StatusCache
+{
+public:
+  struct Stats
+  {
+    int hits = 0;
+    int misses = 0;
+    int scans = 0;
+  };
+
+  // The state of one status run between start() and finish(). Each
+  // caller holds its own, so concurrent runs don't interfere.
+  struct Scan
+  {
+    // The paths from start() can be used instead of a full scan.
+    bool cached = false;
+
+    int sequence = 0;
+    QString key;
+    QHash<QString,qint64> dirs;
+    QHash<QString,qint64> ignores;
+  };
+
+  StatusCache(const QDir &workdir, const QDir &gitdir, const QString &path);
+
+  // Get the paths that need to be examined for the given index. The
+  // result isn't cached if a full scan is needed. Pass the result back
+  // to finish() when the status completes or just drop it to abort.
+  // The key identifies the options that affect the result.
+  Scan start(git_index *index, const QString &key, QStringList &paths);
+
+  // Record the dirty paths of a completed status diff. Scans that
+  // started before the last recorded scan or invalidation are ignored.
+  void finish(const Scan &scan, const QStringList &dirty);
+
+  // Discard the cache.
+  void invalidate();
+
+  Stats stats() const;
+
+private:
+  void load();
+  void save() const;
+
+  // Get the modification time of a workdir relative path.
+  qint64 mtime(const QString &path) const;
+
+  static qint64 time(const QString &path);
+
+  QDir mWorkdir;
+  QDir mGitdir;
+  QString mPath;
+
+  bool mLoaded = false;
+  bool mValid = false;
+
+  QString mKey;
+  QStringList mDirty;
+  QHash<QString,qint64> mDirs;
+  QHash<QString,qint64> mIgnores;
+
+  int mSequence = 0;
+  int mFinished = 0;
+
+  Stats mStats;
+  mutable QMutex mMutex;
+};
+
+} // namespace git
+
+#endif
@@ -52,6 +52,12 @@ Object Tree::object(int index) const
   return Object(obj);
 }
 
+git_filemode_t Tree::mode(int index) const
+{
+  const git_tree_entry *entry = git_tree_entry_byindex(*this, index);
+  return git_tree_entry_filemode(entry);
+}
+
 Id Tree::id(const QString &path) const
 {
   git_tree_entry *entry = nullptr;
@@ -25,6 +25,10 @@ public:
   QString name(int index) const;
   Object object(int index) const;
 
+  // The file mode distinguishes trees and submodules
+  // without looking up the object.
+  git_filemode_t mode(int index) const;
+
   Id id(const QString &path) const;
 
 private:
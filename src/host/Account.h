@@ -86,7 +86,10 @@ public:
     bool canModify)
   {}
 
+  // Request comments for a single commit or a batch of commits.
+  // Comments are reported through commentsReady for each commit.
   virtual void requestComments(Repository *repo, const QString &oid) {}
+  virtual void requestComments(Repository *repo, const QStringList &oids) {}
 
   virtual void authorize();
   virtual bool isAuthorizeSupported();
@@ -11,7 +11,9 @@
 #include "Repository.h"
 #include <QCoreApplication>
 #include <QDesktopServices>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -20,6 +22,8 @@
 #include <QNetworkRequest>
 #include <QRandomGenerator>
 #include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QUrl>
 #include <QUrlQuery>
 
@@ -37,6 +41,68 @@ const QString kAccessUrl =
 const QString kGraphQlUrl =
   QStringLiteral("https://api.github.com/graphql");
 
+// Comments are requested for this many commits at once.
+const int kCommentBatchSize = 25;
+const int kCommentPageSize = 100;
+
+// Comments checked more recently than this are used without a request.
+const int kCommentMaxAge = 60;
+
+// Only the first page of comments is validated. Commits with more
+// comments than that are fetched again after this long.
+const int kCommentRefetchAge = 60 * 60;
+
+const QString kCommentFields =
+  "path position publishedAt updatedAt body author { login }";
+
+const QString kCommentsDir = "comments";
+
+Account::CommitComments parseComments(const QJsonArray &nodes)
+{
+  Account::CommitComments comments;
+  foreach (const QJsonValue &value, nodes) {
+    QJsonObject obj = value.toObject();
+    QString path = obj.value("path").toString();
+    int position = obj.value("position").toInt() - 1;
+
+    QString raw = obj.value("body").toString();
+    QString body = raw.trimmed().replace("\r\n", "\n");
+
+    QJsonObject author = obj.value("author").toObject();
+    QString login = author.value("login").toString();
+
+    QString published = obj["publishedAt"].toString();
+    QDateTime date = QDateTime::fromString(published, Qt::ISODate);
+
+    Account::Comments &map = path.isEmpty() ?
+    comments.comments : comments.files[path][position];
+    map.insert(date, {body, login});
+  }
+
+  return comments;
+}
+
+// Get the latest update time of the first limit comments.
+QString latestUpdate(const QJsonArray &nodes, int limit)
+{
+  QString latest;
+  int count = qMin(nodes.size(), limit);
+  for (int i = 0; i < count; ++i) {
+    QJsonObject node = nodes.at(i).toObject();
+    latest = qMax(latest, node.value("updatedAt").toString());
+  }
+
+  return latest;
+}
+
+QString commentCachePath(const QString &host, Repository *repo)
+{
+  QDir dir =
+    QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  QString name = QString(repo->fullName()).replace('/', '_');
+  return dir.filePath(QString("%1/%2/%3.json").arg(kCommentsDir, host, name));
+}
+
 } // anon. namespace
 
 GitHub::GitHub(const QString &username)
@@ -287,61 +353,247 @@ void GitHub::createPullRequest(
 
 void GitHub::requestComments(Repository *repo, const QString &oid)
 {
-  QString query = QString(
-    "query {"
-    "  repository(owner: \"%1\", name: \"%2\") {"
-    "    object(oid: \"%3\") {"
-    "      ... on Commit {"
-    "        comments(first: 50) {"
-    "          nodes {"
-    "            path"
-    "            position"
-    "            publishedAt"
-    "            body"
-    "            author {"
-    "              login"
-    "            }"
-    "          }"
-    "        }"
-    "      }"
-    "    }"
-    "  }"
-    "}").arg(repo->owner(), repo->name(), oid);
+  requestComments(repo, QStringList(oid));
+}
 
-  graphql(query, [this, repo, oid](const QJsonObject &data) {
-    QJsonArray nodes = data
-    .value("repository").toObject()
-    .value("object").toObject()
-    .value("comments").toObject()
-    .value("nodes").toArray();
+void GitHub::requestComments(Repository *repo, const QStringList &oids)
+{
+  if (mAccessToken.isEmpty())
+    return;
 
-    if (nodes.isEmpty())
-      return;
+  // Use comments that were checked recently.
+  QDateTime now = QDateTime::currentDateTimeUtc();
+  CommentCache &cache = commentCache(repo);
+  QStringList stale;
+  foreach (const QString &oid, oids) {
+    CommentCache::const_iterator it = cache.constFind(oid);
+    if (it != cache.constEnd() && it->checked.isValid() &&
+        it->checked.secsTo(now) < kCommentMaxAge) {
+      emitComments(repo, oid);
+      continue;
+    }
+
+    // Coalesce with the request that's already in flight.
+    QString key = repo->fullName() + ':' + oid;
+    if (!mPendingComments.contains(key) && !stale.contains(oid)) {
+      mPendingComments.insert(key);
+      stale.append(oid);
+    }
+  }
+
+  // Request the first page of comments for each uncached commit in one
+  // aliased query. GraphQL responses don't carry ETags, so cached
+  // commits only ask for the count and the update time of each comment
+  // on the first page. An edit to any of them changes the latest time.
+  for (int first = 0; first < stale.size(); first += kCommentBatchSize) {
+    QStringList batch = stale.mid(first, kCommentBatchSize);
+
+    QStringList fields;
+    QSet<QString> validate;
+    for (int i = 0; i < batch.size(); ++i) {
+      const QString &oid = batch.at(i);
+      QString comments =
+        QString("comments(first: %1) {"
+                "  totalCount"
+                "  pageInfo { hasNextPage endCursor }"
+                "  nodes { %2 }"
+                "}").arg(kCommentPageSize).arg(kCommentFields);
+      const CachedComments entry = cache.value(oid);
+      bool expired = (entry.count > kCommentPageSize &&
+                      (!entry.fetched.isValid() ||
+                       entry.fetched.secsTo(now) >= kCommentRefetchAge));
+      if (entry.count > 0 && !expired) {
+        comments =
+          QString("comments(first: %1) { totalCount nodes { updatedAt } }")
+          .arg(kCommentPageSize);
+        validate.insert(oid);
+      }
+
+      fields.append(
+        QString("c%1: object(oid: \"%2\") { ... on Commit { %3 } }")
+        .arg(i).arg(oid, comments));
+    }
+
+    QString query =
+      QString("query { repository(owner: \"%1\", name: \"%2\") { %3 } }")
+      .arg(repo->owner(), repo->name(), fields.join(' '));
+
+    graphql(query, [this, repo, batch, validate](const QJsonObject &data) {
+      QJsonObject repository = data.value("repository").toObject();
+      for (int i = 0; i < batch.size(); ++i) {
+        const QString &oid = batch.at(i);
+        QJsonObject comments = repository
+        .value(QString("c%1").arg(i)).toObject()
+        .value("comments").toObject();
+
+        if (comments.isEmpty()) {
+          mPendingComments.remove(repo->fullName() + ':' + oid);
+          continue;
+        }
+
+        int count = comments.value("totalCount").toInt();
+        QJsonArray nodes = comments.value("nodes").toArray();
+        if (validate.contains(oid)) {
+          // Request everything again if anything changed.
+          CachedComments &entry = commentCache(repo)[oid];
+          if (count != entry.count ||
+              latestUpdate(nodes, kCommentPageSize) !=
+              latestUpdate(entry.nodes, kCommentPageSize)) {
+            fetchComments(repo, oid, QString(), QJsonArray());
+            continue;
+          }
+
+          mPendingComments.remove(repo->fullName() + ':' + oid);
+          entry.checked = QDateTime::currentDateTimeUtc();
+          emitComments(repo, oid);
+          continue;
+        }
+
+        QJsonObject pageInfo = comments.value("pageInfo").toObject();
+        if (pageInfo.value("hasNextPage").toBool()) {
+          QString cursor = pageInfo.value("endCursor").toString();
+          fetchComments(repo, oid, cursor, nodes);
+          continue;
+        }
+
+        finishComments(repo, oid, count, nodes);
+      }
+    });
+  }
+}
+
+GitHub::CommentCache &GitHub::commentCache(Repository *repo)
+{
+  QMap<Repository *,CommentCache>::iterator it = mComments.find(repo);
+  if (it != mComments.end())
+    return *it;
+
+  // Load comments from the last session. They're checked again
+  // before they're used.
+  CommentCache &cache = mComments[repo];
+  QFile file(commentCachePath(host(), repo));
+  if (!file.open(QFile::ReadOnly))
+    return cache;
+
+  QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+  for (auto it = obj.constBegin(), end = obj.constEnd(); it != end; ++it) {
+    QJsonObject value = it.value().toObject();
+    CachedComments &entry = cache[it.key()];
+    entry.count = value.value("count").toInt();
+    entry.nodes = value.value("nodes").toArray();
+    entry.fetched =
+      QDateTime::fromString(value.value("fetched").toString(), Qt::ISODate);
+  }
+
+  return cache;
+}
+
+void GitHub::storeCommentCache(Repository *repo)
+{
+  // Only store commits that have comments.
+  QJsonObject obj;
+  const CommentCache &cache = mComments.value(repo);
+  for (auto it = cache.constBegin(), end = cache.constEnd(); it != end; ++it) {
+    if (it->count > 0) {
+      obj.insert(it.key(), QJsonObject({
+        {"count", it->count},
+        {"nodes", it->nodes},
+        {"fetched", it->fetched.toString(Qt::ISODate)}
+      }));
+    }
+  }
+
+  QFileInfo info(commentCachePath(host(), repo));
+  if (!info.dir().mkpath("."))
+    return;
+
+  QSaveFile file(info.filePath());
+  if (!file.open(QFile::WriteOnly))
+    return;
 
-    CommitComments comments;
-    foreach(const QJsonValue &value, nodes) {
-      QJsonObject obj = value.toObject();
-      QString path = obj.value("path").toString();
-      int position = obj.value("position").toInt() - 1;
+  file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+  file.commit();
+}
 
-      QString raw = obj.value("body").toString();
-      QString body = raw.trimmed().replace("\r\n", "\n");
+void GitHub::fetchComments(
+  Repository *repo,
+  const QString &oid,
+  const QString &cursor,
+  const QJsonArray &nodes)
+{
+  QString after = cursor.isEmpty() ? QString() :
+    QString(", after: \"%1\"").arg(cursor);
+
+  QString query =
+    QString("query {"
+            "  repository(owner: \"%1\", name: \"%2\") {"
+            "    object(oid: \"%3\") {"
+            "      ... on Commit {"
+            "        comments(first: %4%5) {"
+            "          totalCount"
+            "          pageInfo { hasNextPage endCursor }"
+            "          nodes { %6 }"
+            "        }"
+            "      }"
+            "    }"
+            "  }"
+            "}").arg(repo->owner(), repo->name(), oid)
+                .arg(kCommentPageSize).arg(after, kCommentFields);
+
+  graphql(query, [this, repo, oid, nodes](const QJsonObject &data) {
+    QJsonObject comments = data.value("repository").toObject()
+    .value("object").toObject()
+    .value("comments").toObject();
 
-      QJsonObject author = obj.value("author").toObject();
-      QString login = author.value("login").toString();
+    if (comments.isEmpty()) {
+      mPendingComments.remove(repo->fullName() + ':' + oid);
+      return;
+    }
 
-      QString published = obj["publishedAt"].toString();
-      QDateTime date = QDateTime::fromString(published, Qt::ISODate);
+    QJsonArray all = nodes;
+    foreach (const QJsonValue &node, comments.value("nodes").toArray())
+      all.append(node);
 
-      Comments &map = path.isEmpty() ?
-      comments.comments : comments.files[path][position];
-      map.insert(date, {body, login});
+    QJsonObject pageInfo = comments.value("pageInfo").toObject();
+    if (pageInfo.value("hasNextPage").toBool()) {
+      fetchComments(repo, oid, pageInfo.value("endCursor").toString(), all);
+      return;
     }
 
-    emit commentsReady(repo, oid, comments);
+    finishComments(repo, oid, comments.value("totalCount").toInt(), all);
   });
 }
 
+void GitHub::finishComments(
+  Repository *repo,
+  const QString &oid,
+  int count,
+  const QJsonArray &nodes)
+{
+  mPendingComments.remove(repo->fullName() + ':' + oid);
+
+  CommentCache &cache = commentCache(repo);
+  CachedComments &entry = cache[oid];
+  bool changed = (count != entry.count || nodes != entry.nodes);
+
+  QDateTime now = QDateTime::currentDateTimeUtc();
+  entry.count = count;
+  entry.nodes = nodes;
+  entry.fetched = now;
+  entry.checked = now;
+
+  // Store the fetch time of commits that are only partly validated.
+  if (changed || count > kCommentPageSize)
+    storeCommentCache(repo);
+
+  emitComments(repo, oid);
+}
+
+void GitHub::emitComments(Repository *repo, const QString &oid)
+{
+  emit commentsReady(repo, oid, parseComments(commentCache(repo)[oid].nodes));
+}
+
 void GitHub::authorize()
 {
   mState = QString();
@@ -375,6 +627,20 @@ QString GitHub::defaultUrl()
   return QStringLiteral("https://api.github.com");
 }
 
+QUrl GitHub::graphqlUrl() const
+{
+  if (!hasCustomUrl())
+    return kGraphQlUrl;
+
+  // Enterprise servers host GraphQL next to the REST API root.
+  // For example, https://host/api/v3 -> https://host/api/graphql.
+  QString base = url();
+  if (!base.endsWith('/'))
+    base.append('/');
+
+  return QUrl(base).resolved(QUrl("../graphql"));
+}
+
 void GitHub::graphql(
   const QString &query,
   const Callback &callback)
@@ -385,7 +651,7 @@ void GitHub::graphql(
   QJsonDocument doc;
   doc.setObject({{"query", query}});
 
-  QNetworkRequest request(kGraphQlUrl);
+  QNetworkRequest request(graphqlUrl());
   request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
   request.setRawHeader(
     "Authorization", QString("bearer %1").arg(mAccessToken).toUtf8());
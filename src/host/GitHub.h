@@ -11,7 +11,10 @@
 #define GITHUB_H
 
 #include "Account.h"
+#include <QDateTime>
+#include <QJsonArray>
 #include <QJsonDocument>
+#include <QSet>
 
 class GitHub : public Account
 {
@@ -36,6 +39,7 @@ public:
     bool canModify) override;
 
   void requestComments(Repository *repo, const QString &oid) override;
+  void requestComments(Repository *repo, const QStringList &oids) override;
 
   void authorize() override;
   bool isAuthorizeSupported() override;
@@ -45,6 +49,35 @@ public:
 private:
   using Callback = std::function<void (const QJsonObject &)>;
 
+  // Comments are cached on disk for commits that have them.
+  struct CachedComments
+  {
+    int count = 0;
+    QJsonArray nodes;
+    QDateTime fetched; // every page
+    QDateTime checked;
+  };
+
+  using CommentCache = QMap<QString,CachedComments>;
+
+  CommentCache &commentCache(Repository *repo);
+  void storeCommentCache(Repository *repo);
+
+  // Request the remaining pages of comments for a single commit.
+  void fetchComments(
+    Repository *repo,
+    const QString &oid,
+    const QString &cursor,
+    const QJsonArray &nodes);
+  void finishComments(
+    Repository *repo,
+    const QString &oid,
+    int count,
+    const QJsonArray &nodes);
+  void emitComments(Repository *repo, const QString &oid);
+
+  QUrl graphqlUrl() const;
+
   void graphql(
     const QString &query,
     const Callback &callback);
@@ -55,6 +88,9 @@ private:
     const Callback &callback = Callback());
 
   QString mState;
+
+  QMap<Repository *,CommentCache> mComments;
+  QSet<QString> mPendingComments;
 };
 
 #endif
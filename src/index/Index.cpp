@@ -18,6 +18,7 @@
 #include "git/Reference.h"
 #include "git/RevWalk.h"
 #include "git/Signature.h"
+#include "trace/Trace.h"
 #include <QLockFile>
 #include <QSettings>
 #include <QtConcurrent>
@@ -134,6 +135,9 @@ bool Index::write(PostingMap map)
   if (map.isEmpty())
     return false;
 
+  Trace::Span span("index", "write");
+  span.setArg("terms", map.size());
+
   // Open files for writing.
   QDir dir = indexDir();
   QSaveFile idFile(dir.filePath(kIdFile));
@@ -228,6 +232,7 @@ bool Index::write(PostingMap map)
   proxInFile.close();
 
   // Write out files.
+  span.setArg("bytes", postFile.pos() + proxFile.pos() + dictFile.pos());
   postFile.commit();
   proxFile.commit();
   dictFile.commit();
@@ -244,6 +249,8 @@ QList<git::Commit> Index::commits(const QString &filter) const
   if (filter.isEmpty())
     return QList<git::Commit>();
 
+  Trace::Span span("index", "query");
+
   // Parse query.
   QueryRef query = Query::parseQuery(filter);
   if (!query)
@@ -256,6 +263,8 @@ QList<git::Commit> Index::commits(const QString &filter) const
     return (lhs.committer().date() > rhs.committer().date());
   });
 
+  span.setArg("rows", commits.size());
+
   return commits;
 }
 
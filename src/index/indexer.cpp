@@ -17,6 +17,7 @@
 #include "git/Repository.h"
 #include "git/RevWalk.h"
 #include "git/Signature.h"
+#include "trace/Trace.h"
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDataStream>
@@ -232,6 +233,7 @@ public:
   Intermediate operator()(const git::Commit &commit)
   {
     log(mOut, "map: %1", commit.id());
+    Trace::Span span("index", "map");
 
     quint32 filePos = 0;
     quint32 hunkPos = 0;
@@ -331,6 +333,9 @@ public:
         mLexers.release(lexer);
     }
 
+    span.setArg("files", patches);
+    span.setArg("terms", diffPos);
+
     return result;
   }
 
@@ -529,6 +534,7 @@ int main(int argc, char *argv[])
   parser.addOption({{"v", "verbose"}, "Print indexer progress to stdout."});
   parser.addOption({{"n", "notify"}, "Notify when data is written to disk."});
   parser.addOption({{"b", "background"}, "Start with background priority."});
+  parser.addOption({{"t", "trace"}, "Write trace events to file.", "file"});
   parser.process(app);
 
   QStringList args = parser.positionalArguments();
@@ -562,6 +568,11 @@ int main(int argc, char *argv[])
     }
   }
 
+  // Enable tracing for this process only.
+  QString tracePath = parser.value("trace");
+  if (!tracePath.isEmpty())
+    Trace::setEnabled(true, false);
+
   // Set priority.
   if (parser.isSet("background")) {
 #ifdef Q_OS_WIN
@@ -581,5 +592,10 @@ int main(int argc, char *argv[])
   Index index(repo);
   Indexer indexer(index, out, parser.isSet("notify"));
   app.installNativeEventFilter(&indexer);
-  return indexer.start() ? app.exec() : 0;
+  int result = indexer.start() ? app.exec() : 0;
+
+  if (!tracePath.isEmpty())
+    Trace::write(tracePath);
+
+  return result;
 }
@@ -9,6 +9,22 @@
 
 #include "LogEntry.h"
 
+namespace {
+
+// Limit model updates to about one per frame.
+const int kFlushInterval = 16;
+
+// Collapse children beyond this many into a group.
+const int kGroupThreshold = 500;
+
+QString groupText(int count)
+{
+  QString text = LogEntry::tr("%1 more").arg(count);
+  return QString("<a href='expand'>%1</a>").arg(text);
+}
+
+} // anon. namespace
+
 LogEntry::LogEntry(QObject *parent)
   : QObject(parent)
 {}
@@ -32,9 +48,10 @@ LogEntry::LogEntry(
 
 void LogEntry::setText(const QString &text)
 {
+  // Coalesce frequent progress updates.
   mText = text;
-  if (LogEntry *root = rootEntry())
-    emit root->dataChanged(this);
+  mDataChanged = true;
+  scheduleFlush();
 }
 
 LogEntry *LogEntry::rootEntry() const
@@ -50,21 +67,28 @@ LogEntry *LogEntry::parentEntry() const
 
 void LogEntry::addEntries(const QList<LogEntry *> &entries)
 {
+  // Keep queued entries in order.
+  flushQueue();
   insertEntries(mEntries.size(), entries);
 }
 
 LogEntry *LogEntry::addEntry(Kind kind, const QString &text)
 {
+  flushQueue();
   return insertEntry(mEntries.size(), kind, text);
 }
 
 LogEntry *LogEntry::addEntry(const QString &text, const QString &title)
 {
+  flushQueue();
   return insertEntry(mEntries.size(), Entry, text, title);
 }
 
 void LogEntry::insertEntries(int row, const QList<LogEntry *> &entries)
 {
+  if (entries.isEmpty())
+    return;
+
   LogEntry *root = rootEntry();
   emit root->entriesAboutToBeInserted(this, row, entries.size());
   for (int i = 0; i < entries.size(); ++i) {
@@ -88,9 +112,93 @@ LogEntry *LogEntry::insertEntry(
   return entry;
 }
 
+void LogEntry::queueEntry(Kind kind, const QString &text, char status)
+{
+  mQueue.append({kind, status, text});
+  scheduleFlush();
+}
+
+void LogEntry::flushQueue()
+{
+  if (mFlushTimer)
+    mFlushTimer->stop();
+
+  if (mDataChanged) {
+    mDataChanged = false;
+    if (LogEntry *root = rootEntry())
+      emit root->dataChanged(this);
+  }
+
+  if (mQueue.isEmpty())
+    return;
+
+  // Take the queue before inserting.
+  QList<Item> items;
+  items.swap(mQueue);
+
+  // Add to an existing group. Populate it
+  // immediately if it has already been expanded.
+  if (mGroup) {
+    mGroup->mDeferred.append(items);
+    int count = mGroup->mEntries.size() + mGroup->mDeferred.size();
+    mGroup->setText(groupText(count));
+    if (!mGroup->mEntries.isEmpty())
+      mGroup->fetchEntries();
+    return;
+  }
+
+  // Create entries up to the threshold.
+  QList<LogEntry *> entries;
+  int count = qMin(items.size(), qMax(kGroupThreshold - mEntries.size(), 0));
+  for (int i = 0; i < count; ++i) {
+    const Item &item = items.at(i);
+    LogEntry *entry = new LogEntry(item.kind, item.text, QString());
+    entry->setStatus(item.status);
+    entries.append(entry);
+  }
+
+  // Collapse the rest.
+  if (count < items.size()) {
+    QList<Item> rest = items.mid(count);
+    mGroup = new LogEntry(Entry, groupText(rest.size()), QString());
+    mGroup->mDeferred = rest;
+    entries.append(mGroup);
+  }
+
+  insertEntries(mEntries.size(), entries);
+}
+
+void LogEntry::fetchEntries()
+{
+  QList<LogEntry *> entries;
+  foreach (const Item &item, mDeferred) {
+    LogEntry *entry = new LogEntry(item.kind, item.text, QString());
+    entry->setStatus(item.status);
+    entries.append(entry);
+  }
+
+  mDeferred.clear();
+  insertEntries(mEntries.size(), entries);
+}
+
+void LogEntry::scheduleFlush()
+{
+  if (!mFlushTimer) {
+    mFlushTimer = new QTimer(this);
+    mFlushTimer->setSingleShot(true);
+    mFlushTimer->setInterval(kFlushInterval);
+    connect(mFlushTimer, &QTimer::timeout, this, &LogEntry::flushQueue);
+  }
+
+  if (!mFlushTimer->isActive())
+    mFlushTimer->start();
+}
+
 void LogEntry::setBusy(bool busy)
 {
   if (!busy) {
+    // Flush everything that was queued by the operation.
+    flushQueue();
     mTimer.stop();
     mProgress = -1;
   } else {
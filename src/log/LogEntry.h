@@ -63,6 +63,16 @@ public:
     const QString &text,
     const QString &title = QString());
 
+  // Queue a child entry to be added in the next batch. Batches are
+  // flushed at most once per frame. Very long lists of children are
+  // collapsed into a group that's only populated when it's expanded.
+  void queueEntry(Kind kind, const QString &text, char status = 0);
+  void flushQueue();
+
+  // Populate a collapsed group.
+  bool canFetchEntries() const { return !mDeferred.isEmpty(); }
+  void fetchEntries();
+
   int progress() const { return mProgress; }
   void setBusy(bool busy);
 
@@ -73,6 +83,15 @@ signals:
   void errorInserted();
 
 private:
+  struct Item
+  {
+    Kind kind;
+    char status;
+    QString text;
+  };
+
+  void scheduleFlush();
+
   Kind mKind = Entry;
   char mStatus = 0;
   QString mText;
@@ -82,6 +101,15 @@ private:
 
   QTimer mTimer;
   int mProgress = -1;
+
+  // batching
+  QTimer *mFlushTimer = nullptr;
+  bool mDataChanged = false;
+  QList<Item> mQueue;
+
+  // collapsed group
+  LogEntry *mGroup = nullptr;
+  QList<Item> mDeferred;
 };
 
 #endif
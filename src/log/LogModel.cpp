@@ -68,6 +68,22 @@ int LogModel::columnCount(const QModelIndex &parent) const
   return 1;
 }
 
+bool LogModel::hasChildren(const QModelIndex &parent) const
+{
+  LogEntry *entry = this->entry(parent);
+  return !entry->entries().isEmpty() || entry->canFetchEntries();
+}
+
+bool LogModel::canFetchMore(const QModelIndex &parent) const
+{
+  return entry(parent)->canFetchEntries();
+}
+
+void LogModel::fetchMore(const QModelIndex &parent)
+{
+  entry(parent)->fetchEntries();
+}
+
 QVariant LogModel::data(const QModelIndex &index, int role) const
 {
   LogEntry *entry = this->entry(index);
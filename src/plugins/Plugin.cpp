@@ -12,7 +12,10 @@
 #include "editor/TextEditor.h"
 #include "git/Config.h"
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutexLocker>
 #include <QTextStream>
+#include <QThread>
 
 extern "C" {
 #include "lua.h"
@@ -232,8 +235,11 @@ int optionsValue(lua_State *L)
   if (lua_gettop(L) != 2 || !lua_istable(L, 1) || !lua_isstring(L, 2))
     luaL_error(L, "invalid arguments");
 
+  // Hunks read the values that were current when they started.
   QString key = lua_tostring(L, 2);
-  QVariant value = plugin(L)->optionValue(key);
+  Plugin::Values *values = member<Plugin::Values *>(L, "_values");
+  QVariant value =
+    values ? values->options.value(key) : plugin(L)->optionValue(key);
   if (!value.isValid())
     luaL_error(L, "invalid option");
 
@@ -289,10 +295,12 @@ int hunkLines(lua_State *L)
   if (lua_gettop(L) != 1 || !lua_istable(L, 1))
     luaL_error(L, "invalid arguments");
 
-  TextEditor *editor = member<TextEditor *>(L, "_editor");
+  Plugin::Hunk *hunk = member<Plugin::Hunk *>(L, "_hunk");
+  Plugin::Values *values = member<Plugin::Values *>(L, "_values");
+  Plugin::Diagnostics *diags = member<Plugin::Diagnostics *>(L, "_diags");
 
   // Create lines table.
-  int count = editor->lineCount();
+  int count = hunk->lines.size();
   lua_createtable(L, count, 0);
   for (int i = 0; i < count; ++i) {
     // index
@@ -300,7 +308,9 @@ int hunkLines(lua_State *L)
 
     // Create line table.
     createInstance(L, plugin(L), "Line", kLineFuncs);
-    setMember(L, "_editor", editor);
+    setMember(L, "_hunk", hunk);
+    setMember(L, "_values", values);
+    setMember(L, "_diags", diags);
     setMember(L, "_line", i);
 
     // Add to hunk.
@@ -315,7 +325,7 @@ int hunkLexer(lua_State *L)
   if (lua_gettop(L) != 1 || !lua_istable(L, 1))
     luaL_error(L, "invalid arguments");
 
-  lua_pushstring(L, member<TextEditor *>(L, "_editor")->lexer().toUtf8());
+  lua_pushstring(L, member<Plugin::Hunk *>(L, "_hunk")->lexer.toUtf8());
   return 1;
 }
 
@@ -324,7 +334,7 @@ int hunkTabWidth(lua_State *L)
   if (lua_gettop(L) != 1 || !lua_istable(L, 1))
     luaL_error(L, "invalid arguments");
 
-  lua_pushinteger(L, member<TextEditor *>(L, "_editor")->tabWidth());
+  lua_pushinteger(L, member<Plugin::Hunk *>(L, "_hunk")->tabWidth);
   return 1;
 }
 
@@ -333,10 +343,10 @@ int lineText(lua_State *L)
   if (lua_gettop(L) != 1 || !lua_istable(L, 1))
     luaL_error(L, "invalid arguments");
 
-  TextEditor *editor = member<TextEditor *>(L, "_editor");
+  Plugin::Hunk *hunk = member<Plugin::Hunk *>(L, "_hunk");
   int line = member<int>(L, "_line");
 
-  lua_pushstring(L, editor->line(line).toUtf8());
+  lua_pushstring(L, hunk->lines.at(line).text);
   return 1;
 }
 
@@ -345,18 +355,10 @@ int lineOrigin(lua_State *L)
   if (lua_gettop(L) != 1 || !lua_istable(L, 1))
     luaL_error(L, "invalid arguments");
 
-  TextEditor *editor = member<TextEditor *>(L, "_editor");
+  Plugin::Hunk *hunk = member<Plugin::Hunk *>(L, "_hunk");
   int line = member<int>(L, "_line");
 
-  QByteArray marker = " ";
-  int markers = editor->markers(line);
-  if (markers & (1 << TextEditor::Addition)) {
-    marker = "+";
-  } else if (markers & (1 << TextEditor::Deletion)) {
-    marker = "-";
-  }
-
-  lua_pushstring(L, marker);
+  lua_pushstring(L, QByteArray(1, hunk->lines.at(line).origin));
   return 1;
 }
 
@@ -364,20 +366,18 @@ void addLexeme(
   lua_State *L,
   Plugin *plugin,
   int index,
-  TextEditor *editor,
-  int pos,
-  int style,
-  const QByteArray &text)
+  Plugin::Hunk *hunk,
+  const Plugin::Lexeme &lexeme)
 {
   // index
   lua_pushinteger(L, index);
 
   // Create lexeme table.
   createInstance(L, plugin, "Lexeme", kLexemeFuncs);
-  setMember(L, "_editor", editor);
-  setMember(L, "_pos", pos + 1);
-  setMember(L, "_style", style);
-  setMember(L, "_text", text.constData());
+  setMember(L, "_hunk", hunk);
+  setMember(L, "_pos", lexeme.pos + 1);
+  setMember(L, "_style", lexeme.style);
+  setMember(L, "_text", lexeme.text.constData());
 
   lua_settable(L, -3);
 }
@@ -387,38 +387,14 @@ int lineLexemes(lua_State *L)
   if (lua_gettop(L) != 1 || !lua_istable(L, 1))
     luaL_error(L, "invalid arguments");
 
-  TextEditor *editor = member<TextEditor *>(L, "_editor");
+  Plugin::Hunk *hunk = member<Plugin::Hunk *>(L, "_hunk");
   int line = member<int>(L, "_line");
 
   // Create lexemes table.
   lua_newtable(L);
-  int max = editor->lineEndPosition(line);
-  int pos = editor->positionFromLine(line);
-  if (pos == max)
-    return 1;
-
-  // Ensure styled to end of line.
-  int endStyled = editor->endStyled();
-  if (max > endStyled)
-    editor->colorize(endStyled, max);
-
   int count = 0;
-  int current = 0;
-  QByteArray text(1, editor->charAt(pos));
-  int style = editor->styleAt(pos);
-  for (int i = pos + 1; i < max; ++i) {
-    int nextStyle = editor->styleAt(i);
-    if (nextStyle != style) {
-      addLexeme(L, plugin(L), ++count, editor, current, style, text);
-      current = i - pos;
-      style = nextStyle;
-      text = QByteArray();
-    }
-
-    text.append(editor->charAt(i));
-  }
-
-  addLexeme(L, plugin(L), ++count, editor, current, style, text);
+  foreach (const Plugin::Lexeme &lexeme, hunk->lines.at(line).lexemes)
+    addLexeme(L, plugin(L), ++count, hunk, lexeme);
 
   return 1;
 }
@@ -432,10 +408,11 @@ int lineAddError(lua_State *L)
 
   // Check if this error is enabled.
   QString key = lua_tostring(L, 2);
-  if (!plugin(L)->isEnabled(key))
+  Plugin::Values *values = member<Plugin::Values *>(L, "_values");
+  if (!values->enabled.value(key))
     return 0;
 
-  TextEditor *editor = member<TextEditor *>(L, "_editor");
+  Plugin::Diagnostics *diags = member<Plugin::Diagnostics *>(L, "_diags");
   int line = member<int>(L, "_line");
 
   // Add diagnostic.
@@ -444,9 +421,9 @@ int lineAddError(lua_State *L)
   QString msg = plugin(L)->diagnosticMessage(key);
   QString desc = plugin(L)->diagnosticDescription(key);
   TextEditor::DiagnosticKind kind =
-    static_cast<TextEditor::DiagnosticKind>(plugin(L)->diagnosticKind(key));
+    static_cast<TextEditor::DiagnosticKind>(values->kinds.value(key));
   QString replacement = (lua_gettop(L) == 5) ? lua_tostring(L, 5) : QString();
-  editor->addDiagnostic(line, {kind, msg, desc, {pos, len}, replacement});
+  (*diags)[line].append({kind, msg, desc, {pos, len}, replacement});
 
   return 0;
 }
@@ -456,11 +433,10 @@ int lineColumn(lua_State *L)
   if (lua_gettop(L) != 2 || !lua_istable(L, 1) || !lua_isinteger(L, 2))
     luaL_error(L, "invalid arguments");
 
-  TextEditor *editor = member<TextEditor *>(L, "_editor");
+  Plugin::Hunk *hunk = member<Plugin::Hunk *>(L, "_hunk");
   int line = member<int>(L, "_line");
 
-  int pos = editor->positionFromLine(line) + lua_tointeger(L, 2) - 1;
-  lua_pushinteger(L, editor->column(pos) + 1);
+  lua_pushinteger(L, hunk->column(line, lua_tointeger(L, 2) - 1) + 1);
   return 1;
 }
 
@@ -469,11 +445,10 @@ int lineColumnPos(lua_State *L)
   if (lua_gettop(L) != 2 || !lua_istable(L, 1) || !lua_isinteger(L, 2))
     luaL_error(L, "invalid arguments");
 
-  TextEditor *editor = member<TextEditor *>(L, "_editor");
+  Plugin::Hunk *hunk = member<Plugin::Hunk *>(L, "_hunk");
   int line = member<int>(L, "_line");
 
-  int pos = editor->findColumn(line, lua_tointeger(L, 2) - 1);
-  lua_pushinteger(L, pos - editor->positionFromLine(line) + 1);
+  lua_pushinteger(L, hunk->findColumn(line, lua_tointeger(L, 2) - 1) + 1);
   return 1;
 }
 
@@ -512,6 +487,16 @@ int lexemeText(lua_State *L)
   return 1;
 }
 
+char charAt(const QByteArray &styled, int pos)
+{
+  return styled.at(2 * pos);
+}
+
+int styleAt(const QByteArray &styled, int pos)
+{
+  return static_cast<unsigned char>(styled.at((2 * pos) + 1));
+}
+
 QByteArray kind(TextEditor *editor, int style)
 {
   uintptr_t ptr = editor->privateLexerCall(style, 0);
@@ -524,10 +509,10 @@ int lexemeKind(lua_State *L)
   if (lua_gettop(L) != 1 || !lua_istable(L, 1))
     luaL_error(L, "invalid arguments");
 
-  TextEditor *editor = member<TextEditor *>(L, "_editor");
+  Plugin::Hunk *hunk = member<Plugin::Hunk *>(L, "_hunk");
   int style = member<int>(L, "_style");
 
-  lua_pushstring(L, kind(editor, style));
+  lua_pushstring(L, hunk->kinds.value(style));
   return 1;
 }
 
@@ -536,20 +521,63 @@ int lexemeIsKind(lua_State *L)
   if (lua_gettop(L) != 2 || !lua_istable(L, 1) || !lua_isstring(L, 2))
     luaL_error(L, "invalid arguments");
 
-  TextEditor *editor = member<TextEditor *>(L, "_editor");
+  Plugin::Hunk *hunk = member<Plugin::Hunk *>(L, "_hunk");
   int style = member<int>(L, "_style");
 
-  lua_pushboolean(L, kind(editor, style) == QByteArray(lua_tostring(L, 2)));
+  QByteArray kind = hunk->kinds.value(style);
+  lua_pushboolean(L, kind == QByteArray(lua_tostring(L, 2)));
   return 1;
 }
 
 } // anon. namespace
 
+int Plugin::Hunk::column(int line, int pos) const
+{
+  // Expand tabs and count multibyte characters once.
+  int column = 0;
+  const QByteArray &text = lines.at(line).text;
+  for (int i = 0; i < pos && i < text.length(); ++i) {
+    char ch = text.at(i);
+    if (ch == '\t') {
+      column = ((column / tabWidth) + 1) * tabWidth;
+    } else if ((ch & 0xC0) != 0x80) {
+      ++column;
+    }
+  }
+
+  return column;
+}
+
+int Plugin::Hunk::findColumn(int line, int column) const
+{
+  int pos = 0;
+  int current = 0;
+  const QByteArray &text = lines.at(line).text;
+  while (current < column && pos < text.length()) {
+    char ch = text.at(pos);
+    if (ch == '\t') {
+      current = ((current / tabWidth) + 1) * tabWidth;
+      if (current > column)
+        return pos;
+      ++pos;
+    } else if (ch == '\r' || ch == '\n') {
+      return pos;
+    } else {
+      ++current;
+      ++pos;
+      while (pos < text.length() && (text.at(pos) & 0xC0) == 0x80)
+        ++pos;
+    }
+  }
+
+  return pos;
+}
+
 Plugin::Plugin(
   const QString &file,
   const git::Repository &repo,
   QObject *parent)
-  : QObject(parent), mRepo(repo), L(luaL_newstate())
+  : QObject(parent), mRepo(repo), L(nullptr), mFile(file)
 {
   QFileInfo info(file);
   mDir = info.dir().path();
@@ -560,21 +588,11 @@ Plugin::Plugin(
     QTextStream(stderr) << "plugin error: " << msg << endl;
   });
 
-  // Load libraries.
-  luaL_openlibs(L);
-
-  // Add script dir to path.
-  lua_getglobal(L, "package");
-  lua_getfield(L, -1, "path");
-  QByteArray path = lua_tostring(L, -1);
-  lua_pop(L, 1); // path
-  lua_pushstring(L, path + ";" + mDir.toUtf8() + "/?.lua");
-  lua_setfield(L, -2, "path");
-  lua_pop(L, 1); // package
-
   // Load script.
-  if (luaL_dofile(L, file.toLocal8Bit())) {
-    setError(lua_tostring(L, -1));
+  QString err;
+  L = createState(err);
+  if (!err.isEmpty()) {
+    setError(err);
     return;
   }
 
@@ -611,10 +629,13 @@ Plugin::Plugin(
 Plugin::~Plugin()
 {
   lua_close(L);
+  foreach (lua_State *state, mStates)
+    lua_close(state);
 }
 
 bool Plugin::isValid() const
 {
+  QMutexLocker locker(&mMutex);
   return mError.isEmpty();
 }
 
@@ -630,6 +651,7 @@ QString Plugin::scriptDir() const
 
 QString Plugin::errorString() const
 {
+  QMutexLocker locker(&mMutex);
   return mError;
 }
 
@@ -764,27 +786,181 @@ QString Plugin::diagnosticDescription(const QString &key) const
 
 bool Plugin::hunk(TextEditor *editor) const
 {
-  if (!lua_getglobal(L, "hunk")) {
-    const_cast<Plugin *>(this)->setError("global 'hunk' function not found");
+  Diagnostics diags;
+  if (!hunk(split(snapshot(editor)), values(), diags))
     return false;
+
+  foreach (int line, diags.keys()) {
+    foreach (const TextEditor::Diagnostic &diag, diags.value(line))
+      editor->addDiagnostic(line, diag);
+  }
+
+  return true;
+}
+
+bool Plugin::hunk(
+  const Hunk &hunk,
+  const Values &values,
+  Diagnostics &diagnostics) const
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  QString err;
+  lua_State *state = acquireState();
+  if (lua_getglobal(state, "hunk")) {
+    // Create hunk table.
+    createInstance(state, const_cast<Plugin *>(this), "Hunk", kHunkFuncs);
+    setMember(state, "_hunk", const_cast<Hunk *>(&hunk));
+    setMember(state, "_values", const_cast<Values *>(&values));
+    setMember(state, "_diags", &diagnostics);
+
+    // Create options table.
+    createInstance(state, const_cast<Plugin *>(this), "Options", kOptionsFuncs);
+    setMember(state, "_values", const_cast<Values *>(&values));
+
+    // Call hunk function.
+    if (lua_pcall(state, 2, 0, 0))
+      err = lua_tostring(state, -1);
+  } else {
+    err = "global 'hunk' function not found";
   }
 
-  // Create hunk table.
-  createInstance(L, const_cast<Plugin *>(this), "Hunk", kHunkFuncs);
-  setMember(L, "_editor", editor);
+  if (!err.isEmpty())
+    lua_pop(state, 1); // error or nil
 
-  // Create options table.
-  createInstance(L, const_cast<Plugin *>(this), "Options", kOptionsFuncs);
+  releaseState(state);
 
-  // Call hunk function.
-  if (lua_pcall(L, 2, 0, 0)) {
-    const_cast<Plugin *>(this)->setError(lua_tostring(L, -1));
+  // Update stats.
+  qint64 usecs = timer.nsecsElapsed() / 1000;
+  {
+    QMutexLocker locker(&mMutex);
+    ++mStats.count;
+    mStats.total += usecs;
+    mStats.max = qMax(mStats.max, usecs);
+  }
+
+  if (!err.isEmpty()) {
+    const_cast<Plugin *>(this)->setError(err);
     return false;
   }
 
   return true;
 }
 
+Plugin::Values Plugin::values() const
+{
+  Values values;
+  foreach (const QString &key, mOptions.keys())
+    values.options.insert(key, optionValue(key));
+
+  foreach (const QString &key, mDiagnostics.keys()) {
+    values.enabled.insert(key, isEnabled(key));
+    values.kinds.insert(key, diagnosticKind(key));
+  }
+
+  return values;
+}
+
+Plugin::Stats Plugin::stats() const
+{
+  QMutexLocker locker(&mMutex);
+  return mStats;
+}
+
+Plugin::Text Plugin::snapshot(TextEditor *editor)
+{
+  Text text;
+  text.lexer = editor->lexer();
+  text.tabWidth = editor->tabWidth();
+
+  // Ensure styled to the end.
+  int length = editor->length();
+  int endStyled = editor->endStyled();
+  if (length > endStyled)
+    editor->colorize(endStyled, length);
+
+  // Copy every character and style in one call. The range is
+  // terminated by two zero bytes.
+  text.styled.resize((2 * length) + 2);
+  Sci_TextRange range;
+  range.chrg.cpMin = 0;
+  range.chrg.cpMax = length;
+  range.lpstrText = text.styled.data();
+  editor->send(SCI_GETSTYLEDTEXT, 0, (sptr_t) &range);
+  text.styled.resize(2 * length);
+
+  int count = editor->lineCount();
+  for (int line = 0; line < count; ++line) {
+    char origin = ' ';
+    int markers = editor->markers(line);
+    if (markers & (1 << TextEditor::Addition)) {
+      origin = '+';
+    } else if (markers & (1 << TextEditor::Deletion)) {
+      origin = '-';
+    }
+
+    text.origins.append(origin);
+    text.starts.append(editor->positionFromLine(line));
+    text.ends.append(editor->lineEndPosition(line));
+  }
+
+  // Look up lexeme kinds.
+  for (int pos = 0; pos < length; ++pos) {
+    int style = styleAt(text.styled, pos);
+    if (!text.kinds.contains(style))
+      text.kinds.insert(style, kind(editor, style));
+  }
+
+  return text;
+}
+
+Plugin::Hunk Plugin::split(const Text &text)
+{
+  Hunk hunk;
+  hunk.lexer = text.lexer;
+  hunk.tabWidth = text.tabWidth;
+  hunk.kinds = text.kinds;
+
+  int length = text.styled.length() / 2;
+  int count = text.starts.size();
+  for (int line = 0; line < count; ++line) {
+    int pos = text.starts.at(line);
+    int max = text.ends.at(line);
+    int next = (line + 1 < count) ? text.starts.at(line + 1) : length;
+
+    // Split into lexemes.
+    QList<Lexeme> lexemes;
+    if (pos < max) {
+      int current = 0;
+      QByteArray lexeme(1, charAt(text.styled, pos));
+      int style = styleAt(text.styled, pos);
+      for (int i = pos + 1; i < max; ++i) {
+        int nextStyle = styleAt(text.styled, i);
+        if (nextStyle != style) {
+          lexemes.append({current, style, lexeme});
+          current = i - pos;
+          style = nextStyle;
+          lexeme = QByteArray();
+        }
+
+        lexeme.append(charAt(text.styled, i));
+      }
+
+      lexemes.append({current, style, lexeme});
+    }
+
+    // Copy the whole line, including the end of line.
+    QByteArray chars;
+    for (int i = pos; i < next; ++i)
+      chars.append(charAt(text.styled, i));
+
+    hunk.lines.append({text.origins.at(line), chars, lexemes});
+  }
+
+  return hunk;
+}
+
 QList<PluginRef> Plugin::plugins(const git::Repository &repo)
 {
   QList<PluginRef> plugins;
@@ -808,7 +984,63 @@ git::Config Plugin::config() const
 
 void Plugin::setError(const QString &err)
 {
-  lua_pop(L, 1); // error or nil
-  mError = err;
-  emit error(err);
+  {
+    QMutexLocker locker(&mMutex);
+    mError = err;
+  }
+
+  // Hunks can fail on any thread.
+  if (thread() == QThread::currentThread()) {
+    emit error(err);
+    return;
+  }
+
+  QMetaObject::invokeMethod(this, [this, err] {
+    emit error(err);
+  }, Qt::QueuedConnection);
+}
+
+lua_State *Plugin::createState(QString &error) const
+{
+  lua_State *state = luaL_newstate();
+
+  // Load libraries.
+  luaL_openlibs(state);
+
+  // Add script dir to path.
+  lua_getglobal(state, "package");
+  lua_getfield(state, -1, "path");
+  QByteArray path = lua_tostring(state, -1);
+  lua_pop(state, 1); // path
+  lua_pushstring(state, path + ";" + mDir.toUtf8() + "/?.lua");
+  lua_setfield(state, -2, "path");
+  lua_pop(state, 1); // package
+
+  // Load script.
+  if (luaL_dofile(state, mFile.toLocal8Bit())) {
+    error = lua_tostring(state, -1);
+    lua_pop(state, 1); // error
+  }
+
+  return state;
+}
+
+lua_State *Plugin::acquireState() const
+{
+  {
+    QMutexLocker locker(&mMutex);
+    if (!mStates.isEmpty())
+      return mStates.takeLast();
+  }
+
+  // The script already loaded successfully once. If it fails
+  // now, the missing hunk function will be reported instead.
+  QString err;
+  return createState(err);
+}
+
+void Plugin::releaseState(lua_State *state) const
+{
+  QMutexLocker locker(&mMutex);
+  mStates.append(state);
 }
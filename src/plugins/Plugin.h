@@ -7,13 +7,13 @@
 // Author: Jason Haslam
 //
 
+#include "editor/TextEditor.h"
 #include "git/Repository.h"
+#include <QMutex>
 #include <QObject>
 #include <QSharedPointer>
 #include <QVariant>
 
-class TextEditor;
-
 typedef struct lua_State lua_State;
 
 using PluginRef = QSharedPointer<class Plugin>;
@@ -36,6 +36,65 @@ public:
     Error
   };
 
+  // An immutable copy of a hunk that can be read from any thread.
+  struct Lexeme
+  {
+    int pos;
+    int style;
+    QByteArray text;
+  };
+
+  struct Line
+  {
+    char origin;
+    QByteArray text;
+    QList<Lexeme> lexemes;
+  };
+
+  struct Hunk
+  {
+    QString lexer;
+    int tabWidth = 8;
+    QList<Line> lines;
+    QMap<int,QByteArray> kinds;
+
+    int column(int line, int pos) const;
+    int findColumn(int line, int column) const;
+  };
+
+  // The styled text of an editor with one (char, style) pair per
+  // byte. It's copied in one call on the main thread and split into
+  // a hunk on another thread.
+  struct Text
+  {
+    QString lexer;
+    int tabWidth = 8;
+    QByteArray styled;
+    QByteArray origins;
+    QList<int> starts;
+    QList<int> ends;
+    QMap<int,QByteArray> kinds;
+  };
+
+  // Option values and diagnostic settings read from the config on the
+  // main thread. Hunks read these instead of the config.
+  struct Values
+  {
+    QMap<QString,QVariant> options;
+    QMap<QString,bool> enabled;
+    QMap<QString,DiagnosticKind> kinds;
+  };
+
+  // diagnostics by line
+  using Diagnostics = QMap<int,QList<TextEditor::Diagnostic>>;
+
+  struct Stats
+  {
+    int count = 0;
+    qint64 total = 0; // usecs
+    qint64 max = 0; // usecs
+  };
+
   Plugin(
     const QString &file,
     const git::Repository &repo = git::Repository(),
@@ -80,8 +139,29 @@ public:
   QString diagnosticMessage(const QString &key) const;
   QString diagnosticDescription(const QString &key) const;
 
+  // Run the hunk function synchronously and add diagnostics to the editor.
   bool hunk(TextEditor *editor) const;
 
+  // Run the hunk function against a snapshot. This is safe to call
+  // from any thread. Each concurrent call uses its own Lua state.
+  // Errors are reported on the plugin's thread.
+  bool hunk(
+    const Hunk &hunk,
+    const Values &values,
+    Diagnostics &diagnostics) const;
+
+  // Read the current values. Call this on the main thread.
+  Values values() const;
+
+  // Accumulated time spent in the hunk function.
+  Stats stats() const;
+
+  // Copy the editor text. Call this on the main thread.
+  static Text snapshot(TextEditor *editor);
+
+  // Split text into lines and lexemes. This is safe to call from any thread.
+  static Hunk split(const Text &text);
+
   static QList<PluginRef> plugins(
     const git::Repository &repo = git::Repository());
 
@@ -109,13 +189,23 @@ private:
   git::Config config() const;
   void setError(const QString &err);
 
+  lua_State *createState(QString &error) const;
+  lua_State *acquireState() const;
+  void releaseState(lua_State *state) const;
+
   git::Repository mRepo;
 
   lua_State *L;
+  QString mFile;
   QString mDir;
   QString mName;
   QString mError;
 
+  // Lua states for running hunks off the main thread.
+  mutable QMutex mMutex;
+  mutable QList<lua_State *> mStates;
+  mutable Stats mStats;
+
   QMap<QString,Option> mOptions;
   QMap<QString,Diagnostic> mDiagnostics;
 };
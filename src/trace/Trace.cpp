@@ -0,0 +1,239 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Trace.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSaveFile>
+#include <QSettings>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+
+namespace {
+
+const QString kEnableKey = "trace/enable";
+
+// Stop recording on a thread after this many events.
+const int kMaxEvents = 1 << 18;
+
+struct Event
+{
+  char phase;
+  const char *category;
+  const char *name;
+  qint64 start;
+  qint64 duration;
+  int argCount;
+  const char *argNames[2];
+  qint64 argValues[2];
+};
+
+struct Buffer
+{
+  QMutex mutex;
+  quintptr tid;
+  QString name;
+  QVector<Event> events;
+};
+
+QMutex buffersMutex;
+QList<QSharedPointer<Buffer>> buffers;
+QThreadStorage<QSharedPointer<Buffer>> localBuffer;
+
+QAtomicInt &enabled()
+{
+  static QAtomicInt enabled(QSettings().value(kEnableKey).toBool());
+  return enabled;
+}
+
+// Nanoseconds since the first event.
+qint64 now()
+{
+  static QElapsedTimer timer = [] {
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+  }();
+
+  return timer.nsecsElapsed();
+}
+
+void record(const Event &event)
+{
+  if (!localBuffer.hasLocalData()) {
+    QSharedPointer<Buffer> buffer(new Buffer);
+    buffer->tid = reinterpret_cast<quintptr>(QThread::currentThreadId());
+
+    QThread *thread = QThread::currentThread();
+    QCoreApplication *app = QCoreApplication::instance();
+    if (app && thread == app->thread()) {
+      buffer->name = "Main";
+    } else {
+      buffer->name = thread->objectName();
+      if (buffer->name.isEmpty())
+        buffer->name = QString("Thread %1").arg(buffer->tid);
+    }
+
+    QMutexLocker locker(&buffersMutex);
+    buffers.append(buffer);
+    localBuffer.setLocalData(buffer);
+  }
+
+  // The lock is only contended while writing.
+  Buffer *buffer = localBuffer.localData().data();
+  QMutexLocker locker(&buffer->mutex);
+  if (buffer->events.size() < kMaxEvents)
+    buffer->events.append(event);
+}
+
+QByteArray escape(const QString &text)
+{
+  QString result = text;
+  result.replace('\\', "\\\\");
+  result.replace('"', "\\\"");
+  return result.toUtf8();
+}
+
+QByteArray microseconds(qint64 ns)
+{
+  return QByteArray::number(ns / 1000.0, 'f', 3);
+}
+
+} // anon. namespace
+
+Trace::Span::Span(const char *category, const char *name)
+  : mCategory(category), mName(name)
+{
+  if (isEnabled())
+    mStart = now();
+}
+
+Trace::Span::~Span()
+{
+  if (mStart < 0)
+    return;
+
+  Event event;
+  event.phase = 'X';
+  event.category = mCategory;
+  event.name = mName;
+  event.start = mStart;
+  event.duration = now() - mStart;
+  event.argCount = mArgCount;
+  for (int i = 0; i < mArgCount; ++i) {
+    event.argNames[i] = mArgNames[i];
+    event.argValues[i] = mArgValues[i];
+  }
+
+  record(event);
+}
+
+void Trace::Span::setArg(const char *name, qint64 value)
+{
+  if (mStart < 0 || mArgCount >= kMaxArgs)
+    return;
+
+  mArgNames[mArgCount] = name;
+  mArgValues[mArgCount] = value;
+  ++mArgCount;
+}
+
+void Trace::counter(const char *category, const char *name, qint64 value)
+{
+  if (!isEnabled())
+    return;
+
+  Event event;
+  event.phase = 'C';
+  event.category = category;
+  event.name = name;
+  event.start = now();
+  event.duration = 0;
+  event.argCount = 1;
+  event.argNames[0] = name;
+  event.argValues[0] = value;
+  record(event);
+}
+
+bool Trace::isEnabled()
+{
+  return enabled().loadRelaxed();
+}
+
+void Trace::setEnabled(bool enable, bool persist)
+{
+  enabled().storeRelaxed(enable);
+  if (persist)
+    QSettings().setValue(kEnableKey, enable);
+}
+
+bool Trace::write(const QString &path)
+{
+  QSaveFile file(path);
+  if (!file.open(QFile::WriteOnly))
+    return false;
+
+  QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+  file.write("{\"traceEvents\":[\n");
+
+  bool first = true;
+  QMutexLocker locker(&buffersMutex);
+  foreach (const QSharedPointer<Buffer> &buffer, buffers) {
+    QMutexLocker bufferLocker(&buffer->mutex);
+    QByteArray tid = QByteArray::number(buffer->tid);
+
+    // Name the thread.
+    if (!first)
+      file.write(",\n");
+    first = false;
+
+    file.write("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid +
+               ",\"tid\":" + tid + ",\"args\":{\"name\":\"" +
+               escape(buffer->name) + "\"}}");
+
+    foreach (const Event &event, buffer->events) {
+      QByteArray line = ",\n{\"name\":\"" + QByteArray(event.name) +
+                        "\",\"cat\":\"" + QByteArray(event.category) +
+                        "\",\"ph\":\"" + QByteArray(1, event.phase) +
+                        "\",\"ts\":" + microseconds(event.start);
+      if (event.phase == 'X')
+        line += ",\"dur\":" + microseconds(event.duration);
+
+      line += ",\"pid\":" + pid + ",\"tid\":" + tid;
+      if (event.argCount > 0) {
+        line += ",\"args\":{";
+        for (int i = 0; i < event.argCount; ++i) {
+          if (i > 0)
+            line += ',';
+          line += "\"" + QByteArray(event.argNames[i]) + "\":" +
+                  QByteArray::number(event.argValues[i]);
+        }
+        line += '}';
+      }
+
+      file.write(line + '}');
+    }
+  }
+
+  file.write("\n],\"displayTimeUnit\":\"ms\"}\n");
+  return file.commit();
+}
+
+void Trace::clear()
+{
+  QMutexLocker locker(&buffersMutex);
+  foreach (const QSharedPointer<Buffer> &buffer, buffers) {
+    QMutexLocker bufferLocker(&buffer->mutex);
+    buffer->events.clear();
+  }
+}
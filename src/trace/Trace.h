@@ -0,0 +1,60 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Lightweight tracing of hot paths. Events are recorded into per-thread
+// buffers while tracing is enabled and can be written out in the Chrome
+// trace event format (chrome://tracing, ui.perfetto.dev). When tracing
+// is disabled a span costs a single relaxed atomic load.
+//
+// Category and name arguments must be string literals. Only the
+// pointers are recorded.
+class Trace
+{
+public:
+  // Records a complete event covering the lifetime of the span.
+  class Span
+  {
+  public:
+    Span(const char *category, const char *name);
+    ~Span();
+
+    // Attach a count (rows, files, bytes) to the event.
+    void setArg(const char *name, qint64 value);
+
+  private:
+    static const int kMaxArgs = 2;
+
+    const char *mCategory;
+    const char *mName;
+    qint64 mStart = -1;
+
+    int mArgCount = 0;
+    const char *mArgNames[kMaxArgs];
+    qint64 mArgValues[kMaxArgs];
+  };
+
+  // Record the current value of a counter.
+  static void counter(const char *category, const char *name, qint64 value);
+
+  // The enabled state is saved in settings unless persist is false.
+  static bool isEnabled();
+  static void setEnabled(bool enable, bool persist = true);
+
+  // Write recorded events as Chrome trace JSON.
+  static bool write(const QString &path);
+  static void clear();
+};
+
+#endif
@@ -0,0 +1,238 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "AvatarCache.h"
+#include "conf/Settings.h"
+#include <QApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPainter>
+#include <QPainterPath>
+#include <QSaveFile>
+#include <QWidget>
+#include <QWindow>
+
+namespace {
+
+const int kSize = 64;
+const char *kKeyProperty = "key";
+const QString kUrl = "http://www.gravatar.com/avatar/%1?s=%2&d=mm";
+const QString kDirName = "avatars";
+
+// Refresh images on disk after they expire.
+const int kExpiryDays = 7;
+
+// Wait before requesting an image again after a failure.
+const int kRetryMinutes = 10;
+
+// Remove the oldest images when the disk cache grows past the limit.
+const qint64 kMaxDiskSize = 16 * 1024 * 1024;
+
+// Memory cost is measured in kilobytes.
+const int kMaxMemoryCost = 8 * 1024;
+
+// Render clipped to circle.
+QPixmap render(const QByteArray &data)
+{
+  QPixmap source;
+  if (!source.loadFromData(data))
+    return QPixmap();
+
+  QPixmap pixmap(source.size());
+  pixmap.fill(Qt::transparent);
+
+  // Clip to path. The region overload doesn't antialias.
+  QPainterPath path;
+  path.addEllipse(pixmap.rect());
+
+  QPainter painter(&pixmap);
+  painter.setRenderHint(QPainter::Antialiasing);
+  painter.setClipPath(path);
+  painter.drawPixmap(0, 0, source);
+
+  return pixmap;
+}
+
+} // anon. namespace
+
+AvatarCache::AvatarCache(const QDir &dir, QObject *parent)
+  : QObject(parent), mDir(dir), mUrl(kUrl)
+{
+  mCache.setMaxCost(kMaxMemoryCost);
+  connect(&mMgr, &QNetworkAccessManager::finished,
+          this, &AvatarCache::finish);
+}
+
+QPixmap AvatarCache::avatar(const QString &email, int size)
+{
+  QByteArray key = this->key(email, size);
+  if (QPixmap *pixmap = mCache.object(key))
+    return *pixmap;
+
+  // Show an expired image until the request finishes.
+  bool stale = true;
+  QPixmap pixmap = load(key, stale);
+  if (!pixmap.isNull())
+    insert(key, pixmap);
+
+  if (stale)
+    request(key);
+
+  return pixmap;
+}
+
+void AvatarCache::prefetch(const QStringList &emails, int size)
+{
+  QSet<QString> unique;
+  foreach (const QString &email, emails) {
+    if (!unique.contains(email)) {
+      unique.insert(email);
+      (void) avatar(email, size);
+    }
+  }
+}
+
+void AvatarCache::setUrl(const QString &url)
+{
+  mUrl = url;
+}
+
+QByteArray AvatarCache::key(const QString &email, int size)
+{
+  QByteArray bytes = email.trimmed().toLower().toUtf8();
+  QByteArray hash = QCryptographicHash::hash(bytes, QCryptographicHash::Md5);
+  return hash.toHex() + '-' + QByteArray::number(size);
+}
+
+int AvatarCache::size(const QWidget *widget)
+{
+  QWindow *handle = widget->window()->windowHandle();
+  qreal ratio = handle ? handle->devicePixelRatio() : widget->devicePixelRatioF();
+  return kSize * ratio;
+}
+
+AvatarCache *AvatarCache::instance()
+{
+  static AvatarCache *instance = nullptr;
+  if (!instance) {
+    QDir dir = Settings::userDir();
+    instance = new AvatarCache(dir.filePath(kDirName), qApp);
+  }
+
+  return instance;
+}
+
+QPixmap AvatarCache::load(const QByteArray &key, bool &stale)
+{
+  QFileInfo info(mDir.filePath(key));
+  QDateTime expiry = QDateTime::currentDateTime().addDays(-kExpiryDays);
+  stale = (!info.exists() || info.lastModified() < expiry);
+
+  QFile file(info.filePath());
+  if (!file.open(QFile::ReadOnly))
+    return QPixmap();
+
+  return render(file.readAll());
+}
+
+void AvatarCache::store(const QByteArray &key, const QByteArray &data)
+{
+  if (!mDir.exists() && !mDir.mkpath("."))
+    return;
+
+  QSaveFile file(mDir.filePath(key));
+  if (!file.open(QFile::WriteOnly))
+    return;
+
+  file.write(data);
+  if (!file.commit())
+    return;
+
+  // Replaced files are counted twice until the next scan.
+  if (mDiskSize >= 0)
+    mDiskSize += data.size();
+
+  prune();
+}
+
+void AvatarCache::request(const QByteArray &key)
+{
+  // Coalesce with the request that's already in flight.
+  if (mPending.contains(key))
+    return;
+
+  // Don't retry a failed request until the delay passes.
+  QDateTime failed = mFailed.value(key);
+  if (failed.isValid()) {
+    if (failed.addSecs(kRetryMinutes * 60) > QDateTime::currentDateTime())
+      return;
+
+    mFailed.remove(key);
+  }
+
+  QList<QByteArray> parts = key.split('-');
+  QString hash = QString::fromUtf8(parts.first());
+  QString size = QString::fromUtf8(parts.last());
+  QNetworkReply *reply = mMgr.get(QNetworkRequest(QUrl(mUrl.arg(hash, size))));
+  reply->setProperty(kKeyProperty, key);
+  mPending.insert(key);
+}
+
+void AvatarCache::finish(QNetworkReply *reply)
+{
+  reply->deleteLater();
+
+  QByteArray key = reply->property(kKeyProperty).toByteArray();
+  mPending.remove(key);
+
+  if (reply->error() != QNetworkReply::NoError) {
+    mFailed.insert(key, QDateTime::currentDateTime());
+    return;
+  }
+
+  QByteArray data = reply->readAll();
+  QPixmap pixmap = render(data);
+  if (pixmap.isNull()) {
+    mFailed.insert(key, QDateTime::currentDateTime());
+    return;
+  }
+
+  store(key, data);
+  insert(key, pixmap);
+
+  emit avatarReady(key, pixmap);
+}
+
+void AvatarCache::prune()
+{
+  if (mDiskSize >= 0 && mDiskSize <= kMaxDiskSize)
+    return;
+
+  // Sorted newest first.
+  QFileInfoList infos = mDir.entryInfoList(QDir::Files, QDir::Time);
+
+  mDiskSize = 0;
+  foreach (const QFileInfo &info, infos)
+    mDiskSize += info.size();
+
+  // Leave some room to avoid scanning again on the next write.
+  while (mDiskSize > kMaxDiskSize * 3 / 4 && !infos.isEmpty()) {
+    QFileInfo info = infos.takeLast();
+    if (QFile::remove(info.filePath()))
+      mDiskSize -= info.size();
+  }
+}
+
+void AvatarCache::insert(const QByteArray &key, const QPixmap &pixmap)
+{
+  int cost = pixmap.width() * pixmap.height() * 4 / 1024;
+  mCache.insert(key, new QPixmap(pixmap), qMax(1, cost));
+}
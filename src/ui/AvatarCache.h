@@ -0,0 +1,75 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#ifndef AVATARCACHE_H
+#define AVATARCACHE_H
+
+#include <QCache>
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+
+class QNetworkReply;
+
+// Avatars shared by every window. Images are kept in memory and on
+// disk. Expired images are still returned but refreshed in the
+// background. Concurrent requests for the same avatar are coalesced.
+// Failed requests aren't retried for a while.
+class AvatarCache : public QObject
+{
+  Q_OBJECT
+
+public:
+  AvatarCache(const QDir &dir, QObject *parent = nullptr);
+
+  // Get the avatar for the email at the given pixel size. Returns a
+  // null pixmap and requests the image if it isn't cached yet.
+  QPixmap avatar(const QString &email, int size);
+
+  // Load or request avatars before they're shown.
+  void prefetch(const QStringList &emails, int size);
+
+  // Set the URL used to request images. The first argument is
+  // the hash of the email and the second is the pixel size.
+  void setUrl(const QString &url);
+
+  static QByteArray key(const QString &email, int size);
+
+  // Get the pixel size of avatars shown in the given widget.
+  static int size(const QWidget *widget);
+
+  static AvatarCache *instance();
+
+signals:
+  void avatarReady(const QByteArray &key, const QPixmap &avatar);
+
+private:
+  QPixmap load(const QByteArray &key, bool &stale);
+  void store(const QByteArray &key, const QByteArray &data);
+  void request(const QByteArray &key);
+  void finish(QNetworkReply *reply);
+  void prune();
+
+  void insert(const QByteArray &key, const QPixmap &pixmap);
+
+  QDir mDir;
+  QString mUrl;
+  qint64 mDiskSize = -1;
+
+  QNetworkAccessManager mMgr;
+  QCache<QByteArray,QPixmap> mCache;
+  QSet<QByteArray> mPending;
+  QHash<QByteArray,QDateTime> mFailed;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #include "FindWidget.h"
 #include "MenuBar.h"
 #include "RepoView.h"
+#include "Scheduler.h"
 #include "editor/TextEditor.h"
 #include "git/Blame.h"
 #include "git/Blob.h"
@@ -27,7 +28,6 @@
 #include <QSplitter>
 #include <QTextStream>
 #include <QVBoxLayout>
-#include <QtConcurrent>
 
 namespace {
 
@@ -167,8 +167,13 @@ bool BlameEditor::load(
   // Calculate blame.
   if (mRepo.isValid() && !content.isEmpty()) {
     mMargin->startBlame(name);
-    mBlame.setFuture(QtConcurrent::run(
-      mRepo, &git::Repository::blame, name, commit, mCallbacks.data()));
+    git::Repository repo = mRepo;
+    git::Blame::Callbacks *callbacks = mCallbacks.data();
+    Scheduler *scheduler = Scheduler::instance();
+    mBlame.setFuture(scheduler->run(Scheduler::Interactive, mRepo,
+    [repo, name, commit, callbacks] {
+      return repo.blame(name, commit, callbacks);
+    }));
   }
 
   return true;
@@ -178,8 +183,10 @@ void BlameEditor::cancelBlame()
 {
   BlameCallbacks *callbacks = static_cast<BlameCallbacks *>(mCallbacks.data());
   callbacks->setCanceled(true);
-  if (mBlame.isRunning())
+  if (mBlame.isRunning()) {
+    mBlame.cancel();
     mBlame.waitForFinished();
+  }
   mBlame.setFuture(QFuture<git::Blame>());
   callbacks->setCanceled(false);
 }
@@ -13,6 +13,7 @@
 #include <QFormLayout>
 #include <QItemDelegate>
 #include <QLabel>
+#include <QListView>
 #include <QMouseEvent>
 #include <QPainter>
 #include <QPainterPath>
@@ -31,6 +32,9 @@ namespace {
 const QString kNameFmt = "<p style='font-size: large'>%1</p>";
 const QString kLabelFmt = "<p style='color: gray; font-weight: bold'>%1</p>";
 
+// Lay out large directories a batch at a time.
+const int kBatchSize = 256;
+
 class PreviewWidget : public QFrame
 {
   Q_OBJECT
@@ -239,6 +243,13 @@ QAbstractItemView *ColumnView::createColumn(const QModelIndex &index)
   QAbstractItemView *view = QColumnView::createColumn(index);
   view->setItemDelegate(mSharedDelegate);
   view->viewport()->installEventFilter(this);
+
+  // Show the first rows without waiting for the whole directory.
+  if (QListView *list = qobject_cast<QListView *>(view)) {
+    list->setLayoutMode(QListView::Batched);
+    list->setBatchSize(kBatchSize);
+  }
+
   return view;
 }
 
@@ -8,11 +8,13 @@
 //
 
 #include "CommitList.h"
+#include "AvatarCache.h"
 #include "Badge.h"
 #include "Location.h"
 #include "MainWindow.h"
 #include "ProgressIndicator.h"
 #include "RepoView.h"
+#include "Scheduler.h"
 #include "app/Application.h"
 #include "conf/Settings.h"
 #include "dialogs/MergeDialog.h"
@@ -23,19 +25,24 @@
 #include "git/Diff.h"
 #include "git/Index.h"
 #include "git/Patch.h"
+#include "git/ReferenceSnapshot.h"
 #include "git/RevWalk.h"
 #include "git/Signature.h"
 #include "git/TagRef.h"
 #include "git/Tree.h"
+#include "trace/Trace.h"
 #include <QAbstractListModel>
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QMenu>
+#include <QMutex>
 #include <QPainter>
 #include <QPainterPath>
 #include <QPushButton>
+#include <QScrollBar>
 #include <QStyledItemDelegate>
 #include <QTextLayout>
-#include <QtConcurrent>
 
 namespace {
 
@@ -44,6 +51,12 @@ const QColor kTaintedColor = Qt::gray;
 
 const QString kPathspecFmt = "pathspec:%1";
 
+// Fall back to a full status scan for larger change sets.
+const int kMaxStatusPaths = 2048;
+
+// Show the staged changes when the workdir scan takes longer than this.
+const int kPartialStatusDelay = 200;
+
 // Use fixed short id size in compact mode.
 // FIXME: Use 'core.abbrev' config instead?
 const int kShortIdSize = 7;
@@ -77,13 +90,46 @@ public:
     mCanceled = canceled;
   }
 
+  void reset()
+  {
+    QMutexLocker locker(&mMutex);
+    mPartial = git::Diff();
+    mDeltaCount.storeRelaxed(0);
+  }
+
+  git::Diff partialDiff() const
+  {
+    QMutexLocker locker(&mMutex);
+    return mPartial;
+  }
+
+  int deltaCount() const
+  {
+    return mDeltaCount.loadRelaxed();
+  }
+
   bool progress(const QString &oldPath, const QString &newPath) override
   {
     return !mCanceled;
   }
 
+  void partial(const git::Diff &diff) override
+  {
+    QMutexLocker locker(&mMutex);
+    mPartial = diff;
+  }
+
+  void delta(const QString &path) override
+  {
+    mDeltaCount.ref();
+  }
+
 private:
   bool mCanceled = false;
+
+  mutable QMutex mMutex;
+  git::Diff mPartial;
+  QAtomicInt mDeltaCount;
 };
 
 class CommitModel : public QAbstractListModel
@@ -97,6 +143,17 @@ public:
     // Connect progress timer.
     connect(&mTimer, &QTimer::timeout, [this] {
       ++mProgress;
+
+      // Show the staged changes while the workdir is scanned.
+      if (!mPartialStatus.isValid() &&
+          mStatusTime.hasExpired(kPartialStatusDelay)) {
+        git::Diff diff = mStatusCallbacks.partialDiff();
+        if (diff.isValid() && diff.count()) {
+          mPartialStatus = diff;
+          emit statusPartial();
+        }
+      }
+
       QModelIndex idx = index(0, 0);
       emit dataChanged(idx, idx, {Qt::DisplayRole});
     });
@@ -104,6 +161,8 @@ public:
     // Connect watcher to signal when the status diff finishes.
     connect(&mStatus, &QFutureWatcher<git::Diff>::finished, [this] {
       mTimer.stop();
+      mPartialStatus = git::Diff();
+      mStatusValid = !mStatus.isCanceled();
       resetWalker();
       emit statusFinished(!mRows.isEmpty() && !mRows.first().commit.isValid());
     });
@@ -111,8 +170,40 @@ public:
     git::RepositoryNotifier *notifier = repo.notifier();
     connect(notifier, &git::RepositoryNotifier::referenceUpdated,
             this, &CommitModel::resetReference);
-    connect(notifier, &git::RepositoryNotifier::workdirChanged, [this] {
-      resetReference(mRef);
+    connect(notifier, &git::RepositoryNotifier::workdirChanged,
+    [this](const QStringList &paths) {
+      if (!mRef.isValid() || mRef.isHead())
+        startStatus(paths);
+
+      resetWalker();
+    });
+
+    // The partial status can be staged while the scan is still reading
+    // the index. Stop the scan before the write and start it again after.
+    connect(notifier, &git::RepositoryNotifier::indexAboutToBeChanged,
+    this, [this] {
+      if (cancelStatus())
+        mStatusDeferred = true;
+    });
+    connect(notifier, &git::RepositoryNotifier::indexChanged, this, [this] {
+      if (mStatusDeferred && !mStatusSuspended) {
+        mStatusDeferred = false;
+        startStatus();
+      }
+    });
+
+    // Walk again only if the change affects the walk.
+    connect(notifier, &git::RepositoryNotifier::appConfigChanged,
+    this, [this] {
+      bool refsAll = mRefsAll;
+      bool sortDate = mSortDate;
+      bool cleanStatus = mCleanStatus;
+      bool graphVisible = mGraphVisible;
+      resetSettings();
+
+      if (mRefsAll != refsAll || mSortDate != sortDate ||
+          mCleanStatus != cleanStatus || mGraphVisible != graphVisible)
+        resetWalker();
     });
 
     resetSettings();
@@ -135,8 +226,19 @@ public:
     return future.result();
   }
 
-  void startStatus()
+  void startStatus(const QStringList &paths = QStringList())
   {
+    // Scan everything when status resumes.
+    if (mStatusSuspended) {
+      mStatusDeferred = true;
+      return;
+    }
+
+    // Only the changed paths and the paths that were already dirty
+    // can differ from the last complete status. Everything else is
+    // known to be clean and doesn't need to be scanned again.
+    QStringList pathspec = statusPaths(paths);
+
     // Cancel existing status diff.
     cancelStatus();
 
@@ -146,23 +248,81 @@ public:
 
     // Check for uncommitted changes asynchronously.
     mProgress = 0;
+    mStatusTime.start();
+    mStatusCallbacks.reset();
     mTimer.start(50);
-    mStatus.setFuture(QtConcurrent::run([this] {
+    Scheduler *scheduler = Scheduler::instance();
+    mStatus.setFuture(scheduler->run(Scheduler::Interactive, mRepo, [this, pathspec] {
       // Pass the repo's index to suppress reload.
       bool ignoreWhitespace = Settings::instance()->isWhitespaceIgnored();
-      return mRepo.status(mRepo.index(), &mStatusCallbacks, ignoreWhitespace);
+      return mRepo.status(
+        mRepo.index(), &mStatusCallbacks, ignoreWhitespace, pathspec);
     }));
   }
 
-  void cancelStatus()
+  bool cancelStatus()
   {
     if (!mStatus.isRunning())
-      return;
+      return false;
+
+    // The canceled result is incomplete.
+    mStatusValid = false;
+    mPartialStatus = git::Diff();
 
+    // Canceling the future skips a status that hasn't started yet.
     mStatusCallbacks.setCanceled(true);
+    mStatus.cancel();
     mStatus.waitForFinished();
     mStatus.setFuture(QFuture<git::Diff>());
     mStatusCallbacks.setCanceled(false);
+    return true;
+  }
+
+  // Hold status while another thread writes to the index and workdir.
+  // Status that was canceled or requested in the meantime runs again
+  // as a full scan when it resumes.
+  void setStatusSuspended(bool suspended)
+  {
+    if (mStatusSuspended == suspended)
+      return;
+
+    mStatusSuspended = suspended;
+    if (suspended) {
+      if (cancelStatus())
+        mStatusDeferred = true;
+      return;
+    }
+
+    if (mStatusDeferred) {
+      mStatusDeferred = false;
+      startStatus();
+    }
+  }
+
+  QStringList statusPaths(const QStringList &paths) const
+  {
+    if (paths.isEmpty() || paths.size() > kMaxStatusPaths ||
+        !mStatusValid || !mStatus.isFinished())
+      return QStringList();
+
+    // Changes to ignore and attribute rules can affect any path.
+    foreach (const QString &path, paths) {
+      QString name = path.section('/', -1);
+      if (name == ".gitignore" || name == ".gitattributes")
+        return QStringList();
+    }
+
+    QSet<QString> result = QSet<QString>(paths.begin(), paths.end());
+    if (git::Diff diff = status()) {
+      int count = diff.count();
+      if (count > kMaxStatusPaths)
+        return QStringList();
+
+      for (int i = 0; i < count; ++i)
+        result.insert(diff.name(i));
+    }
+
+    return result.values();
   }
 
   void setPathspec(const QString &pathspec)
@@ -196,6 +356,7 @@ public:
 
   void resetWalker()
   {
+    Trace::Span span("ui", "CommitModel::resetWalker");
     beginResetModel();
 
     // Reset state.
@@ -251,6 +412,7 @@ public:
       fetchMore(QModelIndex());
 
     endResetModel();
+    span.setArg("rows", mRows.size());
   }
 
   void resetSettings(bool walk = false)
@@ -272,6 +434,8 @@ public:
 
   void fetchMore(const QModelIndex &parent)
   {
+    Trace::Span span("ui", "CommitModel::fetchMore");
+
     // Load commits.
     int i = 0;
     QList<Row> rows;
@@ -331,6 +495,9 @@ public:
       endInsertRows();
     }
 
+    span.setArg("rows", rows.size());
+    Trace::counter("ui", "commits", mRows.size());
+
     // Invalidate walker.
     if (!commit.isValid())
       mWalker = git::RevWalk();
@@ -350,8 +517,13 @@ public:
         if (!status)
           return QVariant();
 
-        return mStatus.isFinished() ? tr("Uncommitted changes") :
-               tr("Checking for uncommitted changes");
+        if (mStatus.isFinished())
+          return tr("Uncommitted changes");
+
+        if (int count = mStatusCallbacks.deltaCount())
+          return tr("Checking for uncommitted changes (%1 found)").arg(count);
+
+        return tr("Checking for uncommitted changes");
 
       case Qt::FontRole: {
         if (!status)
@@ -376,7 +548,8 @@ public:
 
       case DiffRole: {
         if (status)
-          return QVariant::fromValue(this->status());
+          return QVariant::fromValue(
+            mStatus.isFinished() ? this->status() : mPartialStatus);
 
         bool ignoreWhitespace = Settings::instance()->isWhitespaceIgnored();
         git::Diff diff = row.commit.diff(git::Commit(), -1, ignoreWhitespace);
@@ -416,6 +589,7 @@ public:
   }
 
 signals:
+  void statusPartial();
   void statusFinished(bool visible);
 
 private:
@@ -584,6 +758,11 @@ private:
 
   DiffCallbacks mStatusCallbacks;
   QFutureWatcher<git::Diff> mStatus;
+  QElapsedTimer mStatusTime;
+  git::Diff mPartialStatus;
+  bool mStatusValid = false;
+  bool mStatusSuspended = false;
+  bool mStatusDeferred = false;
 
   QString mPathspec;
   git::Reference mRef;
@@ -1094,9 +1273,12 @@ private:
       mRefs[head.target().id()].append({head.name(), true});
     }
 
-    foreach (const git::Reference &ref, mRepo.refs()) {
-      if (git::Commit target = ref.target())
-        mRefs[target.id()].append({ref.name(), ref.isHead(), ref.isTag()});
+    // The snapshot has the targets already peeled.
+    git::ReferenceSnapshot refs = mRepo.refSnapshot();
+    foreach (const git::Reference &ref, refs.refs()) {
+      git::Id id = refs.target(ref.qualifiedName());
+      if (id.isValid())
+        mRefs[id].append({ref.name(), ref.isHead(), ref.isTag()});
     }
   }
 
@@ -1175,6 +1357,12 @@ CommitList::CommitList(Index *index, QWidget *parent)
           this, &CommitList::restoreSelection);
 
   CommitModel *model = static_cast<CommitModel *>(mModel);
+  connect(model, &CommitModel::statusPartial, [this] {
+    // Show the staged changes if the status is selected.
+    if (selectionModel()->isSelected(mModel->index(0, 0)))
+      resetSelection();
+  });
+
   connect(model, &CommitModel::statusFinished, [this](bool visible) {
     // Fake a selection notification if the diff is visible and selected.
     if (visible && selectionModel()->isSelected(mModel->index(0, 0)))
@@ -1192,6 +1380,17 @@ CommitList::CommitList(Index *index, QWidget *parent)
     update(index);
   });
 
+  // Wait for scrolling to settle before prefetching.
+  mPrefetchTimer.setInterval(200);
+  mPrefetchTimer.setSingleShot(true);
+  connect(&mPrefetchTimer, &QTimer::timeout, this, &CommitList::prefetch);
+  connect(verticalScrollBar(), &QScrollBar::valueChanged,
+          &mPrefetchTimer, QOverload<>::of(&QTimer::start));
+  connect(mModel, &QAbstractItemModel::modelReset,
+          &mPrefetchTimer, QOverload<>::of(&QTimer::start));
+  connect(mList, &QAbstractItemModel::modelReset,
+          &mPrefetchTimer, QOverload<>::of(&QTimer::start));
+
   git::RepositoryNotifier *notifier = repo.notifier();
   connect(notifier, &git::RepositoryNotifier::referenceUpdated,
   [this](const git::Reference &ref) {
@@ -1269,9 +1468,14 @@ QList<git::Commit> CommitList::selectedCommits() const
   return selectedCommits;
 }
 
-void CommitList::cancelStatus()
+bool CommitList::cancelStatus()
+{
+  return static_cast<CommitModel *>(mModel)->cancelStatus();
+}
+
+void CommitList::setStatusSuspended(bool suspended)
 {
-  static_cast<CommitModel *>(mModel)->cancelStatus();
+  static_cast<CommitModel *>(mModel)->setStatusSuspended(suspended);
 }
 
 void CommitList::setReference(const git::Reference &ref)
@@ -1790,6 +1994,34 @@ void CommitList::notifySelectionChanged()
   emit diffSelected(selectedDiff(), mFile, mSpontaneous);
 }
 
+void CommitList::prefetch()
+{
+  QRect rect = viewport()->rect();
+  QModelIndex first = indexAt(rect.topLeft());
+  if (!first.isValid())
+    return;
+
+  QModelIndex last = indexAt(rect.bottomLeft());
+  int end = last.isValid() ? last.row() : model()->rowCount() - 1;
+
+  QStringList oids;
+  QStringList emails;
+  for (int row = first.row(); row <= end; ++row) {
+    QModelIndex index = model()->index(row, 0);
+    git::Commit commit = index.data(CommitRole).value<git::Commit>();
+    if (commit.isValid()) {
+      oids.append(commit.id().toString());
+      emails.append(commit.author().email());
+    }
+  }
+
+  AvatarCache::instance()->prefetch(emails, AvatarCache::size(this));
+
+  // Request comments for the whole range in one batch.
+  if (Repository *remoteRepo = RepoView::parentView(this)->remoteRepo())
+    remoteRepo->account()->requestComments(remoteRepo, oids);
+}
+
 bool CommitList::isDecoration(const QModelIndex &index, const QPoint &pos)
 {
   if (!index.isValid())
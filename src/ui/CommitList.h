@@ -12,6 +12,7 @@
 
 #include "git/Reference.h"
 #include <QListView>
+#include <QTimer>
 
 class Index;
 
@@ -35,8 +36,11 @@ public:
   git::Diff selectedDiff() const;
   QList<git::Commit> selectedCommits() const;
 
-  // Cancel background status diff.
-  void cancelStatus();
+  // Cancel background status diff. Returns true if it was running.
+  bool cancelStatus();
+
+  // Defer status until resumed.
+  void setStatusSuspended(bool suspended);
 
   void setReference(const git::Reference &ref);
   void setFilter(const QString &filter);
@@ -84,6 +88,9 @@ private:
 
   void notifySelectionChanged();
 
+  // Request avatars and comments for visible rows.
+  void prefetch();
+
   bool isDecoration(const QModelIndex &index, const QPoint &pos);
   bool isStar(const QModelIndex &index, const QPoint &pos);
 
@@ -99,6 +106,8 @@ private:
   QAbstractListModel *mModel;
 
   QString mSelectedRange;
+
+  QTimer mPrefetchTimer;
 };
 
 #endif
@@ -8,6 +8,7 @@
 //
 
 #include "DetailView.h"
+#include "AvatarCache.h"
 #include "Badge.h"
 #include "ContextMenuButton.h"
 #include "DiffWidget.h"
@@ -27,7 +28,6 @@
 #include <QAbstractTextDocumentLayout>
 #include <QApplication>
 #include <QClipboard>
-#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDialog>
 #include <QDialogButtonBox>
@@ -36,15 +36,11 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QMessageBox>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
-#include <QNetworkRequest>
-#include <QPainter>
-#include <QPainterPath>
 #include <QPushButton>
 #include <QRegularExpression>
 #include <QStackedWidget>
 #include <QStyle>
+#include <QTextBoundaryFinder>
 #include <QTextEdit>
 #include <QToolButton>
 #include <QUrl>
@@ -54,11 +50,9 @@
 
 namespace {
 
-const int kSize = 64;
 const QString kSplitterKey = "detailSplitter";
 const int kSplitterTop = 120;
 const int kSplitterBottom = 1000;
-const char *kCacheKey = "cache_key";
 const QString kRangeFmt = "%1..%2";
 const QString kDateRangeFmt = "%1-%2";
 const QString kBoldFmt = "<b>%1</b>";
@@ -66,7 +60,6 @@ const QString kItalicFmt = "<i>%1</i>";
 const QString kLinkFmt = "<a href='%1'>%2</a>";
 const QString kAuthorFmt = "<b>%1 &lt;%2&gt;</b>";
 const QString kAltFmt = "<span style='color: %1'>%2</span>";
-const QString kUrl = "http://www.gravatar.com/avatar/%1?s=%2&d=mm";
 
 const QString kDictKey = "commit.spellcheck.dict";
 
@@ -273,8 +266,11 @@ public:
     layout->addWidget(mMessage);
     layout->addStretch();
 
-    connect(&mMgr, &QNetworkAccessManager::finished,
-            this, &CommitDetail::setPicture);
+    connect(AvatarCache::instance(), &AvatarCache::avatarReady, this,
+    [this](const QByteArray &key, const QPixmap &avatar) {
+      if (key == mPictureKey)
+        setPicture(avatar);
+    });
 
     RepoView *view = RepoView::parentView(this);
     connect(mHash, &QLabel::linkActivated, view, &RepoView::visitLink);
@@ -323,6 +319,7 @@ public:
     mParents->setText(QString());
     mMessage->setPlainText(QString());
     mPicture->setPixmap(QPixmap());
+    mPictureKey.clear();
 
     mParents->setVisible(false);
     mSeparator->setVisible(false);
@@ -405,49 +402,21 @@ public:
     QString msg = commit.message(git::Commit::SubstituteEmoji).trimmed();
     mMessage->setPlainText(msg);
 
-    int size = kSize * window()->windowHandle()->devicePixelRatio();
-    QByteArray email = commit.author().email().trimmed().toLower().toUtf8();
-    QByteArray hash = QCryptographicHash::hash(email, QCryptographicHash::Md5);
-
-    // Check the cache first.
-    QByteArray key = hash.toHex() + '@' + QByteArray::number(size);
-    mPicture->setPixmap(mCache.value(key));
-
-    // Request the image from gravatar.
-    if (!mCache.contains(key)) {
-      QUrl url(kUrl.arg(QString::fromUtf8(hash.toHex()), QString::number(size)));
-      QNetworkReply *reply = mMgr.get(QNetworkRequest(url));
-      reply->setProperty(kCacheKey, key);
-    }
+    // The picture is set when it's ready if it isn't cached.
+    QString email = commit.author().email();
+    int size = AvatarCache::size(this);
+    mPictureKey = AvatarCache::key(email, size);
+    setPicture(AvatarCache::instance()->avatar(email, size));
 
     // Remember the id.
     mId = commit.id().toString();
   }
 
-  void setPicture(QNetworkReply *reply)
+  void setPicture(const QPixmap &avatar)
   {
-    // Load source.
-    QPixmap source;
-    source.loadFromData(reply->readAll());
-
-    // Render clipped to circle.
-    QPixmap pixmap(source.size());
-    pixmap.fill(Qt::transparent);
-
-    // Clip to path. The region overload doesn't antialias.
-    QPainterPath path;
-    path.addEllipse(pixmap.rect());
-
-    QPainter painter(&pixmap);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setClipPath(path);
-    painter.drawPixmap(0, 0, source);
-
-    // Cache the transformed pixmap.
+    QPixmap pixmap = avatar;
     pixmap.setDevicePixelRatio(window()->windowHandle()->devicePixelRatio());
-    mCache.insert(reply->property(kCacheKey).toByteArray(), pixmap);
     mPicture->setPixmap(pixmap);
-    reply->deleteLater();
   }
 
   void cancelBackgroundTasks()
@@ -466,8 +435,7 @@ private:
   AuthorDate *mAuthorDate;
 
   QString mId;
-  QNetworkAccessManager mMgr;
-  QMap<QByteArray,QPixmap> mCache;
+  QByteArray mPictureKey;
   QFutureWatcher<QString> mWatcher;
 };
 
@@ -490,6 +458,17 @@ public:
     connect(this, &QTextEdit::textChanged, [this] {
       mTimer.start(500);
     });
+
+    // Check again after unknown words have been looked up.
+    connect(&mWatcher, &QFutureWatcher<void>::finished, [this] {
+      if (mSpellChecker)
+        checkSpelling();
+    });
+  }
+
+  ~TextEdit()
+  {
+    mWatcher.waitForFinished();
   }
 
   bool setupSpellCheck(
@@ -498,10 +477,12 @@ public:
     const QTextCharFormat &spellFormat,
     const QTextCharFormat &ignoredFormat)
   {
-    mSpellChecker = new SpellChecker(dictPath, userDict);
+    // Previous results came from a different dictionary.
+    resetSpelling();
+
+    mSpellChecker.reset(new SpellChecker(dictPath, userDict));
     if (!mSpellChecker->isValid()) {
-      delete mSpellChecker;
-      mSpellChecker = nullptr;
+      mSpellChecker.reset();
       mSpellList.clear();
       setSelections();
       return false;
@@ -570,29 +551,22 @@ private:
           QTextCursor cursor = cursorForPosition(event->pos());
           cursor.select(QTextCursor::WordUnderCursor);
 
-          for (int i = 0; i < mSpellList.count(); i++) {
-            QTextEdit::ExtraSelection es = mSpellList.at(i);
-            if (es.cursor == cursor) {
-              mSpellList.removeAt(i);
-              es.format = mIgnoredFormat;
-              mSpellList << es;
-
-              setSelections();
-              break;
-            }
-          }
+          // The cursor tracks edits to the document.
+          mIgnored.append(cursor);
           checkSpelling();
         });
 
         QAction *spellIgnoreAll = menu->addAction(tr("Ignore All"));
         connect(spellIgnoreAll, &QAction::triggered, [this, word] {
           mSpellChecker->ignoreWord(word);
+          resetSpelling();
           checkSpelling();
         });
 
         QAction *spellAdd = menu->addAction(tr("Add to User Dictionary"));
         connect(spellAdd, &QAction::triggered, [this, word] {
           mSpellChecker->addToUserDict(word);
+          resetSpelling();
           checkSpelling();
         });
         break;
@@ -609,12 +583,9 @@ private:
           QTextCursor cursor = cursorForPosition(event->pos());
           cursor.select(QTextCursor::WordUnderCursor);
 
-          for (int i = 0; i < mSpellList.count(); i++) {
-            QTextEdit::ExtraSelection es = mSpellList.at(i);
-            if (es.cursor == cursor) {
-              mSpellList.removeAt(i);
-
-              setSelections();
+          for (int i = 0; i < mIgnored.count(); i++) {
+            if (mIgnored.at(i) == cursor) {
+              mIgnored.removeAt(i);
               break;
             }
           }
@@ -647,33 +618,145 @@ private:
     }
   }
 
+  // Per-block spelling results. Blocks are checked again
+  // only after their revision changes.
+  class SpellData : public QTextBlockUserData
+  {
+  public:
+    int revision = -1;
+    QList<QPair<int,int>> misspelled;
+    QList<QPair<int,int>> ignored;
+    QList<QTextEdit::ExtraSelection> selections;
+  };
+
   void checkSpelling()
   {
-    QTextCursor cursor(document());
+    QSet<QString> unknown;
+    QSet<QPair<int,int>> ignored = ignoredRanges();
+
     mSpellList.clear();
+    for (QTextBlock block = document()->begin();
+         block.isValid(); block = block.next()) {
+      SpellData *data = static_cast<SpellData *>(block.userData());
+      if (!data) {
+        data = new SpellData;
+        block.setUserData(data);
+      }
 
-    while (!cursor.atEnd()) {
-      cursor.movePosition(QTextCursor::EndOfWord,
-                          QTextCursor::KeepAnchor, 1);
-      QString word = wordAt(cursor);
-      if (!word.isEmpty() && !mSpellChecker->spell(word)) {
-        // Highlight the unknown or ignored word.
-        QTextEdit::ExtraSelection es;
-        es.cursor = cursor;
-        es.format = ignoredAt(cursor) ? mIgnoredFormat : mSpellFormat;
-
-        mSpellList << es;
+      // Selections of unchanged blocks are kept unless their ignored
+      // words changed. Their cursors track edits to other blocks.
+      QList<QPair<int,int>> blockIgnored;
+      foreach (const auto &range, data->misspelled) {
+        int pos = block.position() + range.first;
+        if (ignored.contains({pos, pos + range.second}))
+          blockIgnored.append(range);
       }
-      cursor.movePosition(QTextCursor::NextWord,
-                          QTextCursor::MoveAnchor, 1);
+
+      bool changed = (blockIgnored != data->ignored);
+      if (data->revision != block.revision()) {
+        changed = true;
+
+        // Use cached results. Look up unknown words in the background.
+        bool complete = true;
+        data->misspelled.clear();
+        QString text = block.text();
+        foreach (const auto &range, words(text)) {
+          bool correct = true;
+          QString word = text.mid(range.first, range.second);
+          if (!mSpellChecker->isCached(word, correct)) {
+            unknown.insert(word);
+            complete = false;
+          } else if (!correct) {
+            data->misspelled.append(range);
+          }
+        }
+
+        if (complete)
+          data->revision = block.revision();
+      }
+
+      // Highlight the unknown or ignored words.
+      if (changed) {
+        data->ignored.clear();
+        data->selections.clear();
+        foreach (const auto &range, data->misspelled) {
+          int pos = block.position() + range.first;
+          QTextEdit::ExtraSelection es;
+          es.cursor = QTextCursor(document());
+          es.cursor.setPosition(pos);
+          es.cursor.setPosition(pos + range.second, QTextCursor::KeepAnchor);
+          bool ignore = ignored.contains({pos, pos + range.second});
+          es.format = ignore ? mIgnoredFormat : mSpellFormat;
+          if (ignore)
+            data->ignored.append(range);
+
+          data->selections << es;
+        }
+      }
+
+      mSpellList << data->selections;
     }
+
     setSelections();
+
+    // Check again when the lookup finishes.
+    if (!unknown.isEmpty() && !mWatcher.isRunning()) {
+      QSharedPointer<SpellChecker> checker = mSpellChecker;
+      mWatcher.setFuture(QtConcurrent::run([checker, unknown] {
+        foreach (const QString &word, unknown)
+          checker->spell(word);
+      }));
+    }
+  }
+
+  void resetSpelling()
+  {
+    for (QTextBlock block = document()->begin();
+         block.isValid(); block = block.next()) {
+      if (SpellData *data = static_cast<SpellData *>(block.userData()))
+        data->revision = -1;
+    }
+  }
+
+  // Find word ranges in the text. Punctuation
+  // etc. at the start doesn't belong to words.
+  QList<QPair<int,int>> words(const QString &text)
+  {
+    QList<QPair<int,int>> words;
+    QTextBoundaryFinder finder(QTextBoundaryFinder::Word, text);
+
+    int start = -1;
+    for (int pos = finder.position(); pos >= 0; pos = finder.toNextBoundary()) {
+      QTextBoundaryFinder::BoundaryReasons reasons = finder.boundaryReasons();
+      if (start >= 0 && (reasons & QTextBoundaryFinder::EndOfItem)) {
+        while (start < pos && !text.at(start).isLetter())
+          ++start;
+
+        if (start < pos)
+          words.append({start, pos - start});
+
+        start = -1;
+      }
+
+      if (reasons & QTextBoundaryFinder::StartOfItem)
+        start = pos;
+    }
+
+    return words;
+  }
+
+  QSet<QPair<int,int>> ignoredRanges()
+  {
+    QSet<QPair<int,int>> ranges;
+    foreach (const QTextCursor &cursor, mIgnored)
+      ranges.insert({cursor.selectionStart(), cursor.selectionEnd()});
+    return ranges;
   }
 
   bool ignoredAt(const QTextCursor &cursor)
   {
-    foreach (const QTextEdit::ExtraSelection &es, extraSelections()) {
-      if (es.cursor == cursor && es.format == mIgnoredFormat)
+    foreach (const QTextCursor &ignored, mIgnored) {
+      if (ignored == cursor)
         return true;
     }
 
@@ -704,11 +787,13 @@ private:
   }
 
   QTimer mTimer;
+  QFutureWatcher<void> mWatcher;
 
-  SpellChecker *mSpellChecker = nullptr;
+  QSharedPointer<SpellChecker> mSpellChecker;
   QTextCharFormat mSpellFormat;
   QTextCharFormat mIgnoredFormat;
   QList<QTextEdit::ExtraSelection> mSpellList;
+  QList<QTextCursor> mIgnored;
 };
 
 class CommitEditor : public QFrame
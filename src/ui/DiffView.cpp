@@ -31,11 +31,14 @@
 #include "git2/diff.h"
 #include "git2/index.h"
 #include "log/LogEntry.h"
+#include "trace/Trace.h"
 #include <QCheckBox>
 #include <QDir>
 #include <QFileIconProvider>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QHeaderView>
+#include <QImageReader>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -50,6 +53,7 @@
 #include <QSaveFile>
 #include <QScrollBar>
 #include <QShortcut>
+#include <QStringMatcher>
 #include <QStyleOption>
 #include <QTableWidget>
 #include <QTextEdit>
@@ -58,6 +62,7 @@
 #include <QTimer>
 #include <QToolButton>
 #include <QVBoxLayout>
+#include <QtConcurrent>
 #include <QtMath>
 
 namespace {
@@ -92,6 +97,18 @@ const QString kCompactSytleSheet =
   "  border-top-width: 4;"
   "}";
 
+// Check the beginning and end of an untracked file for binary content.
+bool isBinaryFile(QFile &dev)
+{
+  QByteArray head = dev.read(1024);
+  if (git::Buffer(head.constData(), head.length()).isBinary())
+    return true;
+
+  dev.seek(qMax(dev.size() - 1024, qint64(0)));
+  QByteArray tail = dev.read(1024);
+  return git::Buffer(tail.constData(), tail.length()).isBinary();
+}
+
 const QString kButtonStyleFmt =
   "QToolButton {"
   "  background: %1"
@@ -512,11 +529,81 @@ public:
   ImageContentWidget(
     const git::Patch patch,
     bool lfs = false,
+    DiffView *view = nullptr,
     QWidget *parent = nullptr)
-    : BinaryContentWidget(parent), mPatch(patch)
+    : BinaryContentWidget(parent), mPatch(patch), mLfs(lfs)
+  {
+    QHBoxLayout *layout = new QHBoxLayout(this);
+    layout->setContentsMargins(6, 4, 8, 4);
+
+    // Only wait for objects that can be shown as an image. Anything
+    // else fails right away so that the default content is shown.
+    if (lfs && view && !isImage(mPatch.name())) {
+      failure = true;
+      return;
+    }
+
+    if (lfs && view) {
+      // Resolve objects that aren't in local storage in the background.
+      git::Repository repo = mPatch.repo();
+      QList<git::Diff::File> types = {git::Diff::OldFile, git::Diff::NewFile};
+      foreach (git::Diff::File type, types) {
+        git::Blob blob = mPatch.blob(type);
+        if (!blob.isValid())
+          continue;
+
+        QByteArray pointer = blob.content();
+        QByteArray object = repo.lfsObject(pointer);
+        if (object.isNull()) {
+          mPending.insert(pointer);
+        } else {
+          mObjects.insert(pointer, object);
+        }
+      }
+
+      if (!mPending.isEmpty()) {
+        QLabel *label = new QLabel(tr("Loading LFS object..."), this);
+        label->setAlignment(Qt::AlignCenter);
+        layout->addWidget(label);
+
+        connect(view, &DiffView::lfsObjectFetched, this,
+        [this, label](const QByteArray &pointer, const QByteArray &object) {
+          if (!mPending.remove(pointer))
+            return;
+
+          mObjects.insert(pointer, object);
+          if (mPending.isEmpty()) {
+            delete label;
+            load();
+
+            // It's too late to be replaced, so show the default content.
+            if (failure)
+              this->layout()->addWidget(
+                new DefaultContentWidget(mPatch, mLfs, this));
+          }
+        });
+
+        foreach (const QByteArray &pointer, mPending)
+          view->fetchLfsObject(pointer, mPatch.name());
+
+        return;
+      }
+    }
+
+    load();
+  }
+
+private:
+  static bool isImage(const QString &name)
+  {
+    QByteArray suffix = QFileInfo(name).suffix().toLower().toUtf8();
+    return QImageReader::supportedImageFormats().contains(suffix);
+  }
+
+  void load()
   {
     int size = 0;
-    QPixmap pixmap = loadPixmap(git::Diff::NewFile, size, lfs);
+    QPixmap pixmap = loadPixmap(git::Diff::NewFile, size);
     if (pixmap.isNull()) {
       QString path = mPatch.repo().workdir().filePath(mPatch.name());
       size = QFileInfo(path).size();
@@ -528,11 +615,10 @@ public:
       return;
     }
 
-    QHBoxLayout *layout = new QHBoxLayout(this);
-    layout->setContentsMargins(6, 4, 8, 4);
+    QHBoxLayout *layout = static_cast<QHBoxLayout *>(this->layout());
 
     int beforeSize = 0;
-    QPixmap before = loadPixmap(git::Diff::OldFile, beforeSize, lfs);
+    QPixmap before = loadPixmap(git::Diff::OldFile, beforeSize);
     if (!before.isNull()) {
       layout->addLayout(imageLayout(before, beforeSize), 1);
       layout->addWidget(new Arrow(this));
@@ -542,7 +628,6 @@ public:
     layout->addStretch();
   }
 
-private:
   class Image : public QWidget
   {
   public:
@@ -625,7 +710,7 @@ private:
     }
   };
 
-  QPixmap loadPixmap(git::Diff::File type, int &size, bool lfs)
+  QPixmap loadPixmap(git::Diff::File type, int &size)
   {
     git::Blob blob = mPatch.blob(type);
     if (!blob.isValid())
@@ -633,8 +718,10 @@ private:
 
     QByteArray data = blob.content();
 
-    if (lfs)
-      data = mPatch.repo().lfsSmudge(data, mPatch.name());
+    if (mLfs) {
+      data = mObjects.contains(data) ?
+        mObjects.value(data) : mPatch.repo().lfsSmudge(data, mPatch.name());
+    }
 
     size = data.length();
 
@@ -665,6 +752,10 @@ private:
   }
 
   git::Patch mPatch;
+  bool mLfs;
+
+  QSet<QByteArray> mPending;
+  QMap<QByteArray,QByteArray> mObjects;
 };
 
 class HunkWidget : public QFrame
@@ -1098,6 +1189,9 @@ public:
 
   Header *header() const { return mHeader; }
 
+  // The index of the hunk in the patch, or -1 for the whole file.
+  int index() const { return mIndex; }
+
   TextEditor *editor(bool ensureLoaded = true) {
     if (ensureLoaded)
       load();
@@ -1109,6 +1203,7 @@ public:
     mEditor->setReadOnly(false);
     mEditor->clearAll();
     mLoaded = false;
+    ++mGeneration;
     update();
   }
 
@@ -1175,13 +1270,24 @@ private:
     return list.join('\n');
   }
 
+  bool isLoaded() const { return mLoaded; }
+
   void load()
   {
     if (mLoaded)
       return;
 
     mLoaded = true;
+    loadContent();
 
+    // Highlight find matches.
+    QString text = mView->highlightText();
+    if (!text.isEmpty())
+      mEditor->highlightAll(text);
+  }
+
+  void loadContent()
+  {
     // Load entire file.
     git::Repository repo = mPatch.repo();
     if (mIndex < 0) {
@@ -1457,12 +1563,60 @@ private:
     }
 
     // Execute hunk plugins.
+    runPlugins();
+
+    mEditor->updateGeometry();
+  }
+
+  void runPlugins()
+  {
+    QList<PluginRef> plugins;
     foreach (PluginRef plugin, mView->plugins()) {
       if (plugin->isValid() && plugin->isEnabled())
-        plugin->hunk(mEditor);
+        plugins.append(plugin);
     }
 
-    mEditor->updateGeometry();
+    if (plugins.isEmpty())
+      return;
+
+    // Copy the text and each plugin's config values here. Split the
+    // text and run the plugins in the background.
+    QList<Plugin::Values> values;
+    foreach (PluginRef plugin, plugins)
+      values.append(plugin->values());
+
+    int generation = mGeneration;
+    Plugin::Text text = Plugin::snapshot(mEditor);
+
+    using Watcher = QFutureWatcher<Plugin::Diagnostics>;
+    Watcher *watcher = new Watcher(this);
+    connect(watcher, &Watcher::finished, watcher,
+    [this, watcher, generation] {
+      // Discard results for stale content.
+      if (generation == mGeneration) {
+        Plugin::Diagnostics diags = watcher->result();
+        foreach (int line, diags.keys()) {
+          foreach (const TextEditor::Diagnostic &diag, diags.value(line))
+            mEditor->addDiagnostic(line, diag);
+        }
+      }
+
+      watcher->deleteLater();
+    });
+
+    watcher->setFuture(QtConcurrent::run([plugins, values, text] {
+      Plugin::Hunk hunk = Plugin::split(text);
+
+      Plugin::Diagnostics result;
+      for (int i = 0; i < plugins.size(); ++i) {
+        Plugin::Diagnostics diags;
+        plugins.at(i)->hunk(hunk, values.at(i), diags);
+        foreach (int line, diags.keys())
+          result[line].append(diags.value(line));
+      }
+
+      return result;
+    }));
   }
 
   void chooseLines(TextEditor::Marker kind)
@@ -1488,6 +1642,7 @@ private:
   Header *mHeader;
   TextEditor *mEditor;
   bool mLoaded = false;
+  int mGeneration = 0;
 };
 
 class LineStats : public QWidget
@@ -1896,17 +2051,8 @@ public:
     binary = patch.isBinary();
     if (patch.isUntracked()) {
       QFile dev(path);
-      if (dev.open(QFile::ReadOnly)) {
-        QByteArray content = dev.read(1024);
-        git::Buffer buffer(content.constData(), content.length());
-        binary = buffer.isBinary();
-        if (!binary) {
-          dev.seek(dev.size() - 1024);
-          QByteArray content = dev.read(1024);
-          git::Buffer buffer(content.constData(), content.length());
-          binary = buffer.isBinary();
-        }
-      }
+      if (dev.open(QFile::ReadOnly))
+        binary = isBinaryFile(dev);
     }
 
     lfs = patch.isLfsPointer();
@@ -2048,7 +2194,7 @@ public:
   {
     BinaryContentWidget *content = nullptr;
 
-    content = new ImageContentWidget(patch, lfs, this);
+    content = new ImageContentWidget(patch, lfs, mView, this);
     if (content->hasFailed()) {
       delete content;
       content = new DefaultContentWidget(patch, lfs, this);
@@ -2187,7 +2333,11 @@ DiffView::DiffView(const git::Repository &repo, QWidget *parent)
   }
 }
 
-DiffView::~DiffView() {}
+DiffView::~DiffView()
+{
+  if (mFindCanceled)
+    mFindCanceled->storeRelaxed(1);
+}
 
 QWidget *DiffView::file(int index)
 {
@@ -2197,6 +2347,9 @@ QWidget *DiffView::file(int index)
 
 void DiffView::setDiff(const git::Diff &diff)
 {
+  Trace::Span span("ui", "DiffView::setDiff");
+  span.setArg("files", diff.isValid() ? diff.count() : 0);
+
   RepoView *view = RepoView::parentView(this);
   git::Repository repo = view->repo();
 
@@ -2208,6 +2361,8 @@ void DiffView::setDiff(const git::Diff &diff)
   // Clear state.
   mFiles.clear();
   mStagedPatches.clear();
+  if (mFindCanceled)
+    mFindCanceled->storeRelaxed(1);
   mComments = Account::CommitComments();
 
   // Set data.
@@ -2346,6 +2501,129 @@ QList<TextEditor *> DiffView::editors()
   return editors;
 }
 
+QFuture<QList<EditorProvider::Hits>> DiffView::findAll(const QString &text)
+{
+  // Cancel the previous search.
+  if (mFindCanceled)
+    mFindCanceled->storeRelaxed(1);
+
+  QSharedPointer<QAtomicInt> canceled(new QAtomicInt(0));
+  mFindCanceled = canceled;
+
+  // Search raw patch content without creating widgets. Each patch is
+  // copied out of the diff under its lock, so the view can keep using it.
+  git::Diff diff = mDiff;
+  git::Repository repo = RepoView::parentView(this)->repo();
+  return QtConcurrent::run([diff, repo, text, canceled] {
+    QList<Hits> result;
+    if (!diff.isValid())
+      return result;
+
+    // Count non-overlapping matches like the editor does.
+    QStringMatcher matcher(text, Qt::CaseInsensitive);
+    auto count = [&matcher, &text](const QString &content) {
+      int matches = 0;
+      int pos = matcher.indexIn(content);
+      while (pos >= 0) {
+        ++matches;
+        pos = matcher.indexIn(content, pos + text.length());
+      }
+
+      return matches;
+    };
+
+    int patchCount = diff.count();
+    for (int pidx = 0; pidx < patchCount; ++pidx) {
+      if (canceled->loadRelaxed())
+        break;
+
+      git::Patch patch = diff.patch(pidx);
+      if (!patch.isValid())
+        break;
+
+      // Search untracked file content. Skip the same binary
+      // files as the view before reading the rest.
+      if (patch.isUntracked()) {
+        QFile dev(repo.workdir().filePath(patch.name()));
+        if (!dev.open(QFile::ReadOnly) || isBinaryFile(dev))
+          continue;
+
+        dev.seek(0);
+        QByteArray content = dev.readAll();
+        if (int matches = count(repo.decode(content)))
+          result.append({pidx, -1, matches});
+        continue;
+      }
+
+      if (patch.isBinary())
+        continue;
+
+      // Search each hunk.
+      for (int hidx = 0; hidx < patch.count(); ++hidx) {
+        QByteArray content;
+        int lineCount = patch.lineCount(hidx);
+        for (int lidx = 0; lidx < lineCount; ++lidx) {
+          char origin = patch.lineOrigin(hidx, lidx);
+          if (origin != GIT_DIFF_LINE_CONTEXT_EOFNL &&
+              origin != GIT_DIFF_LINE_ADD_EOFNL &&
+              origin != GIT_DIFF_LINE_DEL_EOFNL)
+            content += patch.lineContent(hidx, lidx);
+        }
+
+        if (int matches = count(repo.decode(content)))
+          result.append({pidx, hidx, matches});
+      }
+    }
+
+    return result;
+  });
+}
+
+TextEditor *DiffView::editor(const Hits &hits)
+{
+  fetchAll(hits.file);
+  if (hits.file >= mFiles.size())
+    return nullptr;
+
+  // Create the file content.
+  FileWidget *file = static_cast<FileWidget *>(mFiles.at(hits.file));
+  file->header()->disclosureButton()->setChecked(true);
+
+  // Hunks aren't always created for every patch index.
+  foreach (HunkWidget *hunk, file->hunks()) {
+    if (hunk->index() == hits.hunk)
+      return hunk->editor();
+  }
+
+  return nullptr;
+}
+
+QList<TextEditor *> DiffView::loadedEditors()
+{
+  QList<TextEditor *> editors;
+  foreach (QWidget *widget, mFiles) {
+    foreach (HunkWidget *hunk, static_cast<FileWidget *>(widget)->hunks()) {
+      if (hunk->isLoaded())
+        editors.append(hunk->editor(false));
+    }
+  }
+
+  return editors;
+}
+
+void DiffView::setHighlightText(const QString &text)
+{
+  mHighlightText = text;
+}
+
+void DiffView::fetchLfsObject(const QByteArray &pointer, const QString &file)
+{
+  if (mLfsRequests.isEmpty())
+    QTimer::singleShot(0, this, &DiffView::fetchLfsObjects);
+
+  mLfsRequests.insert(pointer, file);
+}
+
 void DiffView::ensureVisible(TextEditor *editor, int pos)
 {
   HunkWidget *hunk = static_cast<HunkWidget *>(editor->parentWidget());
@@ -2367,6 +2645,28 @@ void DiffView::ensureVisible(TextEditor *editor, int pos)
   }
 }
 
+void DiffView::fetchLfsObjects()
+{
+  QList<QByteArray> pointers = mLfsRequests.keys();
+  QStringList files = mLfsRequests.values();
+  mLfsRequests.clear();
+
+  // Smudge all missing objects with a single git-lfs process.
+  git::Repository repo = RepoView::parentView(this)->repo();
+  using Watcher = QFutureWatcher<QList<QByteArray>>;
+  Watcher *watcher = new Watcher(this);
+  connect(watcher, &Watcher::finished, this, [this, watcher, pointers] {
+    QList<QByteArray> objects = watcher->result();
+    for (int i = 0; i < pointers.size(); ++i)
+      emit lfsObjectFetched(pointers.at(i), objects.at(i));
+    watcher->deleteLater();
+  });
+
+  watcher->setFuture(QtConcurrent::run([repo, pointers, files]() mutable {
+    return repo.lfsSmudge(pointers, files);
+  }));
+}
+
 void DiffView::dropEvent(QDropEvent *event)
 {
   if (event->dropAction() != Qt::CopyAction)
@@ -2399,6 +2699,7 @@ bool DiffView::canFetchMore()
 
 void DiffView::fetchMore()
 {
+  Trace::Span span("ui", "DiffView::fetchMore");
   QVBoxLayout *layout = static_cast<QVBoxLayout *>(widget()->layout());
 
   // Add widgets.
@@ -2425,6 +2726,8 @@ void DiffView::fetchMore()
             this, &DiffView::diagnosticAdded);
   }
 
+  span.setArg("files", mFiles.size() - init);
+
   // Finish layout.
   if (mFiles.size() == mDiff.count()) {
     // Add comments widget.
@@ -17,8 +17,10 @@
 #include "git/Index.h"
 #include "host/Account.h"
 #include "plugins/Plugin.h"
+#include <QAtomicInt>
 #include <QMap>
 #include <QScrollArea>
+#include <QSharedPointer>
 
 class QCheckBox;
 class QVBoxLayout;
@@ -44,8 +46,21 @@ public:
   QList<TextEditor *> editors() override;
   void ensureVisible(TextEditor *editor, int pos) override;
 
+  bool canFindAll() const override { return true; }
+  QFuture<QList<Hits>> findAll(const QString &text) override;
+  TextEditor *editor(const Hits &hits) override;
+  QList<TextEditor *> loadedEditors() override;
+
+  QString highlightText() const { return mHighlightText; }
+  void setHighlightText(const QString &text) override;
+
+  // Fetch an LFS object that's missing from local storage. Requests
+  // made in the same event loop iteration are fetched together.
+  void fetchLfsObject(const QByteArray &pointer, const QString &file);
+
 signals:
   void diagnosticAdded(TextEditor::DiagnosticKind kind);
+  void lfsObjectFetched(const QByteArray &pointer, const QByteArray &object);
 
 protected:
   void dropEvent(QDropEvent *event) override;
@@ -55,6 +70,7 @@ private:
   bool canFetchMore();
   void fetchMore();
   void fetchAll(int index = -1);
+  void fetchLfsObjects();
 
   git::Diff mDiff;
   QMap<QString,git::Patch> mStagedPatches;
@@ -64,6 +80,11 @@ private:
 
   QList<PluginRef> mPlugins;
   Account::CommitComments mComments;
+
+  QString mHighlightText;
+  QSharedPointer<QAtomicInt> mFindCanceled;
+
+  QMap<QByteArray,QString> mLfsRequests;
 };
 
 #endif
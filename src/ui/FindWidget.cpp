@@ -144,6 +144,21 @@ FindWidget::FindWidget(EditorProvider *provider, QWidget *parent)
   esc->setContext(Qt::WidgetWithChildrenShortcut);
   connect(esc, &QShortcut::activated, this, &FindWidget::hide);
   connect(done, &QToolButton::clicked, this, &FindWidget::hide);
+
+  // Report background search results.
+  using Watcher = QFutureWatcher<QList<EditorProvider::Hits>>;
+  connect(&mWatcher, &Watcher::finished, this, [this] {
+    if (mWatcher.isCanceled())
+      return;
+
+    int matches = 0;
+    mMatches = mWatcher.result();
+    foreach (const EditorProvider::Hits &hits, mMatches)
+      matches += hits.count;
+
+    mEditorIndex = 0;
+    setMatches(matches);
+  });
 }
 
 void FindWidget::reset()
@@ -153,16 +168,51 @@ void FindWidget::reset()
 
 void FindWidget::clearHighlights()
 {
+  if (mEditorProvider->canFindAll()) {
+    mMatches.clear();
+    mWatcher.setFuture(QFuture<QList<EditorProvider::Hits>>());
+    mEditorProvider->setHighlightText(QString());
+    foreach (TextEditor *editor, mEditorProvider->loadedEditors())
+      editor->clearHighlights();
+    return;
+  }
+
   foreach (TextEditor *editor, mEditorProvider->editors())
     editor->clearHighlights();
 }
 
 void FindWidget::highlightAll()
 {
+  if (mEditorProvider->canFindAll()) {
+    // Highlight loaded editors now and the rest as they're loaded.
+    mEditorProvider->setHighlightText(sText);
+    foreach (TextEditor *editor, mEditorProvider->loadedEditors())
+      editor->highlightAll(sText);
+
+    // Count matches in the background.
+    mMatches.clear();
+    if (sText.isEmpty()) {
+      mWatcher.setFuture(QFuture<QList<EditorProvider::Hits>>());
+      setMatches(0);
+      return;
+    }
+
+    mHits->setText(tr("Searching..."));
+    mHits->setVisible(true);
+    mButtons->setEnabled(false);
+    mWatcher.setFuture(mEditorProvider->findAll(sText));
+    return;
+  }
+
   int matches = 0;
   foreach (TextEditor *editor, mEditorProvider->editors())
     matches += editor->highlightAll(sText);
 
+  setMatches(matches);
+}
+
+void FindWidget::setMatches(int matches)
+{
   QString text;
   switch (matches) {
     case 0:
@@ -191,11 +241,31 @@ void FindWidget::find(Direction direction)
 {
   bool forward = (direction != Backward);
 
+  // Only editors with matches are loaded
+  // when the provider searches in the background.
+  QList<TextEditor *> editors;
+  bool findAll = mEditorProvider->canFindAll();
+  if (!findAll)
+    editors = mEditorProvider->editors();
+
+  int count = findAll ? mMatches.size() : editors.size();
+  if (count == 0)
+    return;
+
+  auto editorAt = [this, findAll, &editors](int index) {
+    return findAll ? mEditorProvider->editor(mMatches.at(index)) :
+                     editors.at(index);
+  };
+
   // Search through all editors until a match is found.
   // Then search the initial editor again from the beginning.
-  QList<TextEditor *> editors = mEditorProvider->editors();
-  for (int i = 0; i < editors.size() + 1; ++i) {
-    TextEditor *editor = editors.at(mEditorIndex);
+  if (mEditorIndex >= count)
+    mEditorIndex = 0;
+
+  for (int i = 0; i < count + 1; ++i) {
+    TextEditor *editor = editorAt(mEditorIndex);
+    if (!editor)
+      return;
 
     // Advance to end of selection.
     if (direction == Advance) {
@@ -214,19 +284,22 @@ void FindWidget::find(Direction direction)
     // Choose next index.
     if (forward) {
       ++mEditorIndex;
-      if (mEditorIndex > editors.size() - 1)
+      if (mEditorIndex > count - 1)
         mEditorIndex = 0;
     } else {
       --mEditorIndex;
       if (mEditorIndex < 0)
-        mEditorIndex = editors.size() - 1;
+        mEditorIndex = count - 1;
     }
 
     // Reset current editor selection.
     editor->setSelection(0, 0);
 
     // Reset next editor selection.
-    TextEditor *next = editors.at(mEditorIndex);
+    TextEditor *next = editorAt(mEditorIndex);
+    if (!next)
+      return;
+
     int extreme = forward ? 0 : next->length();
     next->setSelection(extreme, extreme);
   }
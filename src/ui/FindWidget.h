@@ -10,6 +10,8 @@
 #ifndef FINDWIDGET_H
 #define FINDWIDGET_H
 
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QToolButton>
 #include <QWidget>
 
@@ -20,8 +22,32 @@ class QLineEdit;
 class EditorProvider
 {
 public:
+  // The number of matches in an editor that may not be loaded yet.
+  struct Hits
+  {
+    int file;
+    int hunk;
+    int count;
+  };
+
   virtual QList<TextEditor *> editors() = 0;
   virtual void ensureVisible(TextEditor *editor, int pos) = 0;
+
+  // Providers with many editors can search their content in the
+  // background instead of loading every editor. The result only
+  // contains editors with matches, in order. Those editors are
+  // loaded one at a time as the search moves to them.
+  virtual bool canFindAll() const { return false; }
+  virtual QFuture<QList<Hits>> findAll(const QString &text)
+  {
+    return QFuture<QList<Hits>>();
+  }
+
+  virtual TextEditor *editor(const Hits &hits) { return nullptr; }
+  virtual QList<TextEditor *> loadedEditors() { return editors(); }
+
+  // Highlight the text in editors that are loaded later.
+  virtual void setHighlightText(const QString &text) {}
 };
 
 class FindWidget : public QWidget
@@ -57,6 +83,8 @@ protected:
   void showEvent(QShowEvent *event) override;
 
 private:
+  void setMatches(int matches);
+
   class SegmentedButton : public QWidget
   {
   public:
@@ -90,6 +118,9 @@ private:
   int mEditorIndex = 0;
   EditorProvider *mEditorProvider;
 
+  QList<EditorProvider::Hits> mMatches;
+  QFutureWatcher<QList<EditorProvider::Hits>> mWatcher;
+
   QLabel *mHits;
   QLineEdit *mField;
   SegmentedButton *mButtons;
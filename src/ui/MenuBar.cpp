@@ -37,6 +37,7 @@
 #include "index/Index.h"
 #include "log/LogEntry.h"
 #include "log/LogView.h"
+#include "trace/Trace.h"
 #include "update/Updater.h"
 #include <QApplication>
 #include <QClipboard>
@@ -1051,6 +1052,33 @@ MenuBar::MenuBar(QWidget *parent)
 
     debug->addSeparator();
 
+    QAction *trace = debug->addAction(tr("Record Trace"));
+    trace->setCheckable(true);
+    trace->setChecked(Trace::isEnabled());
+    connect(trace, &QAction::triggered, [](bool checked) {
+      Trace::setEnabled(checked);
+    });
+
+    QAction *exportTrace = debug->addAction(tr("Export Trace..."));
+    connect(exportTrace, &QAction::triggered, [this] {
+      QString title = tr("Export Trace");
+      QString path = QFileDialog::getSaveFileName(
+        this, title, QDir::home().filePath("trace.json"),
+        tr("Trace (*.json)"));
+      if (path.isEmpty())
+        return;
+
+      if (!Trace::write(path)) {
+        QString text = tr("Unable to write '%1'").arg(path);
+        QMessageBox::warning(this, title, text);
+        return;
+      }
+
+      Trace::clear();
+    });
+
+    debug->addSeparator();
+
     QAction *diffs = debug->addAction(tr("Load All Diffs"));
     connect(diffs, &QAction::triggered, [this] {
       if (MainWindow *win = qobject_cast<MainWindow *>(window())) {
@@ -33,6 +33,7 @@ public:
     : QTreeView(parent)
   {
     setHeaderHidden(true);
+    setUniformRowHeights(true);
 
     // Constrain height.
     setMinimumHeight(kHeight);
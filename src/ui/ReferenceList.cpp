@@ -71,6 +71,12 @@ ReferenceList::ReferenceList(
     if (!currentReference().isValid())
       select(mRepo.head());
   });
+
+  // Fall back to HEAD if the selected reference was removed.
+  connect(model, &QAbstractItemModel::rowsRemoved, this, [this] {
+    if (!currentReference().isValid())
+      select(mRepo.head());
+  });
 }
 
 git::Commit ReferenceList::target() const
@@ -21,27 +21,86 @@
 #include "log/LogEntry.h"
 #include <QAbstractItemModel>
 #include <QDateTime>
+#include <QHash>
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QKeyEvent>
 #include <QLineEdit>
 #include <QMenu>
+#include <QSet>
 #include <QSortFilterProxyModel>
 #include <QStyledItemDelegate>
+#include <QTimer>
 #include <QTreeView>
 #include <QVBoxLayout>
+#include <algorithm>
 
 namespace {
 
 const int kHeight = 200;
 const QString kNowrapFmt = "<span style='white-space: nowrap'>%1</span>";
 
-bool refComparator(const git::Reference &lhs, const git::Reference &rhs)
+// Coalesce bursts of reference notifications.
+const int kUpdateInterval = 50;
+
+// Reset instead of moving more than this many rows.
+const int kMaxMoves = 64;
+
+// Sort newest first. Dates are looked up once per reference.
+void sortReferences(QList<git::Reference> &refs)
 {
-  git::Commit lhsCommit = lhs.target();
-  git::Commit rhsCommit = rhs.target();
-  return (lhsCommit.isValid() && rhsCommit.isValid() &&
-          lhsCommit.committer().date() > rhsCommit.committer().date());
+  QList<QPair<QDateTime,git::Reference>> dated;
+  foreach (const git::Reference &ref, refs) {
+    git::Commit commit = ref.target();
+    QDateTime date = commit.isValid() ? commit.committer().date() : QDateTime();
+    dated.append(qMakePair(date, ref));
+  }
+
+  std::stable_sort(dated.begin(), dated.end(),
+  [](const QPair<QDateTime,git::Reference> &lhs,
+     const QPair<QDateTime,git::Reference> &rhs) {
+    return (lhs.first.isValid() && rhs.first.isValid() &&
+            lhs.first > rhs.first);
+  });
+
+  refs.clear();
+  foreach (const auto &pair, dated)
+    refs.append(pair.second);
+}
+
+QString key(const git::Reference &ref)
+{
+  return ref.isValid() ? ref.qualifiedName() : QString();
+}
+
+// Find the values in the longest increasing subsequence.
+QSet<int> increasing(const QVector<int> &values)
+{
+  // The index of the smallest tail value for each length.
+  QVector<int> tails;
+  QVector<int> prev(values.size(), -1);
+  for (int i = 0; i < values.size(); ++i) {
+    auto it = std::lower_bound(tails.begin(), tails.end(), values.at(i),
+    [&values](int index, int value) {
+      return values.at(index) < value;
+    });
+
+    int length = it - tails.begin();
+    if (length > 0)
+      prev[i] = tails.at(length - 1);
+
+    if (it == tails.end()) {
+      tails.append(i);
+    } else {
+      *it = i;
+    }
+  }
+
+  QSet<int> result;
+  for (int i = tails.isEmpty() ? -1 : tails.last(); i >= 0; i = prev.at(i))
+    result.insert(values.at(i));
+
+  return result;
 }
 
 class ReferenceModel : public QAbstractItemModel
@@ -61,80 +120,41 @@ public:
     QObject *parent = nullptr)
     : QAbstractItemModel(parent), mRepo(repo), mKinds(kinds)
   {
+    mTimer.setInterval(kUpdateInterval);
+    mTimer.setSingleShot(true);
+    connect(&mTimer, &QTimer::timeout, this, &ReferenceModel::update);
+
     git::RepositoryNotifier *notifier = repo.notifier();
     connect(notifier, &git::RepositoryNotifier::referenceAdded,
-            this, &ReferenceModel::update);
+            &mTimer, QOverload<>::of(&QTimer::start));
     connect(notifier, &git::RepositoryNotifier::referenceRemoved,
-            this, &ReferenceModel::update);
+            &mTimer, QOverload<>::of(&QTimer::start));
     connect(notifier, &git::RepositoryNotifier::referenceUpdated,
-            this, &ReferenceModel::update);
+            &mTimer, QOverload<>::of(&QTimer::start));
   }
 
   void update()
   {
-    beginResetModel();
-
-    mRefs.clear();
-
-    // Add detached head.
-    git::Reference detachedHead;
-    if (mKinds & ReferenceView::DetachedHead) {
-      git::Reference head = mRepo.head();
-      if (head.isValid() && !head.isBranch())
-        detachedHead = head;
-    }
-
-    // Add local branches.
-    if (mKinds & ReferenceView::LocalBranches) {
-      QList<git::Reference> branches;
-      foreach (const git::Branch &branch, mRepo.branches(GIT_BRANCH_LOCAL)) {
-        if (!(mKinds & ReferenceView::ExcludeHead) || !branch.isHead())
-          branches.append(branch);
-      }
-
-      std::sort(branches.begin(), branches.end(), refComparator);
-
-      // Add top references.
-      if (detachedHead.isValid())
-        branches.prepend(detachedHead);
-      if (mKinds & ReferenceView::InvalidRef)
-        branches.prepend(git::Reference());
-
-      // Add bottom references.
-      if (mKinds & ReferenceView::Stash) {
-        if (git::Reference stash = mRepo.stashRef())
-          branches.append(stash);
-      }
-
-      mRefs.append({tr("Branches"), branches});
+    mTimer.stop();
+
+    QList<ReferenceList> refs = references();
+    if (mRefs.isEmpty()) {
+      beginResetModel();
+      mRefs = refs;
+      endResetModel();
+      return;
     }
 
-    // Add remote branches.
-    if (mKinds & ReferenceView::RemoteBranches) {
-      QList<git::Reference> remotes;
-      foreach (const git::Branch &branch, mRepo.branches(GIT_BRANCH_REMOTE)) {
-        // Filter remote HEAD branches.
-        if (!branch.name().endsWith("HEAD"))
-          remotes.append(branch);
+    // The kinds don't change, so only the references are updated.
+    Q_ASSERT(refs.size() == mRefs.size());
+    for (int i = 0; i < refs.size(); ++i) {
+      if (!updateKind(i, refs.at(i).refs)) {
+        beginResetModel();
+        mRefs = refs;
+        endResetModel();
+        return;
       }
-
-      std::sort(remotes.begin(), remotes.end(), refComparator);
-      if (mKinds & ReferenceView::InvalidRef)
-        remotes.prepend(git::Reference());
-      mRefs.append({tr("Remotes"), remotes});
     }
-
-    // Add tags.
-    if (mKinds & ReferenceView::Tags) {
-      QList<git::Reference> tags;
-      foreach (const git::TagRef &tag, mRepo.tags())
-        tags.append(tag);
-
-      std::sort(tags.begin(), tags.end(), refComparator);
-      mRefs.append({tr("Tags"), tags});
-    }
-
-    endResetModel();
   }
 
   QModelIndex index(
@@ -191,9 +211,12 @@ public:
         return ref.isValid() ? ref.name() : QString();
 
       case Qt::ToolTipRole: {
-        if (!ref.isValid() || !ref.isTag())
+        if (!ref.isValid())
           return QVariant();
 
+        if (!ref.isTag())
+          return conflictToolTip(ref);
+
         git::Tag tag = git::TagRef(ref).tag();
         if (!tag.isValid())
           return QVariant();
@@ -238,9 +261,189 @@ public:
   }
 
 private:
+  QList<ReferenceList> references() const
+  {
+    QList<ReferenceList> refs;
+
+    // Add detached head.
+    git::Reference detachedHead;
+    if (mKinds & ReferenceView::DetachedHead) {
+      git::Reference head = mRepo.head();
+      if (head.isValid() && !head.isBranch())
+        detachedHead = head;
+    }
+
+    // Add local branches.
+    if (mKinds & ReferenceView::LocalBranches) {
+      QList<git::Reference> branches;
+      foreach (const git::Branch &branch, mRepo.branches(GIT_BRANCH_LOCAL)) {
+        if (!(mKinds & ReferenceView::ExcludeHead) || !branch.isHead())
+          branches.append(branch);
+      }
+
+      sortReferences(branches);
+
+      // Add top references.
+      if (detachedHead.isValid())
+        branches.prepend(detachedHead);
+      if (mKinds & ReferenceView::InvalidRef)
+        branches.prepend(git::Reference());
+
+      // Add bottom references.
+      if (mKinds & ReferenceView::Stash) {
+        if (git::Reference stash = mRepo.stashRef())
+          branches.append(stash);
+      }
+
+      refs.append({tr("Branches"), branches});
+    }
+
+    // Add remote branches.
+    if (mKinds & ReferenceView::RemoteBranches) {
+      QList<git::Reference> remotes;
+      foreach (const git::Branch &branch, mRepo.branches(GIT_BRANCH_REMOTE)) {
+        // Filter remote HEAD branches.
+        if (!branch.name().endsWith("HEAD"))
+          remotes.append(branch);
+      }
+
+      sortReferences(remotes);
+      if (mKinds & ReferenceView::InvalidRef)
+        remotes.prepend(git::Reference());
+      refs.append({tr("Remotes"), remotes});
+    }
+
+    // Add tags.
+    if (mKinds & ReferenceView::Tags) {
+      QList<git::Reference> tags;
+      foreach (const git::TagRef &tag, mRepo.tags())
+        tags.append(tag);
+
+      sortReferences(tags);
+      refs.append({tr("Tags"), tags});
+    }
+
+    return refs;
+  }
+
+  // Apply the difference between the current and new references of
+  // the given kind as row changes. Returns false without changing
+  // anything if there are too many moves to apply them one by one.
+  bool updateKind(int kind, const QList<git::Reference> &refs)
+  {
+    QStringList keys;
+    QHash<QString,int> rows;
+    foreach (const git::Reference &ref, refs) {
+      rows.insert(key(ref), keys.size());
+      keys.append(key(ref));
+    }
+
+    QList<git::Reference> &list = mRefs[kind].refs;
+
+    // The remaining references in the longest run that's already in
+    // order stay where they are. Each of the others is moved once.
+    QVector<int> targets;
+    foreach (const git::Reference &ref, list) {
+      int row = rows.value(key(ref), -1);
+      if (row >= 0)
+        targets.append(row);
+    }
+
+    QSet<int> stay = increasing(targets);
+    if (targets.size() - stay.size() > kMaxMoves)
+      return false;
+
+    QModelIndex parent = index(kind, 0);
+
+    // Remove contiguous ranges from the bottom up.
+    for (int row = list.size() - 1; row >= 0; --row) {
+      if (rows.contains(key(list.at(row))))
+        continue;
+
+      int last = row;
+      while (row > 0 && !rows.contains(key(list.at(row - 1))))
+        --row;
+
+      beginRemoveRows(parent, row, last);
+      list.erase(list.begin() + row, list.begin() + last + 1);
+      endRemoveRows();
+    }
+
+    auto find = [&list](const QString &name) {
+      for (int i = 0; i < list.size(); ++i) {
+        if (key(list.at(i)) == name)
+          return i;
+      }
+
+      return -1;
+    };
+
+    // Place each of the other references after the one that precedes
+    // it. Contiguous new references are inserted as one range.
+    QSet<QString> moved;
+    for (int row = 0; row < refs.size(); ++row) {
+      if (stay.contains(row))
+        continue;
+
+      int dest = (row > 0) ? find(keys.at(row - 1)) + 1 : 0;
+      int from = find(keys.at(row));
+      if (from < 0) {
+        int last = row;
+        while (last + 1 < refs.size() && find(keys.at(last + 1)) < 0)
+          ++last;
+
+        beginInsertRows(parent, dest, dest + last - row);
+        for (int i = row; i <= last; ++i)
+          list.insert(dest + i - row, refs.at(i));
+        endInsertRows();
+
+        row = last;
+        continue;
+      }
+
+      if (from != dest) {
+        beginMoveRows(parent, from, from, parent, dest);
+        list.move(from, (from < dest) ? dest - 1 : dest);
+        endMoveRows();
+      }
+
+      moved.insert(keys.at(row));
+    }
+
+    // Update the references that changed.
+    Q_ASSERT(list.size() == refs.size());
+    for (int row = 0; row < refs.size(); ++row) {
+      const git::Reference &ref = refs.at(row);
+      bool changed = (moved.contains(keys.at(row)) ||
+                      list.at(row).target() != ref.target());
+      list[row] = ref;
+      if (changed) {
+        QModelIndex index = this->index(row, 0, parent);
+        emit dataChanged(index, index);
+      }
+    }
+
+    return true;
+  }
+
+  // Describe the predicted result of merging the reference into HEAD.
+  QVariant conflictToolTip(const git::Reference &ref) const
+  {
+    git::Reference head = mRepo.head();
+    if (!head.isValid() || ref.isHead() || ref.isStash())
+      return QVariant();
+
+    QStringList paths;
+    if (!mRepo.predictConflicts(head.target(), ref.target(), &paths))
+      return QVariant();
+
+    return ReferenceView::conflictText(paths);
+  }
+
   git::Repository mRepo;
   ReferenceView::Kinds mKinds;
   QList<ReferenceList> mRefs;
+  QTimer mTimer;
 };
 
 class FilterProxyModel : public QSortFilterProxyModel
@@ -406,6 +609,15 @@ ReferenceView::ReferenceView(
       tabs->addTab(model->index(i, 0).data().toString());
   });
 
+  // Predict conflicts with the current reference in the background.
+  connect(selectionModel(), &QItemSelectionModel::currentChanged, this,
+  [repo](const QModelIndex &index) {
+    git::Reference ref = index.data(Qt::UserRole).value<git::Reference>();
+    git::Reference head = repo.head();
+    if (ref.isValid() && head.isValid() && !ref.isHead() && !ref.isStash())
+      repo.predictConflicts(head.target(), ref.target());
+  });
+
   if (!popup) {
     // Checkout on double-click.
     connect(this, &ReferenceView::doubleClicked,
@@ -470,6 +682,16 @@ QString ReferenceView::kindString(const git::Reference &ref)
   return QString();
 }
 
+QString ReferenceView::conflictText(const QStringList &paths)
+{
+  if (paths.isEmpty())
+    return tr("Merges cleanly");
+
+  int count = paths.size();
+  QString files = (count == 1) ? tr("file") : tr("files");
+  return tr("%1 conflicting %2").arg(count).arg(files);
+}
+
 void ReferenceView::showEvent(QShowEvent *event)
 {
   resetTabIndex();
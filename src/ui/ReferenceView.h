@@ -51,6 +51,9 @@ public:
 
   static QString kindString(const git::Reference &ref);
 
+  // Describe conflicts predicted by a merge.
+  static QString conflictText(const QStringList &paths);
+
 protected:
   void showEvent(QShowEvent *event) override;
   void contextMenuEvent(QContextMenuEvent *event) override;
@@ -146,6 +146,12 @@ void RemoteCallbacks::storeDeferredCredentials()
   }
 }
 
+void RemoteCallbacks::setSharedCredentials(
+  const QSharedPointer<SharedCredentials> &shared)
+{
+  mSharedCredentials = shared;
+}
+
 bool RemoteCallbacks::credentials(
   const QString &url,
   QString &username,
@@ -154,6 +160,14 @@ bool RemoteCallbacks::credentials(
   if (mCanceled)
     return false;
 
+  // Wait for other callbacks to finish prompting.
+  QMutex *mutex = mSharedCredentials ? &mSharedCredentials->mutex : nullptr;
+  QMutexLocker locker(mutex);
+
+  // Don't prompt if this was canceled while waiting.
+  if (mCanceled)
+    return false;
+
   QString error;
   emit queueCredentials(url, username, password, error);
 
@@ -328,10 +342,25 @@ void RemoteCallbacks::credentialsImpl(
     }
   }
 
-  // Prompt for password.
-  QDialog dialog;
+  // Look for credentials that were entered for another callback.
   QString scheme = QUrl(url).scheme().toLower();
   bool https = (scheme == "http" || scheme == "https");
+  QString host = https ? QUrl(url).host() : QString();
+  if (mSharedCredentials) {
+    QStringList shared = mSharedCredentials->credentials.value(host);
+    if (!shared.isEmpty()) {
+      QStringList key({url, shared.at(0), shared.at(1)});
+      if (!mQueriedCredentials.contains(key)) {
+        mQueriedCredentials.insert(key);
+        username = shared.at(0);
+        password = shared.at(1);
+        return;
+      }
+    }
+  }
+
+  // Prompt for password.
+  QDialog dialog;
   dialog.setWindowTitle(https ? tr("HTTPS Credentials") : tr("SSH Passphrase"));
 
   QLineEdit *usernameField = https ? new QLineEdit(username, &dialog) : nullptr;
@@ -369,6 +398,10 @@ void RemoteCallbacks::credentialsImpl(
     username = usernameField->text();
   password = passwordField->text();
 
+  // Share with other callbacks.
+  if (mSharedCredentials)
+    mSharedCredentials->credentials.insert(host, {username, password});
+
   // Remember in keychain.
   mDeferredUrl = url;
   mDeferredUsername = username;
@@ -539,8 +572,8 @@ void RemoteCallbacks::updateImpl(
     }
   }
 
-  // Write text.
-  mLog->addEntry(kUpdateFmt.arg(flag, summary, fromTo));
+  // Write text. There may be many updates, so add them in batches.
+  mLog->queueEntry(LogEntry::Entry, kUpdateFmt.arg(flag, summary, fromTo));
 }
 
 void RemoteCallbacks::rejectedImpl(const QString &name, const QString &status)
@@ -14,8 +14,11 @@
 #include "git/Repository.h"
 #include "host/Account.h"
 #include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
 #include <QObject>
 #include <QSet>
+#include <QSharedPointer>
 
 class LogEntry;
 
@@ -30,6 +33,15 @@ public:
     Receive
   };
 
+  // Credentials that are shared between callbacks that run at the
+  // same time. Requests are serialized so that the user is only
+  // prompted once for each host.
+  struct SharedCredentials
+  {
+    QMutex mutex;
+    QMap<QString,QStringList> credentials;
+  };
+
   RemoteCallbacks(
     Kind kind,
     LogEntry *log,
@@ -42,6 +54,7 @@ public:
   void setCanceled(bool canceled);
 
   void storeDeferredCredentials();
+  void setSharedCredentials(const QSharedPointer<SharedCredentials> &shared);
 
   bool credentials(
     const QString &url,
@@ -135,6 +148,7 @@ private:
   LogEntry *mDeltaItem = nullptr;
 
   QSet<QStringList> mQueriedCredentials;
+  QSharedPointer<SharedCredentials> mSharedCredentials;
 
   QString mDeferredUrl;
   QString mDeferredUsername;
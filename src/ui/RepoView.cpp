@@ -19,6 +19,8 @@
 #include "PathspecWidget.h"
 #include "ReferenceWidget.h"
 #include "RemoteCallbacks.h"
+#include "ResourceGovernor.h"
+#include "Scheduler.h"
 #include "SearchField.h"
 #include "ToolBar.h"
 #include "app/Application.h"
@@ -43,12 +45,15 @@
 #include "host/Accounts.h"
 #include "index/Index.h"
 #include "log/LogEntry.h"
+#include "log/LogModel.h"
 #include "log/LogView.h"
 #include "tools/ShowTool.h"
+#include "trace/Trace.h"
 #include "watcher/RepositoryWatcher.h"
 #include <QCheckBox>
 #include <QCloseEvent>
 #include <QDesktopServices>
+#include <QEventLoop>
 #include <QMessageBox>
 #include <QtNetwork>
 #include <QPushButton>
@@ -68,14 +73,53 @@
 namespace {
 
 const QString kSplitterKey = "splitter";
+const QString kTraceFile = "trace.json";
 const QString kMsgFmt = "%1 - <span style='color: gray'>%2</span>";
 
+// Wait for reference updates to settle before predicting conflicts.
+const int kConflictDelay = 500;
+
 QString msg(const git::Commit &commit)
 {
   QString summary = commit.summary(git::Commit::SubstituteEmoji);
   return kMsgFmt.arg(commit.link(), summary);
 }
 
+// The result of rebasing in memory on the background worker. The
+// worker has its own repository, so only ids are passed back.
+struct RebaseResult
+{
+  struct Step
+  {
+    git::Id before;
+    git::Id after;
+  };
+
+  bool applied = false;
+  git::Id tip;
+  QList<Step> steps;
+};
+
+class ScopedCollapse
+{
+public:
+  ScopedCollapse(LogView *view)
+    : mView(view)
+  {
+    mView->setCollapseEnabled(false);
+  }
+
+  ~ScopedCollapse()
+  {
+    mView->setCollapseEnabled(true);
+  }
+
+private:
+  LogView *mView;
+};
+
+} // anon. namespace
+
 class CheckoutCallbacks :
   public QObject,
   public git::Repository::CheckoutCallbacks
@@ -89,6 +133,10 @@ public:
     // Connect with automatic type.
     connect(this, &CheckoutCallbacks::queueNotify,
             this, &CheckoutCallbacks::notifyImpl);
+    connect(this, &CheckoutCallbacks::queueProgress,
+            this, &CheckoutCallbacks::progressImpl);
+
+    mTimer.start();
   }
 
   QStringList conflicts() const
@@ -101,6 +149,16 @@ public:
     return mFlags | GIT_CHECKOUT_NOTIFY_CONFLICT;
   }
 
+  bool isCanceled() const override
+  {
+    return mCanceled;
+  }
+
+  void setCanceled(bool canceled)
+  {
+    mCanceled = canceled;
+  }
+
   bool notify(char status, const QString &path) override
   {
     emit queueNotify(status, path);
@@ -109,52 +167,69 @@ public:
 
   void progress(const QString &path, int current, int total) override
   {
-    // Add entries all at once.
-    if (current == total && !mEntries.isEmpty())
-      mLog->addEntries(mEntries);
+    if (current == 0 || current == total || mTimer.elapsed() > 100) {
+      emit queueProgress(current, total);
+      mTimer.restart();
+    }
   }
 
 signals:
   void queueNotify(char status, const QString &path);
+  void queueProgress(int current, int total);
 
 private:
   void notifyImpl(char status, const QString &path)
   {
-    LogEntry *entry = new LogEntry(LogEntry::File, path, QString());
-    entry->setStatus(status);
-    mEntries.append(entry);
+    mFiles.append({status, path});
 
     if (status == '!')
       mConflicts.append(path);
   }
 
+  void progressImpl(int current, int total)
+  {
+    if (total > 0) {
+      // Write text.
+      QString text;
+      QTextStream stream(&text);
+      stream << "Checking out files: "
+             << static_cast<int>(100 * (static_cast<float>(current) / total))
+             << "% (" << current << "/" << total << ")"
+             << (current == total ? ", done" : QString()) << ".";
+
+      // Update the list item.
+      if (mProgressItem) {
+        mProgressItem->setText(text);
+      } else {
+        mProgressItem = mLog->addEntry(text);
+      }
+    }
+
+    // Add entries all at once.
+    if (current == total) {
+      foreach (const File &file, mFiles)
+        mLog->queueEntry(LogEntry::File, file.path, file.status);
+      mFiles.clear();
+    }
+  }
+
   LogEntry *mLog;
   int mFlags;
 
-  QStringList mConflicts;
-  QList<LogEntry *> mEntries;
-};
+  QElapsedTimer mTimer;
+  LogEntry *mProgressItem = nullptr;
+  bool mCanceled = false;
 
-class ScopedCollapse
-{
-public:
-  ScopedCollapse(LogView *view)
-    : mView(view)
-  {
-    mView->setCollapseEnabled(false);
-  }
-
-  ~ScopedCollapse()
+  struct File
   {
-    mView->setCollapseEnabled(true);
-  }
+    char status;
+    QString path;
+  };
 
-private:
-  LogView *mView;
+  QStringList mConflicts;
+  QList<File> mFiles;
 };
 
-} // anon. namespace
-
 RepoView::RepoView(const git::Repository &repo, MainWindow *parent)
   : QSplitter(Qt::Vertical, parent), mRepo(repo)
 {
@@ -168,6 +243,23 @@ RepoView::RepoView(const git::Repository &repo, MainWindow *parent)
   connect(notifier, &git::RepositoryNotifier::referenceUpdated,
           this, &RepoView::startIndexing);
 
+  // Predict conflicts after bursts of updates settle. Predictions are
+  // made a few at a time, so check again as each one finishes.
+  mConflictTimer.setSingleShot(true);
+  mConflictTimer.setInterval(kConflictDelay);
+  connect(&mConflictTimer, &QTimer::timeout,
+          this, &RepoView::predictConflicts);
+  connect(notifier, &git::RepositoryNotifier::referenceUpdated,
+          &mConflictTimer, QOverload<>::of(&QTimer::start));
+
+  // Only start another pass when a prediction that the last
+  // pass was waiting for finishes.
+  connect(notifier, &git::RepositoryNotifier::conflictsPredicted, this,
+  [this](const git::Id &ours, const git::Id &theirs) {
+    if (mConflictsWaiting.remove(qMakePair(ours, theirs)))
+      mConflictTimer.start();
+  });
+
   MenuBar *menuBar = MenuBar::instance(parent);
   connect(this, &RepoView::statusChanged,
           menuBar, &MenuBar::updateStash);
@@ -189,19 +281,27 @@ RepoView::RepoView(const git::Repository &repo, MainWindow *parent)
   connect(&mIndexer, signal,
   [this, searchField](int code, QProcess::ExitStatus status) {
     searchField->setPlaceholderText(tr("Search"));
-    if (status == QProcess::CrashExit) {
+    // Hibernation terminates the indexer.
+    if (status == QProcess::CrashExit && !mHibernated) {
       QString text =
         tr("The indexer worker process crashed. If this problem "
            "persists please contact us at support@gitahead.com.");
       addLogEntry(text, tr("Indexer Crashed"));
     }
 
+    releaseIndexer();
     if (mRestartIndexer) {
       mRestartIndexer = false;
       startIndexing();
     }
   });
 
+  connect(&mIndexer, &QProcess::errorOccurred,
+  [this](QProcess::ProcessError error) {
+    if (error == QProcess::FailedToStart)
+      releaseIndexer();
+  });
+
   // Forward indexer stderr. Read from stdout.
   mIndexer.setProcessChannelMode(QProcess::ForwardedErrorChannel);
   connect(&mIndexer, &QProcess::readyReadStandardOutput, [this] {
@@ -304,6 +404,10 @@ RepoView::RepoView(const git::Repository &repo, MainWindow *parent)
   // Respond to commit list selection change.
   connect(mCommits, &CommitList::diffSelected,
   [this](const git::Diff &diff, const QString &file, bool spontaneous) {
+    // The selection is restored when the view resumes.
+    if (mHibernated)
+      return;
+
     mHistory->update(diff.isValid() ? location() : Location(), spontaneous);
     mDetails->setDiff(diff, file, mPathspec->pathspec());
   });
@@ -372,11 +476,11 @@ RepoView::RepoView(const git::Repository &repo, MainWindow *parent)
   });
 
   // Refresh when the workdir changes.
-  RepositoryWatcher *watcher = new RepositoryWatcher(repo, this);
+  mRepoWatcher = new RepositoryWatcher(repo, this);
   connect(notifier, &git::RepositoryNotifier::referenceUpdated,
-          watcher, &RepositoryWatcher::cancelPendingNotification);
+          mRepoWatcher, &RepositoryWatcher::cancelPendingNotification);
   connect(mCommits, &CommitList::statusChanged,
-          watcher, &RepositoryWatcher::cancelPendingNotification);
+          mRepoWatcher, &RepositoryWatcher::cancelPendingNotification);
 
   QSplitter *splitter = new QSplitter(Qt::Horizontal, this);
   splitter->setChildrenCollapsible(false);
@@ -399,6 +503,8 @@ RepoView::RepoView(const git::Repository &repo, MainWindow *parent)
           this, &RepoView::visitLink);
   connect(mLogView, &LogView::operationCanceled,
           this, &RepoView::cancelRemoteTransfer);
+  connect(mLogView, &LogView::operationCanceled,
+          this, &RepoView::cancelCheckout);
 
   mLogTimer.setSingleShot(true);
   connect(&mLogTimer, &QTimer::timeout, [this] {
@@ -447,12 +553,28 @@ RepoView::RepoView(const git::Repository &repo, MainWindow *parent)
 
   // Connect automatic fetch timer.
   connect(&mFetchTimer, &QTimer::timeout, [this] {
-    fetch(git::Remote(), false, false);
+    // Coalesce fetches in hidden views into one fetch on resume.
+    if (mHibernated) {
+      mFetchPending = true;
+      mFetchTimer.stop();
+      return;
+    }
+
+    startAutoFetch();
   });
+
+  // Hibernate after being hidden for a while.
+  mHibernateTimer.setSingleShot(true);
+  connect(&mHibernateTimer, &QTimer::timeout, this, &RepoView::hibernate);
 }
 
 RepoView::~RepoView()
 {
+  // Queued background jobs for this view start
+  // and immediately release their slot from now on.
+  mHibernated = true;
+  releaseIndexer();
+
   // Work around crash caused by clearing focus from the commit list
   // when it's destroyed. If it gets destroyed after the detail view
   // then the focus change may trigger the menu bar to query the mode
@@ -585,8 +707,24 @@ git::Tree RepoView::tree() const
   return diff.isValid() ? mRepo.index().writeTree() : git::Tree();
 }
 
-void RepoView::cancelRemoteTransfer()
+void RepoView::cancelRemoteTransfer(const QModelIndex &index)
 {
+  if (mFetchAll) {
+    // Cancel a single remote.
+    LogEntry *entry = index.data(LogModel::EntryRole).value<LogEntry *>();
+    if (RemoteCallbacks *callbacks = mFetchAll->entries.value(entry)) {
+      callbacks->setCanceled(true);
+      return;
+    }
+
+    // Don't wait. A canceled fetch may still be waiting for a prompt
+    // on this thread. The batch finishes when the last fetch returns.
+    mFetchAll->canceled = true;
+    foreach (RemoteCallbacks *callbacks, mFetchAll->running)
+      callbacks->setCanceled(true);
+  }
+
+  cancelSubmoduleUpdates();
   if (!mCallbacks)
     return;
 
@@ -596,12 +734,35 @@ void RepoView::cancelRemoteTransfer()
     mWatcher->waitForFinished();
 }
 
+void RepoView::cancelCheckout()
+{
+  // The checkout stops at the next callback. The watcher's
+  // finished handler cleans up after it.
+  if (mCheckoutCallbacks)
+    mCheckoutCallbacks->setCanceled(true);
+}
+
 void RepoView::cancelBackgroundTasks()
 {
   cancelIndexing();
   cancelRemoteTransfer();
+  cancelCheckout();
+
+  // Parallel fetches, submodule updates and checkouts are canceled
+  // asynchronously. Keep the event loop running while they finish so
+  // that any job that is blocked on a credential prompt can return.
+  if (mWatcher && (mFetchAll || mSubmoduleUpdate || mCheckoutCallbacks)) {
+    QEventLoop loop;
+    connect(mWatcher, &QFutureWatcher<git::Result>::finished,
+            &loop, &QEventLoop::quit);
+    loop.exec();
+  }
+
   mCommits->cancelStatus();
   mDetails->cancelBackgroundTasks();
+
+  // Drop anything that hasn't started yet.
+  Scheduler::instance()->cancel(mRepo);
 }
 
 void RepoView::visitLink(const QString &link)
@@ -858,17 +1019,73 @@ void RepoView::startIndexing()
   if (!mRepo.appConfig().value<bool>("index.enable", true))
     return;
 
+  // Defer until the view resumes.
+  if (mHibernated) {
+    mIndexPending = true;
+    return;
+  }
+
+  // Already waiting for a slot.
+  if (mIndexerQueued)
+    return;
+
   if (mIndexer.state() != QProcess::NotRunning) {
     mRestartIndexer = true;
     return;
   }
 
-  QStringList args = {"--notify", "--background", mRepo.dir().path()};
-  if (Index::isLoggingEnabled())
-    args.prepend("--log");
+  mIndexerQueued = true;
+  ResourceGovernor *governor = ResourceGovernor::instance();
+  governor->acquire(this, [this, governor] {
+    mIndexerQueued = false;
+    if (mHibernated) {
+      mIndexPending = true;
+      governor->release();
+      return;
+    }
+
+    QStringList args = {"--notify", "--background", mRepo.dir().path()};
+    if (Index::isLoggingEnabled())
+      args.prepend("--log");
+    if (Trace::isEnabled()) {
+      // The indexer writes its own trace next to the log.
+      args.prepend(Index::indexDir(mRepo).filePath(kTraceFile));
+      args.prepend("--trace");
+    }
 
-  QDir dir(QCoreApplication::applicationDirPath());
-  mIndexer.start(dir.filePath("indexer"), args);
+    mIndexerSlot = true;
+    QDir dir(QCoreApplication::applicationDirPath());
+    mIndexer.start(dir.filePath("indexer"), args);
+  });
+}
+
+void RepoView::predictConflicts()
+{
+  // Defer until the view is shown.
+  if (mHibernated || !mShown)
+    return;
+
+  // Don't ask for more predictions than the cache keeps. Otherwise
+  // each pass would drop predictions that the next pass needs.
+  int count = 0;
+  int limit = git::Repository::conflictCacheSize();
+  mConflictsWaiting.clear();
+  foreach (const git::Branch &branch, mRepo.branches(GIT_BRANCH_LOCAL)) {
+    git::Branch upstream = branch.upstream();
+    if (!upstream.isValid())
+      continue;
+
+    git::Commit ours = branch.target();
+    git::Commit theirs = upstream.target();
+    if (!ours.isValid() || !theirs.isValid())
+      continue;
+
+    if (!mRepo.predictConflicts(ours, theirs))
+      mConflictsWaiting.insert(qMakePair(ours.id(), theirs.id()));
+
+    if (++count >= limit)
+      break;
+  }
 }
 
 void RepoView::cancelIndexing()
@@ -886,6 +1103,15 @@ void RepoView::cancelIndexing()
   mIndexer.waitForFinished(5000);
 }
 
+void RepoView::releaseIndexer()
+{
+  if (!mIndexerSlot)
+    return;
+
+  mIndexerSlot = false;
+  ResourceGovernor::instance()->release();
+}
+
 bool RepoView::isLogVisible() const
 {
   return mIsLogVisible;
@@ -967,13 +1193,66 @@ void RepoView::startFetchTimer()
   if (!config.value<bool>("autofetch.enable", enable))
     return;
 
-  bool prune = settings->value("global/autoprune/enable").toBool();
-  fetch(git::Remote(), false, false, nullptr, nullptr,
-    config.value<bool>("autoprune.enable", prune));
+  mFetchPending = false;
+  startAutoFetch();
 
   mFetchTimer.start(config.value<int>("autofetch.minutes", minutes) * 60000);
 }
 
+void RepoView::startAutoFetch()
+{
+  // Wait for the running remote operation without holding a slot.
+  // The fetch would only be queued behind it.
+  if (mWatcher) {
+    connect(mWatcher, &QFutureWatcher<git::Result>::finished,
+            this, &RepoView::startAutoFetch, Qt::UniqueConnection);
+    return;
+  }
+
+  ResourceGovernor *governor = ResourceGovernor::instance();
+  governor->acquire(this, [this, governor] {
+    if (mHibernated) {
+      mFetchPending = true;
+      governor->release();
+      return;
+    }
+
+    // Another operation started while this was queued.
+    if (mWatcher) {
+      governor->release();
+      startAutoFetch();
+      return;
+    }
+
+    // Release the slot when the fetch finishes or the view is closed.
+    using Watcher = QFutureWatcher<git::Result>;
+    Watcher *watcher = new Watcher(this);
+    connect(watcher, &Watcher::finished, watcher, &Watcher::deleteLater);
+    connect(watcher, &QObject::destroyed,
+            governor, &ResourceGovernor::release);
+    watcher->setFuture(fetch(git::Remote(), false, false));
+  });
+}
+
+struct RepoView::FetchAll
+{
+  bool tags;
+  bool prune;
+  int jobs;
+
+  bool canceled = false;
+  bool updated = false;
+  LogEntry *entry;
+
+  QList<git::Remote> queue;
+  QMap<QFutureWatcher<git::Result> *,RemoteCallbacks *> running;
+  QMap<LogEntry *,RemoteCallbacks *> entries;
+  QSharedPointer<RemoteCallbacks::SharedCredentials> credentials;
+
+  // Aggregate future. Finished when the last fetch finishes.
+  QFutureInterface<git::Result> interface;
+};
+
 void RepoView::fetchAll()
 {
   QList<git::Remote> remotes = mRepo.remotes();
@@ -985,11 +1264,137 @@ void RepoView::fetchAll()
     return;
   }
 
-  // Queue up all remotes to fetch them serially.
+  if (mWatcher) {
+    // Queue fetch.
+    connect(mWatcher, &QFutureWatcher<git::Result>::finished, mWatcher,
+    [this] {
+      fetchAll();
+    });
+
+    return;
+  }
+
+  // Read the number of parallel fetches.
+  Settings *settings = Settings::instance();
+  int jobs = settings->value("global/fetch/jobs").toInt();
+  jobs = mRepo.config().value<int>("fetch.parallel", jobs);
+
+  bool prune = settings->value("global/autoprune/enable").toBool();
+
   QString text = tr("%1 remotes").arg(remotes.size());
-  LogEntry *entry = addLogEntry(text, tr("Fetch All"));
-  foreach (const git::Remote &remote, remotes)
-    fetch(remote, false, true, entry);
+  FetchAll *fetch = new FetchAll;
+  fetch->tags = false;
+  fetch->prune = mRepo.appConfig().value<bool>("autoprune.enable", prune);
+  fetch->jobs = (jobs > 0) ? jobs : QThread::idealThreadCount();
+  fetch->entry = addLogEntry(text, tr("Fetch All"));
+  fetch->queue = remotes;
+  fetch->credentials.reset(new RemoteCallbacks::SharedCredentials);
+  fetch->interface.reportStarted();
+  mFetchAll = fetch;
+
+  mWatcher = new QFutureWatcher<git::Result>(this);
+  connect(mWatcher, &QFutureWatcher<git::Result>::finished, mWatcher,
+  [this, fetch] {
+    // The jobs fetched through their own repositories. Reload the
+    // references once after the last one instead of once per update.
+    if (fetch->updated)
+      refresh();
+
+    delete fetch;
+    mFetchAll = nullptr;
+
+    mWatcher->deleteLater();
+    mWatcher = nullptr;
+  });
+
+  mWatcher->setFuture(fetch->interface.future());
+  startFetches();
+}
+
+void RepoView::startFetches()
+{
+  FetchAll *fetch = mFetchAll;
+  while (!fetch->canceled && !fetch->queue.isEmpty() &&
+         fetch->running.size() < fetch->jobs) {
+    git::Remote remote = fetch->queue.takeFirst();
+    LogEntry *entry = addLogEntry(remote.name(), tr("Fetch"), fetch->entry);
+
+    using Watcher = QFutureWatcher<git::Result>;
+    Watcher *watcher = new Watcher(this);
+
+    QString url = remote.url();
+    RemoteCallbacks *callbacks = new RemoteCallbacks(
+      RemoteCallbacks::Receive, entry, url, remote.name(), watcher, mRepo);
+    callbacks->setSharedCredentials(fetch->credentials);
+    fetch->running.insert(watcher, callbacks);
+    fetch->entries.insert(entry, callbacks);
+
+    // Remember that references were updated.
+    connect(callbacks, &RemoteCallbacks::referenceUpdated, this,
+    [this, fetch] {
+      if (mFetchAll == fetch)
+        fetch->updated = true;
+    });
+
+    connect(watcher, &Watcher::finished, watcher,
+    [this, remote, entry, watcher, callbacks] {
+      entry->setBusy(false);
+
+      git::Result result = watcher->result();
+      if (callbacks->isCanceled()) {
+        entry->addEntry(LogEntry::Error, tr("Fetch canceled."));
+      } else if (!result) {
+        error(entry, tr("fetch from"), remote.name(), result.errorString());
+      } else {
+        callbacks->storeDeferredCredentials();
+        if (entry->entries().isEmpty())
+          entry->addEntry(tr("Everything up-to-date."));
+      }
+
+      watcher->deleteLater();
+
+      // The fetch may have been finished by cancellation.
+      FetchAll *fetch = mFetchAll;
+      if (!fetch || !fetch->running.remove(watcher))
+        return;
+
+      fetch->entries.remove(entry);
+
+      startFetches();
+      if (fetch->running.isEmpty())
+        finishFetches();
+    });
+
+    // Each job opens its own repository so that concurrent fetches
+    // don't share libgit2 state. FETCH_HEAD would only describe the
+    // last remote to finish, so the jobs leave it unchanged.
+    bool tags = fetch->tags;
+    bool prune = fetch->prune;
+    QString path = mRepo.dir().path();
+    QString name = remote.name();
+    entry->setBusy(true);
+    Scheduler *scheduler = Scheduler::instance();
+    watcher->setFuture(scheduler->run(Scheduler::Normal, mRepo,
+    [path, name, callbacks, tags, prune] {
+      git::Repository repo = git::Repository::open(path);
+      git::Remote remote =
+        repo.isValid() ? repo.lookupRemote(name) : git::Remote();
+      if (!remote.isValid())
+        return git::Result();
+
+      return remote.fetch(callbacks, tags, prune, false);
+    }));
+  }
+}
+
+void RepoView::finishFetches()
+{
+  QFutureInterface<git::Result> &interface = mFetchAll->interface;
+  if (interface.isFinished())
+    return;
+
+  git::Result result(0);
+  interface.reportFinished(&result);
 }
 
 QFuture<git::Result> RepoView::fetch(
@@ -1072,7 +1477,13 @@ QFuture<git::Result> RepoView::fetch(
           this, &RepoView::notifyReferenceUpdated);
 
   entry->setBusy(true);
-  mWatcher->setFuture(QtConcurrent::run([this, remote, tags, submodules, prune] {
+
+  // Automatic fetches are bulk work.
+  Scheduler *scheduler = Scheduler::instance();
+  Scheduler::Priority priority =
+    interactive ? Scheduler::Normal : Scheduler::Bulk;
+  mWatcher->setFuture(scheduler->run(priority, mRepo,
+  [this, remote, tags, submodules, prune] {
     git::Result result = git::Remote(remote).fetch(mCallbacks, tags, prune);
 
     if (result && submodules) {
@@ -1276,44 +1687,51 @@ void RepoView::fastForward(
   Q_ASSERT(head.isValid());
 
   git::Commit commit = upstream.commit();
-  CheckoutCallbacks callbacks(parent, GIT_CHECKOUT_NOTIFY_UPDATED);
-  if (!mRepo.checkout(commit, &callbacks)) {
-    LogEntry *err = error(parent, tr("fast-forward"), head.name());
-    foreach (const QString &path, callbacks.conflicts())
-      err->addEntry(LogEntry::File, path)->setStatus('!');
+  CheckoutCallbacks *callbacks =
+    new CheckoutCallbacks(parent, GIT_CHECKOUT_NOTIFY_UPDATED);
+  startCheckout(parent, callbacks, [this, commit, callbacks] {
+    return mRepo.checkout(commit, callbacks);
+  }, [this, ref, head, commit, parent, callbacks, callback](
+       const git::Result &result) {
+    if (!result) {
+      LogEntry *err =
+        error(parent, tr("fast-forward"), head.name(), result.errorString());
+      foreach (const QString &path, callbacks->conflicts())
+        err->queueEntry(LogEntry::File, path, '!');
 
-    QUrlQuery query;
-    if (ref.isValid())
-      query.addQueryItem("ref", ref.qualifiedName());
+      QUrlQuery query;
+      if (ref.isValid())
+        query.addQueryItem("ref", ref.qualifiedName());
 
-    QUrl url("action:fast-forward");
-    url.setQuery(query);
+      QUrl url("action:fast-forward");
+      url.setQuery(query);
 
-    // Add stash hint.
-    QString stash =
-      tr("You may be able to reconcile your changes with the conflicting "
-         "files by <a href='action:stash'>stashing</a> before you "
-         "<a href='%1'>fast-forward</a>. Then "
-         "<a href='action:unstash'>unstash</a> to restore your changes.");
-    err->addEntry(LogEntry::Hint, stash.arg(url.toString()));
+      // Add stash hint.
+      QString stash =
+        tr("You may be able to reconcile your changes with the conflicting "
+           "files by <a href='action:stash'>stashing</a> before you "
+           "<a href='%1'>fast-forward</a>. Then "
+           "<a href='action:unstash'>unstash</a> to restore your changes.");
+      err->addEntry(LogEntry::Hint, stash.arg(url.toString()));
 
-    query.addQueryItem("no-ff", "true");
-    url.setPath("merge");
-    url.setQuery(query);
+      query.addQueryItem("no-ff", "true");
+      url.setPath("merge");
+      url.setQuery(query);
 
-    // Add merge hint.
-    QString merge =
-      tr("If you want to create a new merge commit instead of fast-"
-         "forwarding, you can <a href='%1'>merge without fast-forwarding "
-         "</a> instead.");
-    err->addEntry(LogEntry::Hint, merge.arg(url.toString()));
+      // Add merge hint.
+      QString merge =
+        tr("If you want to create a new merge commit instead of fast-"
+           "forwarding, you can <a href='%1'>merge without fast-forwarding "
+           "</a> instead.");
+      err->addEntry(LogEntry::Hint, merge.arg(url.toString()));
 
-    return;
-  }
+      return;
+    }
 
-  // Point head branch at the new commit.
-  if (head.setTarget(commit, "pull: fast-forward").isValid() && callback)
-    callback();
+    // Point head branch at the new commit.
+    if (head.setTarget(commit, "pull: fast-forward").isValid() && callback)
+      callback();
+  });
 }
 
 void RepoView::merge(
@@ -1455,6 +1873,117 @@ void RepoView::rebase(
   git::Branch head = mRepo.head();
   Q_ASSERT(head.isValid());
 
+  // Create the rewritten commits in the object database on the
+  // background worker. It opens its own repository so that it doesn't
+  // share the index with status. The working directory is only checked
+  // out once at the end.
+  QSharedPointer<RebaseResult> state(new RebaseResult);
+  state->tip = upstream.commit().id();
+
+  QString path = mRepo.dir().path();
+  QString user = mDetails->overrideUser();
+  QString email = mDetails->overrideEmail();
+  git::Id headId = head.target().id();
+
+  CheckoutCallbacks *callbacks =
+    new CheckoutCallbacks(parent, GIT_CHECKOUT_NOTIFY_UPDATED);
+  startCheckout(parent, callbacks,
+  [path, user, email, state, headId, callbacks] {
+    git::Repository repo = git::Repository::open(path);
+    if (!repo.isValid())
+      return false;
+
+    git::Commit onto = repo.lookupCommit(state->tip);
+    if (!onto.isValid())
+      return false;
+
+    git::Rebase rebase =
+      repo.rebase(onto.annotatedCommit(), user, email, true);
+    if (!rebase.isValid())
+      return false;
+
+    while (rebase.hasNext()) {
+      git::Commit before = rebase.next();
+      git::Commit after = before.isValid() ? rebase.commit() : git::Commit();
+      if (!after.isValid()) {
+        rebase.abort();
+        return false;
+      }
+
+      // Commits that were already applied aren't rewritten. A commit
+      // that's rewritten as itself has the current tip as its parent.
+      QList<git::Commit> parents = after.parents();
+      if (after != before ||
+          (!parents.isEmpty() && parents.first().id() == state->tip))
+        state->tip = after.id();
+
+      state->steps.append({before.id(), after.id()});
+    }
+
+    state->applied = true;
+    return (state->tip == headId ||
+            repo.checkout(repo.lookupCommit(state->tip), callbacks));
+  }, [this, state, head, headId, upstream, parent, callbacks, callback](
+       const git::Result &result) {
+    // Start over in the working directory to stop at the conflict.
+    if (!state->applied) {
+      rebaseWorkdir(upstream, parent, callback);
+      return;
+    }
+
+    if (!result) {
+      LogEntry *err =
+        error(parent, tr("rebase"), head.name(), result.errorString());
+      foreach (const QString &path, callbacks->conflicts())
+        err->queueEntry(LogEntry::File, path, '!');
+
+      // Add stash hint.
+      QString text =
+        tr("You may be able to reconcile your changes with the conflicting "
+           "files by <a href='action:stash'>stashing</a> before trying to "
+           "<a href='action:rebase'>rebase</a>. Then "
+           "<a href='action:unstash'>unstash</a> to restore your changes.");
+      err->addEntry(LogEntry::Hint, text);
+      return;
+    }
+
+    int i = 0;
+    int count = state->steps.size();
+    foreach (const RebaseResult::Step &step, state->steps) {
+      QString beforeText = mRepo.lookupCommit(step.before).link();
+      QString num = tr("%1/%2").arg(++i).arg(count);
+      parent->addEntry((step.after == step.before) ?
+        tr("%1 - %2 <i>already applied</i>").arg(num, beforeText) :
+        tr("%1 - %2 as %3").arg(
+          num, beforeText, msg(mRepo.lookupCommit(step.after))),
+        tr("Apply"));
+    }
+
+    // Update the branch on the main thread.
+    if (state->tip != headId) {
+      QString id = upstream.commit().id().toString();
+      QString log = QString("rebase (finish): %1 onto %2");
+      git::Commit tip = mRepo.lookupCommit(state->tip);
+      if (!head.setTarget(tip, log.arg(head.qualifiedName(), id))
+               .isValid()) {
+        error(parent, tr("rebase"), head.name());
+        return;
+      }
+    }
+
+    if (callback)
+      callback();
+  });
+}
+
+void RepoView::rebaseWorkdir(
+  const git::AnnotatedCommit &upstream,
+  LogEntry *parent,
+  const std::function<void()> &callback)
+{
+  git::Branch head = mRepo.head();
+  Q_ASSERT(head.isValid());
+
   git::Rebase rebase = mRepo.rebase(
     upstream,
     mDetails->overrideUser(),
@@ -1842,8 +2371,12 @@ void RepoView::push(
           this, &RepoView::notifyReferenceUpdated);
 
   entry->setBusy(true);
-  mWatcher->setFuture(QtConcurrent::run(
-    remote, &git::Remote::push, mCallbacks, ref, dst, force, tags));
+  RemoteCallbacks *callbacks = mCallbacks;
+  Scheduler *scheduler = Scheduler::instance();
+  mWatcher->setFuture(scheduler->run(Scheduler::Normal, mRepo,
+  [remote, callbacks, ref, dst, force, tags] {
+    return git::Remote(remote).push(callbacks, ref, dst, force, tags);
+  }));
 }
 
 bool RepoView::commit(
@@ -1971,10 +2504,14 @@ void RepoView::checkout(const git::Commit &commit, const QStringList &paths)
   QString text = tr("%1 - %2 %3").arg(commit.link(), count, name);
   LogEntry *entry = addLogEntry(text, tr("Checkout"));
 
-  CheckoutCallbacks callbacks(entry, GIT_CHECKOUT_NOTIFY_ALL);
-  int strategy = GIT_CHECKOUT_SAFE | GIT_CHECKOUT_DONT_UPDATE_INDEX;
-  mRepo.checkout(commit, &callbacks, paths, strategy);
-  mRefs->select(mRepo.head());
+  CheckoutCallbacks *callbacks =
+    new CheckoutCallbacks(entry, GIT_CHECKOUT_NOTIFY_ALL);
+  startCheckout(entry, callbacks, [this, commit, paths, callbacks] {
+    int strategy = GIT_CHECKOUT_SAFE | GIT_CHECKOUT_DONT_UPDATE_INDEX;
+    return mRepo.checkout(commit, callbacks, paths, strategy);
+  }, [this](const git::Result &result) {
+    mRefs->select(mRepo.head());
+  });
 }
 
 void RepoView::checkout(
@@ -2050,33 +2587,91 @@ void RepoView::checkout(
   }
 
   LogEntry *entry = addLogEntry(name, tr("Checkout"));
-  CheckoutCallbacks callbacks(entry, GIT_CHECKOUT_NOTIFY_DIRTY);
-  if (!commit.isValid() || !mRepo.checkout(commit, &callbacks) ||
-      (detach && !mRepo.setHeadDetached(commit)) ||
-      (!detach && !mRepo.setHead(ref))) {
-    LogEntry *err = error(entry, tr("checkout"), name);
-    foreach (const QString &path, callbacks.conflicts())
-      err->addEntry(LogEntry::File, path)->setStatus('!');
-
-    if (ref.isValid()) {
-      QUrlQuery query;
-      query.addQueryItem("ref", ref.qualifiedName());
-      if (detach)
-        query.addQueryItem("detach", "true");
+  CheckoutCallbacks *callbacks =
+    new CheckoutCallbacks(entry, GIT_CHECKOUT_NOTIFY_DIRTY);
+  startCheckout(entry, callbacks, [this, commit, callbacks] {
+    return commit.isValid() && mRepo.checkout(commit, callbacks);
+  }, [this, commit, ref, detach, name, entry, callbacks](
+       const git::Result &result) {
+    // Update HEAD on the main thread.
+    if (!result ||
+        (detach && !mRepo.setHeadDetached(commit)) ||
+        (!detach && !mRepo.setHead(ref))) {
+      QString msg = !result ? result.errorString() : QString();
+      LogEntry *err = error(entry, tr("checkout"), name, msg);
+      foreach (const QString &path, callbacks->conflicts())
+        err->queueEntry(LogEntry::File, path, '!');
+
+      if (ref.isValid()) {
+        QUrlQuery query;
+        query.addQueryItem("ref", ref.qualifiedName());
+        if (detach)
+          query.addQueryItem("detach", "true");
+
+        // Add stash hint.
+        QString text =
+          tr("You may be able to reconcile your changes with the conflicting "
+             "files by <a href='action:stash'>stashing</a> before you "
+             "<a href='action:checkout?%1'>checkout '%2'</a>. Then "
+             "<a href='action:unstash'>unstash</a> to restore your changes.");
+        err->addEntry(LogEntry::Hint, text.arg(query.toString(), ref.name()));
+      }
 
-      // Add stash hint.
-      QString text =
-        tr("You may be able to reconcile your changes with the conflicting "
-           "files by <a href='action:stash'>stashing</a> before you "
-           "<a href='action:checkout?%1'>checkout '%2'</a>. Then "
-           "<a href='action:unstash'>unstash</a> to restore your changes.");
-      err->addEntry(LogEntry::Hint, text.arg(query.toString(), ref.name()));
+      return;
     }
 
+    mRefs->select(mRepo.head());
+  });
+}
+
+void RepoView::startCheckout(
+  LogEntry *entry,
+  CheckoutCallbacks *callbacks,
+  const std::function<bool()> &checkout,
+  const std::function<void(const git::Result &)> &finish)
+{
+  if (mWatcher) {
+    // Queue checkout. Wait for the watcher to be destroyed
+    // because it may already be finished but not cleaned up yet.
+    connect(mWatcher, &QObject::destroyed, this,
+    [this, entry, callbacks, checkout, finish] {
+      startCheckout(entry, callbacks, checkout, finish);
+    });
+
     return;
   }
 
-  mRefs->select(mRepo.head());
+  // Status reads the index that the checkout writes. Hold status and
+  // workdir notifications until the checkout is done.
+  mCommits->setStatusSuspended(true);
+  mRepoWatcher->setSuspended(true);
+
+  mWatcher = new QFutureWatcher<git::Result>(this);
+  connect(mWatcher, &QFutureWatcher<git::Result>::finished, mWatcher,
+  [this, entry, finish] {
+    entry->setBusy(false);
+    mCommits->setStatusSuspended(false);
+    mRepoWatcher->setSuspended(mHibernated);
+
+    git::Result result = mWatcher->result();
+    if (!result && mCheckoutCallbacks->isCanceled()) {
+      entry->addEntry(LogEntry::Error, tr("Checkout canceled."));
+    } else {
+      finish(result);
+    }
+
+    mWatcher->deleteLater();
+    mWatcher = nullptr;
+    mCheckoutCallbacks = nullptr;
+  });
+
+  mCheckoutCallbacks = callbacks;
+  mCheckoutCallbacks->setParent(mWatcher);
+
+  entry->setBusy(true);
+  mWatcher->setFuture(QtConcurrent::run([checkout] {
+    return git::Result(checkout() ? 0 : -1);
+  }));
 }
 
 void RepoView::promptToCreateBranch(const git::Commit &commit)
@@ -2167,12 +2762,18 @@ void RepoView::applyStash(int index)
 
   git::Commit commit = stashes.at(index);
   LogEntry *entry = addLogEntry(msg(commit), tr("Apply Stash"));
-  if (!mRepo.applyStash(index)) {
-    error(entry, tr("apply stash"), commit.link());
-    return;
-  }
+  CheckoutCallbacks *callbacks =
+    new CheckoutCallbacks(entry, GIT_CHECKOUT_NOTIFY_NONE);
+  startCheckout(entry, callbacks, [this, index, callbacks] {
+    return mRepo.applyStash(index, callbacks);
+  }, [this, commit, entry](const git::Result &result) {
+    if (!result) {
+      error(entry, tr("apply stash"), commit.link(), result.errorString());
+      return;
+    }
 
-  refresh();
+    refresh();
+  });
 }
 
 void RepoView::dropStash(int index)
@@ -2193,12 +2794,18 @@ void RepoView::popStash(int index)
 
   git::Commit commit = stashes.at(index);
   LogEntry *entry = addLogEntry(msg(commit), tr("Pop Stash"));
-  if (!mRepo.popStash(index)) {
-    error(entry, tr("pop stash"), commit.link());
-    return;
-  }
+  CheckoutCallbacks *callbacks =
+    new CheckoutCallbacks(entry, GIT_CHECKOUT_NOTIFY_NONE);
+  startCheckout(entry, callbacks, [this, index, callbacks] {
+    return mRepo.popStash(index, callbacks);
+  }, [this, commit, entry](const git::Result &result) {
+    if (!result) {
+      error(entry, tr("pop stash"), commit.link(), result.errorString());
+      return;
+    }
 
-  refresh();
+    refresh();
+  });
 }
 
 void RepoView::promptToAddTag(const git::Commit &commit)
@@ -2307,8 +2914,23 @@ void RepoView::reset(
   QString text = tr("%1 to %2").arg(head.name(), commit.link());
   LogEntry *entry = addLogEntry(text, title);
 
-  if (!commit.reset(type))
-    error(entry, commitToAmend ? tr("amend") : tr("reset"), head.name());
+  // Only a hard reset touches the working directory.
+  if (type != GIT_RESET_HARD) {
+    if (!commit.reset(type))
+      error(entry, commitToAmend ? tr("amend") : tr("reset"), head.name());
+    return;
+  }
+
+  CheckoutCallbacks *callbacks =
+    new CheckoutCallbacks(entry, GIT_CHECKOUT_NOTIFY_NONE);
+  startCheckout(entry, callbacks, [this, commit, type, callbacks] {
+    return mRepo.reset(commit, type, QStringList(), callbacks);
+  }, [this, head, entry, commitToAmend](const git::Result &result) {
+    if (!result) {
+      QString action = commitToAmend ? tr("amend") : tr("reset");
+      error(entry, action, head.name(), result.errorString());
+    }
+  });
 }
 
 void RepoView::updateSubmodules(
@@ -2369,6 +2991,25 @@ QList<RepoView::SubmoduleInfo> RepoView::submoduleInfoList(
   return list;
 }
 
+struct RepoView::SubmoduleUpdate
+{
+  bool recursive;
+  bool init;
+  int jobs;
+
+  bool canceled = false;
+  int total = 0;
+  int finished = 0;
+  LogEntry *progress = nullptr;
+
+  QList<SubmoduleInfo> queue;
+  QMap<QFutureWatcher<git::Result> *,RemoteCallbacks *> running;
+  QSharedPointer<RemoteCallbacks::SharedCredentials> credentials;
+
+  // Aggregate future. Finished when the last update finishes.
+  QFutureInterface<git::Result> interface;
+};
+
 void RepoView::updateSubmodulesAsync(
   const QList<SubmoduleInfo> &submodules,
   bool recursive,
@@ -2379,53 +3020,149 @@ void RepoView::updateSubmodulesAsync(
     return;
   }
 
-  // Remove first submodule from the list.
-  QList<SubmoduleInfo> tail = submodules;
-  SubmoduleInfo info = tail.takeFirst();
-  git::Submodule submodule = info.submodule;
-  LogEntry *entry = info.entry->addEntry(submodule.name(), tr("Update"));
+  // Read the number of parallel updates.
+  Settings *settings = Settings::instance();
+  int jobs = settings->value("global/submodule/jobs").toInt();
+  jobs = mRepo.config().value<int>("submodule.fetchJobs", jobs);
+
+  SubmoduleUpdate *update = new SubmoduleUpdate;
+  update->recursive = recursive;
+  update->init = init;
+  update->jobs = (jobs > 0) ? jobs : QThread::idealThreadCount();
+  update->total = submodules.size();
+  update->progress = submodules.first().entry->addEntry(QString());
+  update->queue = submodules;
+  update->credentials.reset(new RemoteCallbacks::SharedCredentials);
+  update->interface.reportStarted();
+  mSubmoduleUpdate = update;
 
   mWatcher = new QFutureWatcher<git::Result>(this);
   connect(mWatcher, &QFutureWatcher<git::Result>::finished, mWatcher,
-  [this, init, recursive, tail, info, entry] {
-    entry->setBusy(false);
-
-    git::Result result = mWatcher->result();
-    if (mCallbacks->isCanceled()) {
-      entry->addEntry(LogEntry::Error, tr("Fetch canceled."));
-    } else if (!result) {
-      QString name = info.submodule.name();
-      error(entry, tr("update submodule"), name, result.errorString());
-    } else {
-      mCallbacks->storeDeferredCredentials();
-    }
+  [this, update] {
+    delete update;
+    mSubmoduleUpdate = nullptr;
 
     mWatcher->deleteLater();
     mWatcher = nullptr;
-    mCallbacks = nullptr;
 
-    // Build list of submodules recursively.
-    QList<SubmoduleInfo> prefix;
-    if (recursive) {
-      if (git::Repository repo = info.submodule.open()) {
-        QList<git::Submodule> submodules = repo.submodules();
-        if (!submodules.isEmpty())
-          prefix = submoduleInfoList(repo, submodules, init, entry);
+    refresh();
+  });
+
+  mWatcher->setFuture(update->interface.future());
+  startSubmoduleUpdates();
+}
+
+void RepoView::startSubmoduleUpdates()
+{
+  SubmoduleUpdate *update = mSubmoduleUpdate;
+
+  // Update aggregate progress.
+  int percent = 100 * update->finished / update->total;
+  QString text = tr("Updating submodules: %1% (%2/%3)").arg(percent)
+    .arg(update->finished).arg(update->total);
+  if (update->finished == update->total)
+    text.append(tr(", done"));
+  update->progress->setText(text + ".");
+
+  while (!update->canceled && !update->queue.isEmpty() &&
+         update->running.size() < update->jobs) {
+    SubmoduleInfo info = update->queue.takeFirst();
+    git::Submodule submodule = info.submodule;
+    LogEntry *entry = info.entry->addEntry(submodule.name(), tr("Update"));
+
+    using Watcher = QFutureWatcher<git::Result>;
+    Watcher *watcher = new Watcher(this);
+
+    QString url = submodule.url();
+    git::Repository repo = submodule.open();
+    RemoteCallbacks *callbacks = new RemoteCallbacks(
+      RemoteCallbacks::Receive, entry, url, QString(), watcher, repo);
+    callbacks->setSharedCredentials(update->credentials);
+    update->running.insert(watcher, callbacks);
+
+    connect(watcher, &Watcher::finished, watcher,
+    [this, info, entry, watcher, callbacks] {
+      entry->setBusy(false);
+
+      git::Result result = watcher->result();
+      if (callbacks->isCanceled()) {
+        entry->addEntry(LogEntry::Error, tr("Fetch canceled."));
+      } else if (!result) {
+        QString name = info.submodule.name();
+        error(entry, tr("update submodule"), name, result.errorString());
+      } else {
+        callbacks->storeDeferredCredentials();
       }
-    }
 
-    // Restart with smaller list.
-    updateSubmodulesAsync(prefix + tail, recursive, init);
-  });
+      watcher->deleteLater();
 
-  QString url = submodule.url();
-  git::Repository repo = submodule.open();
-  mCallbacks = new RemoteCallbacks(
-    RemoteCallbacks::Receive, entry, url, QString(), mWatcher, repo);
+      // The update may have been finished by cancellation.
+      SubmoduleUpdate *update = mSubmoduleUpdate;
+      if (!update || !update->running.remove(watcher))
+        return;
 
-  entry->setBusy(true);
-  mWatcher->setFuture(QtConcurrent::run(
-    submodule, &git::Submodule::update, mCallbacks, init));
+      update->finished++;
+
+      // Nested submodules can only start after their parent is updated.
+      if (update->recursive && !update->canceled) {
+        if (git::Repository repo = info.submodule.open()) {
+          QList<git::Submodule> submodules = repo.submodules();
+          if (!submodules.isEmpty()) {
+            QList<SubmoduleInfo> prefix =
+              submoduleInfoList(repo, submodules, update->init, entry);
+            update->queue = prefix + update->queue;
+            update->total += prefix.size();
+          }
+        }
+      }
+
+      startSubmoduleUpdates();
+      if (update->running.isEmpty())
+        finishSubmoduleUpdates();
+    });
+
+    // Initialize on this thread so that config writes to the parent
+    // don't race. Each job then updates through its own copy of the
+    // parent repository instead of sharing its libgit2 state.
+    if (update->init && !submodule.isInitialized())
+      submodule.initialize();
+
+    QString path = info.repo.dir().path();
+    QString name = submodule.name();
+    entry->setBusy(true);
+    Scheduler *scheduler = Scheduler::instance();
+    watcher->setFuture(scheduler->run(Scheduler::Normal, mRepo,
+    [path, name, callbacks] {
+      git::Repository repo = git::Repository::open(path);
+      git::Submodule submodule =
+        repo.isValid() ? repo.lookupSubmodule(name) : git::Submodule();
+      if (!submodule.isValid())
+        return git::Result();
+
+      return submodule.update(callbacks);
+    }));
+  }
+}
+
+void RepoView::finishSubmoduleUpdates()
+{
+  QFutureInterface<git::Result> &interface = mSubmoduleUpdate->interface;
+  if (interface.isFinished())
+    return;
+
+  git::Result result(0);
+  interface.reportFinished(&result);
+}
+
+void RepoView::cancelSubmoduleUpdates()
+{
+  if (!mSubmoduleUpdate)
+    return;
+
+  // Don't wait. The update finishes when the last running job returns.
+  mSubmoduleUpdate->canceled = true;
+  foreach (RemoteCallbacks *callbacks, mSubmoduleUpdate->running)
+    callbacks->setCanceled(true);
 }
 
 bool RepoView::openSubmodule(const git::Submodule &submodule)
@@ -2663,6 +3400,9 @@ EditorWindow *RepoView::openEditor(
 
 void RepoView::refresh()
 {
+  // Look for references that changed outside of the app.
+  mRepo.invalidateRefs();
+
   // Fake head update.
   emit mRepo.notifier()->referenceUpdated(mRepo.head());
 }
@@ -2721,19 +3461,102 @@ RepoView *RepoView::parentView(const QWidget *widget)
   return parentView(parent);
 }
 
+void RepoView::hibernate()
+{
+  if (mHibernated)
+    return;
+
+  mHibernated = true;
+  mHibernateTimer.stop();
+
+  // Hold workdir notifications until the view resumes.
+  mRepoWatcher->setSuspended(true);
+
+  // Stop status and indexing. They restart when the view resumes.
+  mStatusPending = mCommits->cancelStatus();
+  if (mIndexer.state() != QProcess::NotRunning) {
+    mRestartIndexer = false;
+    mIndexPending = true;
+    cancelIndexing();
+  }
+
+  // Drop diff widgets.
+  mDetails->cancelBackgroundTasks();
+  mDetails->setDiff(git::Diff());
+}
+
+void RepoView::resume()
+{
+  mHibernateTimer.stop();
+  if (!mHibernated)
+    return;
+
+  mHibernated = false;
+
+  // Report accumulated workdir changes. A canceled status needs
+  // a full scan, which covers any accumulated paths.
+  if (mStatusPending) {
+    mStatusPending = false;
+    mRepoWatcher->cancelPendingNotification();
+    mRepoWatcher->setSuspended(false);
+    emit mRepo.notifier()->workdirChanged(QStringList());
+  } else {
+    mRepoWatcher->setSuspended(false);
+  }
+
+  // Restore the diff for the current selection.
+  mCommits->resetSelection();
+
+  // Resume the remaining background tasks after the view has updated.
+  QTimer::singleShot(0, this, [this] {
+    if (mHibernated)
+      return;
+
+    if (mIndexPending) {
+      mIndexPending = false;
+      startIndexing();
+    }
+
+    if (mFetchPending)
+      startFetchTimer();
+
+    predictConflicts();
+  });
+}
+
 void RepoView::showEvent(QShowEvent *event)
 {
   QSplitter::showEvent(event);
 
+  resume();
+
   if (mShown)
     return;
 
   // Start background tasks after showing for the first time.
   mShown = true;
   startIndexing();
+  predictConflicts();
   startFetchTimer();
 }
 
+void RepoView::hideEvent(QHideEvent *event)
+{
+  QSplitter::hideEvent(event);
+
+  Settings *settings = Settings::instance();
+  settings->beginGroup("global/hibernate");
+  bool enable = settings->value("enable").toBool();
+  int minutes = settings->value("minutes").toInt();
+  settings->endGroup();
+
+  git::Config config = mRepo.appConfig();
+  if (!config.value<bool>("hibernate.enable", enable))
+    return;
+
+  mHibernateTimer.start(config.value<int>("hibernate.minutes", minutes) * 60000);
+}
+
 void RepoView::closeEvent(QCloseEvent *event)
 {
   // Try to close tracked windows.
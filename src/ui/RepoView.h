@@ -23,10 +23,12 @@
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QProcess>
+#include <QSet>
 #include <QSplitter>
 #include <QTimer>
 #include <functional>
 
+class CheckoutCallbacks;
 class CommitList;
 class DetailView;
 class EditorWindow;
@@ -39,6 +41,7 @@ class MainWindow;
 class PathspecWidget;
 class ReferenceWidget;
 class RemoteCallbacks;
+class RepositoryWatcher;
 class ToolBar;
 
 namespace git {
@@ -119,7 +122,8 @@ public:
   git::Tree tree() const;
 
   // background tasks
-  void cancelRemoteTransfer();
+  void cancelRemoteTransfer(const QModelIndex &index = QModelIndex());
+  void cancelCheckout();
   void cancelBackgroundTasks();
 
   // links
@@ -138,6 +142,16 @@ public:
   void startIndexing();
   void cancelIndexing();
 
+  // Predict conflicts between each local branch and its upstream.
+  void predictConflicts();
+
+  // hibernation
+  // Hidden views drop their diff widgets and defer background work
+  // (status, indexing, automatic fetch) until they're shown again.
+  bool isHibernated() const { return mHibernated; }
+  void hibernate();
+  void resume();
+
   // log window
   bool isLogVisible() const;
   void setLogVisible(bool visible);
@@ -154,6 +168,7 @@ public:
 
   // automatic fetch
   void startFetchTimer();
+  void startAutoFetch();
 
   // fetch
   void fetchAll();
@@ -325,6 +340,7 @@ signals:
 
 protected:
   void showEvent(QShowEvent *event) override;
+  void hideEvent(QHideEvent *event) override;
   void closeEvent(QCloseEvent *event) override;
 
 private:
@@ -335,11 +351,16 @@ private:
     LogEntry *entry;
   };
 
+  struct SubmoduleUpdate;
+  struct FetchAll;
+
   ToolBar *toolBar() const;
   CommitList *commitList() const;
 
   void notifyReferenceUpdated(const QString &name);
 
+  void releaseIndexer();
+
   void startLogTimer();
   bool suspendLogTimer();
   void resumeLogTimer(bool suspended = true);
@@ -353,14 +374,46 @@ private:
     const QList<SubmoduleInfo> &submodules,
     bool recursive = true,
     bool init = false);
+  void startFetches();
+  void finishFetches();
+
+  void startSubmoduleUpdates();
+  void finishSubmoduleUpdates();
+  void cancelSubmoduleUpdates();
 
   bool checkForConflicts(LogEntry *parent, const QString &action);
 
+  // Rebase step by step in the working directory. This is
+  // only used when the in-memory rebase can't finish.
+  void rebaseWorkdir(
+    const git::AnnotatedCommit &upstream,
+    LogEntry *parent,
+    const std::function<void()> &callback);
+
+  // Run a checkout-like operation on the background worker.
+  // The finish function is called on the main thread.
+  void startCheckout(
+    LogEntry *entry,
+    CheckoutCallbacks *callbacks,
+    const std::function<bool()> &checkout,
+    const std::function<void(const git::Result &)> &finish);
+
   git::Repository mRepo;
 
   Index *mIndex;
   QProcess mIndexer;
   bool mRestartIndexer = false;
+  bool mIndexerQueued = false;
+  bool mIndexerSlot = false;
+  QTimer mConflictTimer;
+  QSet<QPair<git::Id,git::Id>> mConflictsWaiting;
+
+  RepositoryWatcher *mRepoWatcher;
+  QTimer mHibernateTimer;
+  bool mHibernated = false;
+  bool mStatusPending = false;
+  bool mIndexPending = false;
+  bool mFetchPending = false;
 
   History *mHistory;
 
@@ -379,7 +432,10 @@ private:
 
   QTimer mFetchTimer;
   RemoteCallbacks *mCallbacks = nullptr;
+  CheckoutCallbacks *mCheckoutCallbacks = nullptr;
   QFutureWatcher<git::Result> *mWatcher = nullptr;
+  SubmoduleUpdate *mSubmoduleUpdate = nullptr;
+  FetchAll *mFetchAll = nullptr;
 
   QList<QWidget *> mTrackedWindows;
 
@@ -0,0 +1,61 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "ResourceGovernor.h"
+#include "conf/Settings.h"
+#include <QCoreApplication>
+#include <QThread>
+
+ResourceGovernor::ResourceGovernor(QObject *parent)
+  : QObject(parent)
+{}
+
+void ResourceGovernor::acquire(
+  QObject *context,
+  const std::function<void()> &start)
+{
+  if (mRunning >= limit()) {
+    mQueue.append({context, start});
+    return;
+  }
+
+  ++mRunning;
+  start();
+}
+
+void ResourceGovernor::release()
+{
+  Q_ASSERT(mRunning > 0);
+  --mRunning;
+
+  // Start the next queued job whose context is still alive.
+  while (mRunning < limit() && !mQueue.isEmpty()) {
+    Job job = mQueue.takeFirst();
+    if (!job.context)
+      continue;
+
+    ++mRunning;
+    job.start();
+  }
+}
+
+int ResourceGovernor::limit() const
+{
+  int jobs = Settings::instance()->value("global/background/jobs").toInt();
+  return (jobs > 0) ? jobs : QThread::idealThreadCount();
+}
+
+ResourceGovernor *ResourceGovernor::instance()
+{
+  static ResourceGovernor *instance = nullptr;
+  if (!instance)
+    instance = new ResourceGovernor(qApp);
+
+  return instance;
+}
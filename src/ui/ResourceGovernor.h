@@ -0,0 +1,52 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#ifndef RESOURCEGOVERNOR_H
+#define RESOURCEGOVERNOR_H
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <functional>
+
+// Limits the number of background jobs (indexers, automatic fetches)
+// that run concurrently across all open repositories. Jobs that don't
+// fit in the budget are queued until a running job releases its slot.
+class ResourceGovernor : public QObject
+{
+  Q_OBJECT
+
+public:
+  // Start the job now if there's room in the budget. Otherwise queue
+  // it. Every started job must eventually call release(). Queued jobs
+  // are dropped if the context is destroyed before they start.
+  void acquire(QObject *context, const std::function<void()> &start);
+  void release();
+
+  // The current budget and usage.
+  int limit() const;
+  int running() const { return mRunning; }
+  int queued() const { return mQueue.size(); }
+
+  static ResourceGovernor *instance();
+
+private:
+  struct Job
+  {
+    QPointer<QObject> context;
+    std::function<void()> start;
+  };
+
+  ResourceGovernor(QObject *parent = nullptr);
+
+  int mRunning = 0;
+  QList<Job> mQueue;
+};
+
+#endif
@@ -0,0 +1,160 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Scheduler.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QThreadPool>
+
+namespace {
+
+const int kPriorityCount = Scheduler::Bulk + 1;
+
+} // anon. namespace
+
+Scheduler::Task::Task(
+  Scheduler *scheduler,
+  Priority priority,
+  const QString &key)
+  : mScheduler(scheduler), mPriority(priority), mKey(key)
+{}
+
+void Scheduler::Task::run()
+{
+  mScheduler->dequeue(this);
+  execute();
+
+  // Threads that wait on a future can run the task directly.
+  // Only steal more work on a worker thread.
+  QCoreApplication *app = QCoreApplication::instance();
+  if (!app || QThread::currentThread() != app->thread())
+    mScheduler->steal(mPriority);
+}
+
+Scheduler::Scheduler(QObject *parent)
+  : QObject(parent)
+{
+  // Bulk work is limited to a fraction of the machine.
+  int count = QThread::idealThreadCount();
+  for (int i = 0; i < kPriorityCount; ++i) {
+    QThreadPool *pool = new QThreadPool(this);
+    pool->setMaxThreadCount(i == Bulk ? qMax(1, count / 4) : count);
+    mPools.append(pool);
+    mQueues.append(QList<Task *>());
+  }
+}
+
+void Scheduler::cancel(const git::Repository &repo)
+{
+  QString key = this->key(repo);
+
+  QList<Task *> canceled;
+  QMutexLocker locker(&mMutex);
+  for (int i = 0; i < kPriorityCount; ++i) {
+    QMutableListIterator<Task *> it(mQueues[i]);
+    while (it.hasNext()) {
+      Task *task = it.next();
+      if (task->key() == key && mPools.at(i)->tryTake(task)) {
+        it.remove();
+        canceled.append(task);
+      }
+    }
+  }
+
+  locker.unlock();
+
+  // Finish canceled tasks outside of the lock.
+  foreach (Task *task, canceled) {
+    task->cancel();
+    delete task;
+  }
+}
+
+void Scheduler::enqueue(Task *task)
+{
+  QThreadPool *pool = mPools.at(task->priority());
+  task->setThreadPool(pool);
+
+  QMutexLocker locker(&mMutex);
+  mQueues[task->priority()].append(task);
+  pool->start(task);
+}
+
+void Scheduler::dequeue(Task *task)
+{
+  QMutexLocker locker(&mMutex);
+  mQueues[task->priority()].removeOne(task);
+}
+
+void Scheduler::steal(Priority priority)
+{
+  QThreadPool *pool = mPools.at(priority);
+  forever {
+    // Leave the thread to this class if it has queued work. Always
+    // keep a free thread for new tasks in this class. The calling
+    // thread still counts as active.
+    Task *task = nullptr;
+    QMutexLocker locker(&mMutex);
+    if (!mQueues.at(priority).isEmpty() ||
+        pool->activeThreadCount() >= pool->maxThreadCount())
+      return;
+
+    // Take the oldest task from the highest lower priority class.
+    // The lock prevents the task from starting (and being deleted)
+    // on its own thread until it's been taken from the pool.
+    QThreadPool *source = nullptr;
+    for (int i = priority + 1; i < kPriorityCount && !task; ++i) {
+      // Bulk work never runs on interactive threads. Other threads
+      // only take it while the bulk class is under its limit.
+      QThreadPool *candidatePool = mPools.at(i);
+      if (i == Bulk && (priority == Interactive ||
+          candidatePool->activeThreadCount() >=
+          candidatePool->maxThreadCount()))
+        continue;
+
+      QMutableListIterator<Task *> it(mQueues[i]);
+      while (it.hasNext()) {
+        Task *candidate = it.next();
+        if (candidatePool->tryTake(candidate)) {
+          it.remove();
+          task = candidate;
+          source = candidatePool;
+          break;
+        }
+      }
+    }
+
+    if (!task)
+      return;
+
+    // Count the task against its own class while it runs here.
+    source->reserveThread();
+    locker.unlock();
+
+    // Ownership transfers to the caller of tryTake.
+    task->execute();
+    delete task;
+
+    source->releaseThread();
+  }
+}
+
+QString Scheduler::key(const git::Repository &repo)
+{
+  return repo.isValid() ? repo.dir().path() : QString();
+}
+
+Scheduler *Scheduler::instance()
+{
+  static Scheduler *instance = nullptr;
+  if (!instance)
+    instance = new Scheduler(qApp);
+
+  return instance;
+}
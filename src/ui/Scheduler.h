@@ -0,0 +1,141 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "git/Repository.h"
+#include <QFuture>
+#include <QFutureInterface>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QRunnable>
+#include <functional>
+
+class QThreadPool;
+
+// Runs background tasks on a separate thread pool for each priority
+// class so that interactive tasks never queue behind bulk tasks. Idle
+// workers steal queued tasks from lower priority classes. A stolen
+// task still counts against its own class, so bulk work never exceeds
+// its limit, and interactive workers never take bulk work. Queued tasks
+// are tagged with their repository and can be canceled together.
+class Scheduler : public QObject
+{
+public:
+  enum Priority
+  {
+    Interactive, // status, blame, selected diff
+    Normal,      // user initiated remote operations
+    Bulk         // automatic fetch, other periodic work
+  };
+
+  // Queue the function to run in the given priority class. The
+  // function's return type must be default constructible. Tasks
+  // canceled before they start finish with a default result.
+  template <typename Function>
+  auto run(Priority priority, const git::Repository &repo, Function function)
+    -> QFuture<decltype(function())>
+  {
+    using T = decltype(function());
+    FunctionTask<T> *task =
+      new FunctionTask<T>(this, priority, key(repo), function);
+
+    QFuture<T> future = task->future();
+    enqueue(task);
+    return future;
+  }
+
+  // Cancel all queued tasks for the given repository. Running
+  // tasks are canceled through their own callbacks.
+  void cancel(const git::Repository &repo);
+
+  static Scheduler *instance();
+
+private:
+  class Task : public QRunnable
+  {
+  public:
+    Task(Scheduler *scheduler, Priority priority, const QString &key);
+
+    Priority priority() const { return mPriority; }
+    const QString &key() const { return mKey; }
+
+    void run() override;
+
+    virtual void setThreadPool(QThreadPool *pool) = 0;
+    virtual void execute() = 0;
+    virtual void cancel() = 0;
+
+  private:
+    Scheduler *mScheduler;
+    Priority mPriority;
+    QString mKey;
+  };
+
+  template <typename T>
+  class FunctionTask : public Task
+  {
+  public:
+    FunctionTask(
+      Scheduler *scheduler,
+      Priority priority,
+      const QString &key,
+      const std::function<T()> &function)
+      : Task(scheduler, priority, key), mFunction(function)
+    {
+      mInterface.reportStarted();
+    }
+
+    QFuture<T> future() { return mInterface.future(); }
+
+    // Allow threads that wait on the future to run the task directly.
+    void setThreadPool(QThreadPool *pool) override
+    {
+      mInterface.setThreadPool(pool);
+      mInterface.setRunnable(this);
+    }
+
+    void execute() override
+    {
+      if (!mInterface.isCanceled()) {
+        T result = mFunction();
+        mInterface.reportResult(result);
+      }
+
+      mInterface.reportFinished();
+    }
+
+    void cancel() override
+    {
+      mInterface.reportResult(T());
+      mInterface.reportCanceled();
+      mInterface.reportFinished();
+    }
+
+  private:
+    QFutureInterface<T> mInterface;
+    std::function<T()> mFunction;
+  };
+
+  Scheduler(QObject *parent = nullptr);
+
+  void enqueue(Task *task);
+  void dequeue(Task *task);
+  void steal(Priority priority);
+
+  static QString key(const git::Repository &repo);
+
+  QMutex mMutex;
+  QList<QThreadPool *> mPools;
+  QList<QList<Task *>> mQueues;
+};
+
+#endif
@@ -64,12 +64,35 @@ SpellChecker::~SpellChecker()
 
 bool SpellChecker::spell(const QString &word)
 {
+  bool correct = true;
+  if (isCached(word, correct))
+    return correct;
+
+  // Don't hold the cache while Hunspell looks the word up.
   // Encode from Unicode to the encoding used by current dictionary.
-  return mHunspell->spell(mCodec->fromUnicode(word).toStdString());
+  QMutexLocker hunspell(&mHunspellMutex);
+  correct = mHunspell->spell(mCodec->fromUnicode(word).toStdString());
+  hunspell.unlock();
+
+  QMutexLocker locker(&mMutex);
+  mCache.insert(word, correct);
+  return correct;
+}
+
+bool SpellChecker::isCached(const QString &word, bool &correct) const
+{
+  QMutexLocker locker(&mMutex);
+  auto it = mCache.constFind(word);
+  if (it == mCache.constEnd())
+    return false;
+
+  correct = it.value();
+  return true;
 }
 
 QStringList SpellChecker::suggest(const QString &word)
 {
+  QMutexLocker locker(&mHunspellMutex);
   QStringList suggestions;
 
   // Retrive suggestions for word.
@@ -84,13 +107,21 @@ QStringList SpellChecker::suggest(const QString &word)
 
 void SpellChecker::ignoreWord(const QString &word)
 {
+  QMutexLocker hunspell(&mHunspellMutex);
   mHunspell->add(mCodec->fromUnicode(word).constData());
+
+  QMutexLocker locker(&mMutex);
+  mCache.insert(word, true);
 }
 
 void SpellChecker::addToUserDict(const QString &word)
 {
+  QMutexLocker hunspell(&mHunspellMutex);
   mHunspell->add(mCodec->fromUnicode(word).constData());
 
+  QMutexLocker locker(&mMutex);
+  mCache.insert(word, true);
+
   if (!mUserDictionary.isEmpty()) {
     QFile userDictonaryFile(mUserDictionary);
     if (userDictonaryFile.open(QIODevice::Append)) {
@@ -103,6 +134,10 @@ void SpellChecker::addToUserDict(const QString &word)
 
 void SpellChecker::removeUserDict(void)
 {
+  // Cached results may include words from the user dictionary.
+  QMutexLocker locker(&mMutex);
+  mCache.clear();
+
   if (!mUserDictionary.isEmpty()) {
     QFile userDictonaryFile(mUserDictionary);
     userDictonaryFile.resize(0);
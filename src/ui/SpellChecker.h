@@ -3,6 +3,8 @@
 #ifndef SPELLCHECKER_H
 #define SPELLCHECKER_H
 
+#include <QHash>
+#include <QMutex>
 #include <QString>
 
 class Hunspell;
@@ -13,9 +15,13 @@ public:
   SpellChecker(const QString &dictionaryPath, const QString &userDictionary);
   ~SpellChecker();
 
+  // These are safe to call from any thread.
   bool spell(const QString &word);
   QStringList suggest(const QString &word);
 
+  // Look up the cached result for a word without calling Hunspell.
+  bool isCached(const QString &word, bool &correct) const;
+
   void ignoreWord(const QString &word);
   void addToUserDict(const QString &word);
   void removeUserDict(void);
@@ -29,6 +35,12 @@ private:
   QString mUserDictionary;
 
   bool mValid = false;
+
+  // Hunspell calls are serialized separately from the cache so
+  // that cache lookups don't wait for slow lookups.
+  QMutex mHunspellMutex;
+  mutable QMutex mMutex;
+  QHash<QString,bool> mCache;
 };
 
 #endif // SPELLCHECKER_H 
@@ -12,7 +12,6 @@
 #include "git/Blob.h"
 #include "git/Diff.h"
 #include "git/RevWalk.h"
-#include "git/Submodule.h"
 #include <QStringBuilder>
 #include <QUrl>
 
@@ -26,26 +25,43 @@ TreeModel::TreeModel(const git::Repository &repo, QObject *parent)
   : QAbstractItemModel(parent), mRepo(repo)
 {}
 
-TreeModel::~TreeModel()
-{
-  delete mRoot;
-}
+TreeModel::~TreeModel() {}
 
 void TreeModel::setTree(const git::Tree &tree, const git::Diff &diff)
 {
   beginResetModel();
 
-  delete mRoot;
-  mRoot = tree.isValid() ? new Node(mRepo.workdir().path(), tree) : nullptr;
+  mNodes.clear();
+  mRoot = nullptr;
+  if (tree.isValid()) {
+    mNodes.push_back({mRepo.workdir().path(), GIT_FILEMODE_TREE,
+                      nullptr, 0, tree, true, QVector<Node *>()});
+    mRoot = &mNodes.back();
+  }
 
   mDiff = diff;
+  mDiffIndexes.clear();
+  if (mDiff.isValid()) {
+    // Index each file by its own path and every parent directory.
+    for (int i = 0; i < mDiff.count(); ++i) {
+      QString path = mDiff.name(i);
+      mDiffIndexes[path].append(i);
+      for (int pos = path.lastIndexOf('/'); pos > 0;
+           pos = path.lastIndexOf('/', pos - 1))
+        mDiffIndexes[path.left(pos)].append(i);
+    }
+  }
 
   endResetModel();
 }
 
 int TreeModel::rowCount(const QModelIndex &parent) const
 {
-  return mRoot ? node(parent)->children().size() : 0;
+  if (!mRoot)
+    return 0;
+
+  git::Tree tree = this->tree(node(parent));
+  return tree.isValid() ? tree.count() : 0;
 }
 
 int TreeModel::columnCount(const QModelIndex &parent) const
@@ -55,17 +71,16 @@ int TreeModel::columnCount(const QModelIndex &parent) const
 
 bool TreeModel::hasChildren(const QModelIndex &parent) const
 {
-  return mRoot && node(parent)->hasChildren();
+  return (rowCount(parent) > 0);
 }
 
 QModelIndex TreeModel::parent(const QModelIndex &index) const
 {
-  Node *parent = node(index)->parent();
+  Node *parent = node(index)->parent;
   if (!parent || parent == mRoot)
     return QModelIndex();
 
-  Q_ASSERT(parent->parent()); // because parent is not root
-  return createIndex(parent->parent()->children().indexOf(parent), 0, parent);
+  return createIndex(parent->row, 0, parent);
 }
 
 QModelIndex TreeModel::index(
@@ -77,7 +92,7 @@ QModelIndex TreeModel::index(
       column < 0 || column >= columnCount(parent))
     return QModelIndex();
 
-  return createIndex(row, column, node(parent)->children().at(row));
+  return createIndex(row, column, child(node(parent), row));
 }
 
 QVariant TreeModel::data(const QModelIndex &index, int role) const
@@ -88,39 +103,32 @@ QVariant TreeModel::data(const QModelIndex &index, int role) const
   Node *node = this->node(index);
   switch (role) {
     case Qt::DisplayRole:
-      return node->name();
+      return node->name;
 
     case Qt::DecorationRole: {
-      QFileInfo info(node->path());
+      QFileInfo info(path(node));
       return info.exists() ? mIconProvider.icon(info) :
         mIconProvider.icon(QFileIconProvider::File);
     }
 
     case Qt::EditRole:
-      return node->path(true);
+      return path(node, true);
 
     case Qt::ToolTipRole:
-      return node->path();
+      return path(node);
 
     case Qt::CheckStateRole: {
       if (!mDiff.isValid() || !mDiff.isStatusDiff())
         return QVariant();
 
-      QStringList paths;
-      QString prefix = node->path(true);
-      for (int i = 0; i < mDiff.count(); ++i) {
-        QString path = mDiff.name(i);
-        if (path.startsWith(prefix))
-          paths.append(path);
-      }
-
-      if (paths.isEmpty())
+      QVector<int> indexes = diffIndexes(node);
+      if (indexes.isEmpty())
         return QVariant();
 
       int count = 0;
       git::Index index = mDiff.index();
-      foreach (const QString &path, paths) {
-        switch (index.isStaged(path)) {
+      foreach (int i, indexes) {
+        switch (index.isStaged(mDiff.name(i))) {
           case git::Index::Disabled:
           case git::Index::Unstaged:
           case git::Index::Conflicted:
@@ -135,20 +143,24 @@ QVariant TreeModel::data(const QModelIndex &index, int role) const
 
       if (count == 0) {
         return Qt::Unchecked;
-      } else if (count == paths.size()) {
+      } else if (count == indexes.size()) {
         return Qt::Checked;
       } else {
         return Qt::PartiallyChecked;
       }
     }
 
-    case BlobRole:
-      return QVariant::fromValue(git::Blob(node->object()));
+    case BlobRole: {
+      git::Tree tree = this->tree(node->parent);
+      return QVariant::fromValue(git::Blob(tree.object(node->row)));
+    }
 
     case KindRole: {
-      Settings *settings = Settings::instance();
-      git::Submodule submodule = mRepo.lookupSubmodule(node->path(true));
-      return submodule.isValid() ? tr("Submodule") : settings->kind(node->name());
+      // Submodules are recorded as commits in the tree.
+      if (node->mode == GIT_FILEMODE_COMMIT)
+        return tr("Submodule");
+
+      return Settings::instance()->kind(node->name);
     }
 
     case AddedRole:
@@ -157,7 +169,7 @@ QVariant TreeModel::data(const QModelIndex &index, int role) const
       if (role == AddedRole)
         sort |= GIT_SORT_REVERSE;
       git::RevWalk walker = mRepo.walker(sort);
-      git::Commit commit = walker.next(node->path(true));
+      git::Commit commit = walker.next(path(node, true));
       if (!commit.isValid())
         return QVariant();
 
@@ -172,13 +184,10 @@ QVariant TreeModel::data(const QModelIndex &index, int role) const
         return QString();
 
       QString status;
-      QString prefix = node->path(true);
-      for (int i = 0; i < mDiff.count(); ++i) {
-        if (mDiff.name(i).startsWith(prefix)) {
-          QChar ch = git::Diff::statusChar(mDiff.status(i));
-          if (!status.contains(ch))
-            status.append(ch);
-        }
+      foreach (int i, diffIndexes(node)) {
+        QChar ch = git::Diff::statusChar(mDiff.status(i));
+        if (!status.contains(ch))
+          status.append(ch);
       }
 
       return status;
@@ -196,13 +205,8 @@ bool TreeModel::setData(
   switch (role) {
     case Qt::CheckStateRole: {
       QStringList files;
-      Node *node = this->node(index);
-      QString prefix = node->path(true);
-      for (int i = 0; i < mDiff.count(); ++i) {
-        QString file = mDiff.name(i);
-        if (file.startsWith(prefix))
-          files.append(file);
-      }
+      foreach (int i, diffIndexes(node(index)))
+        files.append(mDiff.name(i));
 
       mDiff.index().setStaged(files, value.toBool());
       emit dataChanged(index, index, {role});
@@ -223,49 +227,41 @@ TreeModel::Node *TreeModel::node(const QModelIndex &index) const
   return index.isValid() ? static_cast<Node *>(index.internalPointer()) : mRoot;
 }
 
-TreeModel::Node::Node(const QString &name, const git::Object &obj, Node *parent)
-  : mName(name), mObject(obj), mParent(parent)
-{}
-
-TreeModel::Node::~Node()
-{
-  qDeleteAll(mChildren);
-}
-
-QString TreeModel::Node::name() const
+TreeModel::Node *TreeModel::child(Node *parent, int row) const
 {
-  return mName;
-}
+  if (parent->children.isEmpty())
+    parent->children.resize(tree(parent).count());
+
+  Node *&child = parent->children[row];
+  if (!child) {
+    git::Tree tree = parent->tree;
+    mNodes.push_back({tree.name(row), tree.mode(row),
+                      parent, row, git::Tree(), false, QVector<Node *>()});
+    child = &mNodes.back();
+  }
 
-QString TreeModel::Node::path(bool relative) const
-{
-  bool root = (!mParent || (relative && !mParent->mParent));
-  return !root ? mParent->path(relative) % "/" % mName : mName;
+  return child;
 }
 
-TreeModel::Node *TreeModel::Node::parent() const
+git::Tree TreeModel::tree(Node *node) const
 {
-  return mParent;
-}
+  if (!node->loaded) {
+    node->loaded = true;
+    if (node->mode == GIT_FILEMODE_TREE)
+      node->tree = this->tree(node->parent).object(node->row);
+  }
 
-bool TreeModel::Node::hasChildren() const
-{
-  git::Tree tree = object();
-  return (tree.isValid() && tree.count() > 0);
+  return node->tree;
 }
 
-QList<TreeModel::Node *> TreeModel::Node::children()
+QString TreeModel::path(const Node *node, bool relative) const
 {
-  if (mChildren.isEmpty() && hasChildren()) {
-    git::Tree tree = object();
-    for (int i = 0; i < tree.count(); ++i)
-      mChildren.append(new Node(tree.name(i), tree.object(i), this));
-  }
-
-  return mChildren;
+  const Node *parent = node->parent;
+  bool root = (!parent || (relative && !parent->parent));
+  return !root ? path(parent, relative) % "/" % node->name : node->name;
 }
 
-git::Object TreeModel::Node::object() const
+QVector<int> TreeModel::diffIndexes(const Node *node) const
 {
-  return mObject;
+  return mDiffIndexes.value(path(node, true));
 }
@@ -16,6 +16,8 @@
 #include "git/Repository.h"
 #include <QAbstractItemModel>
 #include <QFileIconProvider>
+#include <QHash>
+#include <deque>
 
 class TreeModel : public QAbstractItemModel
 {
@@ -59,35 +61,38 @@ public:
   Qt::ItemFlags flags(const QModelIndex &index) const override;
 
 private:
-  class Node
+  // Nodes are allocated together in an arena that's cleared when the
+  // tree is reset. Each node is created the first time that its row
+  // is requested, so a huge directory only creates the visible rows.
+  struct Node
   {
-  public:
-    Node(const QString &name, const git::Object &obj, Node *parent = nullptr);
-    ~Node();
-
-    QString name() const;
-    QString path(bool relative = false) const;
-
-    Node *parent() const;
-    bool hasChildren() const;
-    QList<Node *> children();
-
-    git::Object object() const;
-
-  private:
-    QString mName;
-    git::Object mObject;
-
-    Node *mParent;
-    QList<Node *> mChildren;
+    QString name;
+    git_filemode_t mode;
+    Node *parent;
+    int row;
+
+    // Directories look up their tree on first use.
+    git::Tree tree;
+    bool loaded;
+    QVector<Node *> children;
   };
 
   Node *node(const QModelIndex &index) const;
+  Node *child(Node *parent, int row) const;
+  git::Tree tree(Node *node) const;
+  QString path(const Node *node, bool relative = false) const;
+
+  // Get the diff indexes of the files at or under the node.
+  QVector<int> diffIndexes(const Node *node) const;
 
+  mutable std::deque<Node> mNodes;
   Node *mRoot = nullptr;
   QFileIconProvider mIconProvider;
 
+  // The diff is indexed by every path that contains a changed file.
   git::Diff mDiff;
+  QHash<QString,QVector<int>> mDiffIndexes;
+
   git::Repository mRepo;
 };
 
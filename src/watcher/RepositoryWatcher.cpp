@@ -8,17 +8,113 @@
 //
 
 #include "RepositoryWatcher.h"
+#include "trace/Trace.h"
+
+namespace {
+
+// Wait for events to settle before notifying, but
+// don't let a steady stream of events starve the status.
+const int kSettleDelay = 200;
+const int kMaxDelay = 2000;
+
+// Past this point a full scan is cheaper than matching paths.
+const int kMaxPaths = 4096;
+
+} // anon. namespace
 
 void RepositoryWatcher::init(const git::Repository &repo)
 {
+  mRepo = repo;
+
   // The timer has to run on the main thread.
-  mTimer.setInterval(2000);
+  mTimer.setInterval(kSettleDelay);
   mTimer.setSingleShot(true);
-  connect(&mTimer, &QTimer::timeout,
-          repo.notifier(), &git::RepositoryNotifier::workdirChanged);
+  connect(&mTimer, &QTimer::timeout, this, &RepositoryWatcher::notify);
 }
 
 void RepositoryWatcher::cancelPendingNotification()
 {
   mTimer.stop();
+  mPaths.clear();
+  mAllPaths = false;
+}
+
+void RepositoryWatcher::setSuspended(bool suspended)
+{
+  if (mSuspended == suspended)
+    return;
+
+  mSuspended = suspended;
+  if (mSuspended) {
+    mTimer.stop();
+    return;
+  }
+
+  if (mAllPaths || !mPaths.isEmpty())
+    notify();
+}
+
+QStringList RepositoryWatcher::filterPaths(
+  const git::Repository &repo,
+  const QStringList &paths)
+{
+  Trace::Span span("watcher", "filterPaths");
+  span.setArg("paths", paths.size());
+
+  QSet<QString> seen;
+  QStringList result;
+  foreach (const QString &path, paths) {
+    if (seen.contains(path))
+      continue;
+
+    seen.insert(path);
+    if (!repo.isIgnored(path))
+      result.append(path);
+  }
+
+  return result;
+}
+
+void RepositoryWatcher::addPaths(const QStringList &paths)
+{
+  Trace::Span span("watcher", "addPaths");
+  span.setArg("paths", paths.size());
+
+  // The paths were already filtered on the watcher's thread.
+  if (!mAllPaths) {
+    foreach (const QString &path, paths)
+      mPaths.insert(path);
+  }
+
+  if (paths.isEmpty() || mPaths.size() > kMaxPaths) {
+    mPaths.clear();
+    mAllPaths = true;
+  }
+
+  if (mSuspended)
+    return;
+
+  if (!mTimer.isActive()) {
+    mPending.start();
+  } else if (mPending.elapsed() >= kMaxDelay) {
+    return;
+  }
+
+  mTimer.start();
+}
+
+void RepositoryWatcher::notify()
+{
+  Trace::Span span("watcher", "notify");
+
+  QStringList paths;
+  if (!mAllPaths)
+    paths = mPaths.values();
+
+  span.setArg("paths", mAllPaths ? -1 : paths.size());
+
+  mPaths.clear();
+  mAllPaths = false;
+
+  emit mRepo.notifier()->workdirChanged(paths);
 }
@@ -11,7 +11,9 @@
 #define REPOSITORYWATCHER_H
 
 #include "git/Repository.h"
+#include <QElapsedTimer>
 #include <QObject>
+#include <QSet>
 #include <QTimer>
 
 class RepositoryWatcherPrivate;
@@ -25,8 +27,31 @@ public:
   void init(const git::Repository &repo);
   void cancelPendingNotification();
 
+  // Hold notifications while suspended. Changes are accumulated
+  // and reported in a single notification when resumed.
+  void setSuspended(bool suspended);
+
+  // Remove duplicate and ignored paths. The platform watchers call
+  // this on their own thread before reporting paths.
+  static QStringList filterPaths(
+    const git::Repository &repo,
+    const QStringList &paths);
+
 private:
+  // Accumulate workdir relative paths reported by the platform watcher.
+  // An empty list means that the changed paths aren't known.
+  void addPaths(const QStringList &paths);
+  void notify();
+
+  git::Repository mRepo;
+
   QTimer mTimer;
+  QElapsedTimer mPending;
+
+  QSet<QString> mPaths;
+  bool mAllPaths = false;
+  bool mSuspended = false;
+
   RepositoryWatcherPrivate *d;
 };
 
@@ -8,11 +8,18 @@
 //
 
 #include "RepositoryWatcher.h"
+#include "git/Config.h"
+#include <QHash>
 #include <QMap>
 #include <QThread>
+#include <fcntl.h>
+#include <limits.h>
 #include <poll.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/fanotify.h>
 #include <sys/inotify.h>
+#include <sys/vfs.h>
 
 namespace {
 
@@ -23,13 +30,50 @@ const uint kFlags =
    IN_DELETE |
    IN_DELETE_SELF |
    IN_MODIFY |
-   IN_MOVE_SELF);
+   IN_MOVE_SELF |
+   IN_MOVED_FROM |
+   IN_MOVED_TO);
 
 // FIXME: Include hidden and filter .git explicitly?
 const QDir::Filters kFilters =
   (QDir::Dirs |
    QDir::NoDotAndDotDot);
 
+#ifdef FAN_REPORT_DFID_NAME
+const uint64_t kFanotifyFlags =
+  (FAN_ATTRIB |
+   FAN_CLOSE_WRITE |
+   FAN_CREATE |
+   FAN_DELETE |
+   FAN_DELETE_SELF |
+   FAN_MODIFY |
+   FAN_MOVED_FROM |
+   FAN_MOVED_TO |
+   FAN_ONDIR);
+
+// Directory changes that can invalidate resolved handles.
+const uint64_t kFanotifyDirFlags =
+  (FAN_DELETE |
+   FAN_DELETE_SELF |
+   FAN_MOVED_FROM |
+   FAN_MOVED_TO);
+#endif
+
+// Forget resolved directory handles past this many.
+const int kMaxHandles = 4096;
+
+// Key directory handles by type and content.
+QByteArray handleKey(const file_handle *handle)
+{
+  QByteArray key(
+    reinterpret_cast<const char *>(&handle->handle_type),
+    sizeof(handle->handle_type));
+  key.append(
+    reinterpret_cast<const char *>(handle->f_handle),
+    handle->handle_bytes);
+  return key;
+}
+
 } // anon. namespace
 
 class RepositoryWatcherPrivate : public QThread
@@ -40,11 +84,17 @@ public:
   RepositoryWatcherPrivate(
     const git::Repository &repo,
     QObject *parent = nullptr)
-    : QThread(parent), mRepo(repo)
+    : QThread(parent), mRepo(repo), mWorkdir(repo.workdir())
   {
-    mFd = inotify_init1(IN_NONBLOCK);
-    if (mFd < 0)
-      return; // FIXME: Report error?
+    // Watching the whole filesystem with fanotify avoids adding a watch
+    // for every directory, but it requires elevated privileges. Fall
+    // back to inotify if it isn't enabled or isn't available.
+    if (!repo.appConfig().value<bool>("watcher.fanotify", false) ||
+        !initFanotify()) {
+      mFd = inotify_init1(IN_NONBLOCK);
+      if (mFd < 0)
+        return; // FIXME: Report error?
+    }
 
     if (pipe(mPipe) < 0) {
       // FIXME: Report error?
@@ -58,6 +108,9 @@ public:
     close(mPipe[1]);
     close(mPipe[0]);
     close(mFd);
+
+    if (mMountFd >= 0)
+      close(mMountFd);
   }
 
   bool isValid() const { return (mFd >= 0); }
@@ -65,7 +118,8 @@ public:
   void run() override
   {
     // Watch the root directory.
-    watch(mRepo.workdir());
+    if (!mFanotify)
+      watch(mWorkdir);
 
     // Start listening for notifications.
     forever {
@@ -85,35 +139,136 @@ public:
       if (!(pollFds[1].revents & POLLIN))
         continue;
 
-      // Read notifications.
-      bool ignored = true;
-      forever {
-        char buf[4096];
-        int len = read(mFd, buf, sizeof(buf));
-        if (len <= 0)
-          break;
-
-        const inotify_event *event = nullptr;
-        for (char *ptr = buf; ptr < buf + len;
-             ptr += sizeof(inotify_event) + event->len) {
-          event = reinterpret_cast<inotify_event *>(ptr);
-          if (event->len) {
-            QString path = mWds.value(event->wd).filePath(event->name);
-            if (!mRepo.isIgnored(path)) {
-              ignored = false;
-
-              // Start watching new directories.
-              int mask = (IN_CREATE | IN_ISDIR);
-              if ((event->mask & mask) == mask)
-                watch(path);
-            }
-          }
+      // Read notifications. Duplicate and ignored
+      // paths are filtered out before reporting.
+      bool overflow = false;
+      QStringList paths =
+        mFanotify ? readFanotify(overflow) : readInotify(overflow);
+
+      if (overflow) {
+        // Some events were dropped.
+        emit notificationReceived(QStringList());
+        continue;
+      }
+
+      paths = RepositoryWatcher::filterPaths(mRepo, paths);
+      if (!paths.isEmpty())
+        emit notificationReceived(paths);
+    }
+  }
+
+  QStringList readInotify(bool &overflow)
+  {
+    QStringList paths;
+    forever {
+      alignas(inotify_event) char buf[4096];
+      int len = read(mFd, buf, sizeof(buf));
+      if (len <= 0)
+        break;
+
+      const inotify_event *event = nullptr;
+      for (char *ptr = buf; ptr < buf + len;
+           ptr += sizeof(inotify_event) + event->len) {
+        event = reinterpret_cast<inotify_event *>(ptr);
+        if (event->mask & IN_Q_OVERFLOW) {
+          overflow = true;
+          continue;
         }
+
+        if (event->mask & IN_IGNORED) {
+          mWds.remove(event->wd);
+          continue;
+        }
+
+        auto it = mWds.constFind(event->wd);
+        if (it == mWds.constEnd())
+          continue;
+
+        // Events without a name refer to the watched directory itself.
+        QString path = event->len ? it->filePath(event->name) : it->path();
+        QString rel = mWorkdir.relativeFilePath(path);
+        if (rel.isEmpty() || rel == ".")
+          continue;
+
+        paths.append(rel);
+
+        // Start watching new directories.
+        int mask = (IN_ISDIR | IN_CREATE);
+        int moved = (IN_ISDIR | IN_MOVED_TO);
+        if (((event->mask & mask) == mask ||
+             (event->mask & moved) == moved) && !mRepo.isIgnored(rel))
+          watch(path);
       }
+    }
+
+    return paths;
+  }
+
+  QStringList readFanotify(bool &overflow)
+  {
+    QStringList paths;
+#ifdef FAN_REPORT_DFID_NAME
+    forever {
+      alignas(fanotify_event_metadata) char buf[8192];
+      ssize_t len = read(mFd, buf, sizeof(buf));
+      if (len <= 0)
+        break;
+
+      const fanotify_event_metadata *event =
+        reinterpret_cast<const fanotify_event_metadata *>(buf);
+      for (; FAN_EVENT_OK(event, len); event = FAN_EVENT_NEXT(event, len)) {
+        if (event->vers != FANOTIFY_METADATA_VERSION)
+          return paths;
+
+        if (event->mask & FAN_Q_OVERFLOW) {
+          overflow = true;
+          continue;
+        }
+
+        // Resolve the parent directory handle and entry name.
+        const fanotify_event_info_fid *fid =
+          reinterpret_cast<const fanotify_event_info_fid *>(event + 1);
+        if (fid->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+          continue;
+
+        // The mark covers the whole filesystem, so most events are for
+        // directories outside of the workdir. Drop events from other
+        // filesystems and from directories that are already known to be
+        // outside, or inside the .git dir, before touching the handle.
+        if (memcmp(&fid->fsid, &mFsid, sizeof(mFsid)))
+          continue;
+
+        file_handle *handle = reinterpret_cast<file_handle *>(
+          const_cast<unsigned char *>(fid->handle));
+        const char *name = reinterpret_cast<const char *>(
+          handle->f_handle + handle->handle_bytes);
+
+        QByteArray key = handleKey(handle);
+        auto it = mDirs.constFind(key);
+        if (it == mDirs.constEnd()) {
+          QString dir = resolve(handle);
+          if (dir.isEmpty())
+            continue;
+
+          if (mDirs.size() >= kMaxHandles)
+            resetHandles();
 
-      if (!ignored)
-        emit notificationReceived();
+          it = mDirs.insert(key, prefix(dir));
+        }
+
+        if (it->isNull())
+          continue;
+
+        paths.append(*it + name);
+
+        // Renamed and removed directories may leave stale paths behind.
+        if ((event->mask & FAN_ONDIR) && (event->mask & kFanotifyDirFlags))
+          resetHandles();
+      }
     }
+#endif
+
+    return paths;
   }
 
   void watch(const QDir &dir)
@@ -128,7 +283,7 @@ public:
     // Watch subdirs.
     foreach (const QString &name, dir.entryList(kFilters)) {
       QString path = dir.filePath(name);
-      if (!mRepo.isIgnored(path))
+      if (!mRepo.isIgnored(mWorkdir.relativeFilePath(path)))
         watch(path);
     }
   }
@@ -140,12 +295,125 @@ public:
   }
 
 signals:
-  void notificationReceived();
+  void notificationReceived(const QStringList &paths);
 
 private:
+  bool initFanotify()
+  {
+#ifdef FAN_REPORT_DFID_NAME
+    int flags = (FAN_CLASS_NOTIF | FAN_NONBLOCK | FAN_REPORT_DFID_NAME);
+    int fd = fanotify_init(flags, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
+
+    QByteArray path = mWorkdir.path().toUtf8();
+    int mark = (FAN_MARK_ADD | FAN_MARK_FILESYSTEM);
+    if (fanotify_mark(fd, mark, kFanotifyFlags, AT_FDCWD, path) < 0) {
+      close(fd);
+      return false;
+    }
+
+    // Directory handles are resolved relative to this mount.
+    mMountFd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mMountFd < 0) {
+      close(fd);
+      return false;
+    }
+
+    struct statfs fs;
+    if (fstatfs(mMountFd, &fs) < 0) {
+      close(mMountFd);
+      mMountFd = -1;
+      close(fd);
+      return false;
+    }
+
+    memcpy(&mFsid, &fs.f_fsid, sizeof(mFsid));
+
+    // Known handles are filtered without resolving them.
+    mRootKey = pathKey(mWorkdir.path());
+    mGitKey = pathKey(mRepo.dir().path());
+    resetHandles();
+
+    mFd = fd;
+    mFanotify = true;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Get the handle key of the given path.
+  QByteArray pathKey(const QString &path) const
+  {
+    union {
+      file_handle handle;
+      char buf[sizeof(file_handle) + MAX_HANDLE_SZ];
+    } storage;
+
+    int mountId;
+    storage.handle.handle_bytes = MAX_HANDLE_SZ;
+    if (name_to_handle_at(
+          AT_FDCWD, path.toUtf8(), &storage.handle, &mountId, 0) < 0)
+      return QByteArray();
+
+    return handleKey(&storage.handle);
+  }
+
+  // Forget resolved handles except for the root and .git dirs.
+  void resetHandles()
+  {
+    mDirs.clear();
+    if (!mRootKey.isEmpty())
+      mDirs.insert(mRootKey, QString(""));
+    if (!mGitKey.isEmpty())
+      mDirs.insert(mGitKey, QString());
+  }
+
+  // Get the workdir relative prefix of entries in the given directory.
+  // It's null for directories outside of the workdir or in the .git dir.
+  QString prefix(const QString &dir) const
+  {
+    QString root = mWorkdir.path() + '/';
+    QString gitDir = mRepo.dir().path() + '/';
+    if (dir == mWorkdir.path())
+      return QString("");
+
+    QString path = dir + '/';
+    if (!path.startsWith(root) || path.startsWith(gitDir))
+      return QString();
+
+    return path.mid(root.length());
+  }
+
+  QString resolve(file_handle *handle) const
+  {
+    int fd = open_by_handle_at(mMountFd, handle, O_PATH | O_CLOEXEC);
+    if (fd < 0)
+      return QString(); // The directory is already gone.
+
+    char buf[PATH_MAX];
+    QByteArray link = "/proc/self/fd/" + QByteArray::number(fd);
+    ssize_t len = readlink(link, buf, sizeof(buf));
+    close(fd);
+
+    return (len > 0) ? QString::fromUtf8(buf, len) : QString();
+  }
+
   git::Repository mRepo;
+  QDir mWorkdir;
+
   int mFd = -1;
+  int mMountFd = -1;
   int mPipe[2] = {-1, -1};
+  bool mFanotify = false;
+
+  // Resolved fanotify directory handles.
+  __kernel_fsid_t mFsid;
+  QByteArray mRootKey;
+  QByteArray mGitKey;
+  QHash<QByteArray,QString> mDirs;
+
   QMap<int,QDir> mWds;
 };
 
@@ -156,7 +424,7 @@ RepositoryWatcher::RepositoryWatcher(
 {
   init(repo);
   connect(d, &RepositoryWatcherPrivate::notificationReceived,
-          &mTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+          this, &RepositoryWatcher::addPaths);
 
   if (d->isValid())
     d->start();
@@ -29,7 +29,7 @@ public:
     CFStringRef wd = repo.workdir().path().toCFString();
     CFArrayRef wds = CFArrayCreate(nullptr, (const void **) &wd, 1, nullptr);
     mStream = FSEventStreamCreate(nullptr, &notify, &context, wds,
-      kFSEventStreamEventIdSinceNow, 0, kFSEventStreamCreateFlagNone);
+      kFSEventStreamEventIdSinceNow, 0, kFSEventStreamCreateFlagFileEvents);
     CFRelease(wds);
     CFRelease(wd);
 
@@ -73,19 +73,30 @@ public:
     RepositoryWatcherPrivate *watcher =
       static_cast<RepositoryWatcherPrivate *>(clientCallBackInfo);
 
-    // Filter out ignored directories.
-    git::Repository repo = watcher->repo();
+    // Duplicate and ignored paths are filtered out before reporting.
+    QStringList changed;
+    QDir workdir = watcher->repo().workdir();
     const char **paths = static_cast<const char **>(eventPaths);
     for (int i = 0; i < numEvents; ++i) {
-      if (!repo.isIgnored(paths[i])) {
-        emit watcher->notificationReceived();
+      // Coalesced events don't tell which paths changed.
+      if (eventFlags[i] & (kFSEventStreamEventFlagMustScanSubDirs |
+                           kFSEventStreamEventFlagRootChanged)) {
+        emit watcher->notificationReceived(QStringList());
         return;
       }
+
+      QString path = workdir.relativeFilePath(QString::fromUtf8(paths[i]));
+      if (!path.isEmpty() && path != ".")
+        changed.append(path);
     }
+
+    changed = RepositoryWatcher::filterPaths(watcher->repo(), changed);
+    if (!changed.isEmpty())
+      emit watcher->notificationReceived(changed);
   }
 
 signals:
-  void notificationReceived();
+  void notificationReceived(const QStringList &paths);
 
 private:
   git::Repository mRepo;
@@ -100,7 +111,7 @@ RepositoryWatcher::RepositoryWatcher(
 {
   init(repo);
   connect(d, &RepositoryWatcherPrivate::notificationReceived,
-          &mTimer, QOverload<>::of(&QTimer::start));
+          this, &RepositoryWatcher::addPaths);
 }
 
 RepositoryWatcher::~RepositoryWatcher() {}
@@ -108,17 +108,26 @@ public:
     DWORD numBytes,
     LPOVERLAPPED overlapped)
   {
-    if (errorCode || !numBytes)
+    RepositoryWatcherPrivate *watcher =
+      static_cast<RepositoryWatcherPrivate *>(overlapped->hEvent);
+
+    // The buffer overflowed. Some events were dropped.
+    if (!errorCode && !numBytes) {
+      watcher->watch();
+      emit watcher->notificationReceived(QStringList());
+      return;
+    }
+
+    if (errorCode)
       return; // FIXME: Report error?
 
     // Copy buffer and restart.
-    RepositoryWatcherPrivate *watcher =
-      static_cast<RepositoryWatcherPrivate *>(overlapped->hEvent);
     QVector<BYTE> buffer = watcher->buffer();
     watcher->watch();
 
-    // Iterate over notifications.
-    git::Repository repo = watcher->repo();
+    // Iterate over notifications. Duplicate and ignored
+    // paths are filtered out before reporting.
+    QStringList paths;
     const BYTE *ptr = buffer.constData();
     forever {
       const FILE_NOTIFY_INFORMATION *info =
@@ -127,20 +136,22 @@ public:
       int size = info->FileNameLength / sizeof(wchar_t);
       QString native = QString::fromWCharArray(info->FileName, size);
       QString path = QDir::fromNativeSeparators(native);
-      if (!path.isEmpty() && !repo.isIgnored(path)) {
-        emit watcher->notificationReceived();
-        return;
-      }
+      if (!path.isEmpty())
+        paths.append(path);
 
       if (!info->NextEntryOffset)
-        return;
+        break;
 
       ptr += info->NextEntryOffset;
     }
+
+    paths = RepositoryWatcher::filterPaths(watcher->repo(), paths);
+    if (!paths.isEmpty())
+      emit watcher->notificationReceived(paths);
   }
 
 signals:
-  void notificationReceived();
+  void notificationReceived(const QStringList &paths);
 
 private:
   git::Repository mRepo;
@@ -157,7 +168,7 @@ RepositoryWatcher::RepositoryWatcher(
 {
   init(repo);
   connect(d, &RepositoryWatcherPrivate::notificationReceived,
-          &mTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+          this, &RepositoryWatcher::addPaths);
 
   d->start();
 }
@@ -0,0 +1,189 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "ui/AvatarCache.h"
+#include <QBuffer>
+#include <QImage>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+namespace {
+
+const int kSize = 8;
+const QString kEmail = "author@example.com";
+const QString kMissing = "missing@example.com";
+
+} // anon. namespace
+
+// A local stand-in for the avatar service. Every request gets the
+// same image except for the missing email, which fails. The connection
+// is closed after each response.
+class Server : public QTcpServer
+{
+  Q_OBJECT
+
+public:
+  Server()
+  {
+    QImage image(kSize, kSize, QImage::Format_ARGB32);
+    image.fill(Qt::red);
+
+    QBuffer buffer(&mImage);
+    buffer.open(QBuffer::WriteOnly);
+    image.save(&buffer, "PNG");
+
+    listen(QHostAddress::LocalHost);
+    connect(this, &QTcpServer::newConnection, this, &Server::accept);
+  }
+
+  int requests() const { return mRequests; }
+
+  QString url() const
+  {
+    return QString("http://127.0.0.1:%1/avatar/%2?s=%3").arg(serverPort());
+  }
+
+private:
+  void accept()
+  {
+    while (QTcpSocket *socket = nextPendingConnection()) {
+      connect(socket, &QTcpSocket::readyRead, socket, [this, socket] {
+        QByteArray request = socket->property("request").toByteArray();
+        request.append(socket->readAll());
+        socket->setProperty("request", request);
+        if (!request.contains("\r\n\r\n"))
+          return;
+
+        ++mRequests;
+        QByteArray missing = AvatarCache::key(kMissing, kSize).split('-').first();
+        if (request.contains(missing)) {
+          socket->write(
+            "HTTP/1.1 500 Internal Server Error\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: close\r\n\r\n");
+          socket->disconnectFromHost();
+          return;
+        }
+
+        socket->write(
+          "HTTP/1.1 200 OK\r\n"
+          "Content-Type: image/png\r\n"
+          "Content-Length: " + QByteArray::number(mImage.size()) + "\r\n"
+          "Connection: close\r\n\r\n" + mImage);
+        socket->disconnectFromHost();
+      });
+
+      connect(socket, &QTcpSocket::disconnected,
+              socket, &QTcpSocket::deleteLater);
+    }
+  }
+
+  QByteArray mImage;
+  int mRequests = 0;
+};
+
+class TestAvatarCache : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void coalesce();
+  void disk();
+  void expiry();
+  void prefetch();
+  void failure();
+
+private:
+  QTemporaryDir mDir;
+  Server mServer;
+};
+
+void TestAvatarCache::coalesce()
+{
+  AvatarCache cache(mDir.path());
+  cache.setUrl(mServer.url());
+  QSignalSpy spy(&cache, &AvatarCache::avatarReady);
+
+  // Both requests share the same reply.
+  QVERIFY(cache.avatar(kEmail, kSize).isNull());
+  QVERIFY(cache.avatar(kEmail, kSize).isNull());
+  QTRY_COMPARE(spy.count(), 1);
+  QCOMPARE(mServer.requests(), 1);
+  QCOMPARE(spy.first().first().toByteArray(), AvatarCache::key(kEmail, kSize));
+
+  // Served from memory.
+  QVERIFY(!cache.avatar(kEmail, kSize).isNull());
+  QCOMPARE(mServer.requests(), 1);
+}
+
+void TestAvatarCache::disk()
+{
+  // A new cache loads the image from disk.
+  AvatarCache cache(mDir.path());
+  cache.setUrl(mServer.url());
+  QVERIFY(!cache.avatar(kEmail, kSize).isNull());
+  QCOMPARE(mServer.requests(), 1);
+}
+
+void TestAvatarCache::expiry()
+{
+  // Expire the image on disk.
+  QFile file(QDir(mDir.path()).filePath(AvatarCache::key(kEmail, kSize)));
+  QVERIFY(file.open(QFile::ReadWrite));
+  QDateTime time = QDateTime::currentDateTime().addDays(-30);
+  QVERIFY(file.setFileTime(time, QFileDevice::FileModificationTime));
+  file.close();
+
+  // The expired image is shown while it's refreshed.
+  AvatarCache cache(mDir.path());
+  cache.setUrl(mServer.url());
+  QSignalSpy spy(&cache, &AvatarCache::avatarReady);
+  QVERIFY(!cache.avatar(kEmail, kSize).isNull());
+  QTRY_COMPARE(spy.count(), 1);
+  QCOMPARE(mServer.requests(), 2);
+}
+
+void TestAvatarCache::prefetch()
+{
+  AvatarCache cache(mDir.path());
+  cache.setUrl(mServer.url());
+  QSignalSpy spy(&cache, &AvatarCache::avatarReady);
+
+  // Only uncached authors are requested. Duplicates are skipped.
+  QStringList emails = {"a@example.com", kEmail, "b@example.com", "a@example.com"};
+  cache.prefetch(emails, kSize);
+  QTRY_COMPARE(spy.count(), 2);
+  QCOMPARE(mServer.requests(), 4);
+
+  foreach (const QString &email, emails)
+    QVERIFY(!cache.avatar(email, kSize).isNull());
+}
+
+void TestAvatarCache::failure()
+{
+  AvatarCache cache(mDir.path());
+  cache.setUrl(mServer.url());
+  int requests = mServer.requests();
+
+  // Wait for the request to fail.
+  QVERIFY(cache.avatar(kMissing, kSize).isNull());
+  QTRY_COMPARE(mServer.requests(), requests + 1);
+  QTest::qWait(500);
+
+  // The failure isn't requested again right away.
+  QVERIFY(cache.avatar(kMissing, kSize).isNull());
+  cache.prefetch({kMissing}, kSize);
+  QTest::qWait(100);
+  QCOMPARE(mServer.requests(), requests + 1);
+}
+
+TEST_MAIN(TestAvatarCache)
+
+#include "avatar_cache.moc"
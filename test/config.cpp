@@ -19,6 +19,10 @@ class TestConfig : public QObject
 
 private slots:
   void mergetools();
+  void appConfig();
+
+private:
+  Test::ScratchRepository mRepo;
 };
 
 void TestConfig::mergetools()
@@ -40,6 +44,56 @@ void TestConfig::mergetools()
   QVERIFY(names.contains("difftool.araxis.cmd"));
 }
 
+void TestConfig::appConfig()
+{
+  QSignalSpy spy(mRepo->notifier(), &git::RepositoryNotifier::appConfigChanged);
+
+  // Writes are visible to the next read. They aren't reported
+  // as changes made outside of the app.
+  git::Config config = mRepo->appConfig();
+  config.setValue("test.value", 1);
+  QCOMPARE(config.value<int>("test.value"), 1);
+  QCOMPARE(mRepo->appConfig().value<int>("test.value"), 1);
+  QCoreApplication::processEvents();
+  QVERIFY(spy.isEmpty());
+
+  // Rewrite the file behind the config's back. The size is the
+  // same, so give the file a different modification time.
+  git::Config copy = mRepo->appConfig();
+  QFile file(mRepo->appDir().filePath("config"));
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write("[test]\n\tvalue = 2\n");
+  file.flush();
+  QDateTime time = QDateTime::currentDateTime().addSecs(60);
+  QVERIFY(file.setFileTime(time, QFileDevice::FileModificationTime));
+  file.close();
+
+  // The change is picked up by the check after the interval.
+  QTRY_COMPARE(mRepo->appConfig().value<int>("test.value"), 2);
+  QTRY_COMPARE(spy.count(), 1);
+
+  // Copies that were made before the change don't keep reading
+  // the old snapshot.
+  QCOMPARE(copy.value<int>("test.value"), 2);
+
+  mRepo->appConfig().remove("test.value");
+  QCOMPARE(mRepo->appConfig().value<int>("test.value", 3), 3);
+
+  // Writes to other files don't hide changes made outside of the app.
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write("[test]\n\tvalue = 4\n");
+  file.flush();
+  QVERIFY(file.setFileTime(time.addSecs(60), QFileDevice::FileModificationTime));
+  file.close();
+
+  git::Config other = git::Config::open(mRepo->dir().filePath("other"));
+  other.setValue("test.value", 5);
+  QTRY_COMPARE(mRepo->appConfig().value<int>("test.value"), 4);
+  QTRY_COMPARE(spy.count(), 2);
+
+  mRepo->appConfig().remove("test.value");
+}
+
 TEST_MAIN(TestConfig)
 
 #include "config.moc"
@@ -0,0 +1,157 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "git/Branch.h"
+#include "git/Commit.h"
+#include "git/Index.h"
+
+using namespace Test;
+
+namespace {
+
+// More pairs than the prediction cache holds.
+const int kCommitCount = 17;
+const int kCacheSize = 256;
+const int kBatchSize = 8;
+
+} // anon. namespace
+
+class TestConflicts : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void predict();
+  void evict();
+
+private:
+  using Pair = QPair<git::Commit,git::Commit>;
+
+  void write(const QString &name, const QByteArray &content);
+  git::Commit commit(const QString &name, const QByteArray &content);
+  void switchTo(const QString &name);
+  bool predicted(const QList<Pair> &pairs);
+
+  ScratchRepository mRepo;
+};
+
+void TestConflicts::write(const QString &name, const QByteArray &content)
+{
+  QFile file(mRepo->workdir().filePath(name));
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write(content);
+}
+
+git::Commit TestConflicts::commit(
+  const QString &name,
+  const QByteArray &content)
+{
+  write(name, content);
+  mRepo->index().setStaged({name}, true);
+  return mRepo->commit(name);
+}
+
+void TestConflicts::switchTo(const QString &name)
+{
+  git::Branch branch = mRepo->lookupBranch(name, GIT_BRANCH_LOCAL);
+  QVERIFY(mRepo->checkout(branch.target(), nullptr, {}, GIT_CHECKOUT_FORCE));
+  QVERIFY(mRepo->setHead(branch));
+}
+
+bool TestConflicts::predicted(const QList<Pair> &pairs)
+{
+  bool result = true;
+  foreach (const Pair &pair, pairs) {
+    if (!mRepo->predictConflicts(pair.first, pair.second))
+      result = false;
+  }
+
+  return result;
+}
+
+void TestConflicts::initTestCase()
+{
+  QVERIFY(commit("a.txt", "a\n").isValid());
+  QVERIFY(mRepo->createBranch("upstream", mRepo->head().target()).isValid());
+
+  // Change the same file on each branch.
+  switchTo("upstream");
+  QVERIFY(commit("a.txt", "upstream\n").isValid());
+  switchTo("master");
+  QVERIFY(commit("a.txt", "master\n").isValid());
+}
+
+void TestConflicts::predict()
+{
+  git::Commit head = mRepo->head().target();
+  git::Branch upstream = mRepo->lookupBranch("upstream", GIT_BRANCH_LOCAL);
+  git::RepositoryNotifier *notifier = mRepo->notifier();
+  QSignalSpy spy(notifier, &git::RepositoryNotifier::conflictsPredicted);
+
+  // The first prediction is made in the background.
+  QStringList paths;
+  QVERIFY(!mRepo->predictConflicts(head, upstream.target(), &paths));
+  QTRY_COMPARE(spy.count(), 1);
+  QVERIFY(mRepo->predictConflicts(head, upstream.target(), &paths));
+  QCOMPARE(paths, QStringList("a.txt"));
+
+  // Merging an ancestor is clean.
+  git::Commit base = mRepo->mergeBase(head, upstream.target());
+  QVERIFY(!mRepo->predictConflicts(head, base));
+  QTRY_COMPARE(spy.count(), 2);
+  QVERIFY(mRepo->predictConflicts(head, base, &paths));
+  QVERIFY(paths.isEmpty());
+
+  // Nothing was written to the working directory or index.
+  QCOMPARE(mRepo->state(), static_cast<int>(GIT_REPOSITORY_STATE_NONE));
+  QVERIFY(!mRepo->index().hasConflicts());
+  QVERIFY(!mRepo->status(mRepo->index(), nullptr).isValid());
+}
+
+void TestConflicts::evict()
+{
+  QList<git::Commit> commits;
+  for (int i = 0; i < kCommitCount; ++i) {
+    git::Commit commit = this->commit(QString("file%1.txt").arg(i), "x\n");
+    QVERIFY(commit.isValid());
+    commits.append(commit);
+  }
+
+  QList<Pair> pairs;
+  for (int i = 0; i < kCommitCount; ++i) {
+    for (int j = 0; j < kCommitCount; ++j) {
+      if (i != j)
+        pairs.append(Pair(commits.at(i), commits.at(j)));
+    }
+  }
+
+  // Add one more prediction than the cache holds. The first is used
+  // after each batch, so the second is the least recently used of the
+  // new predictions when the last one is added.
+  QList<Pair> first = {pairs.at(0)};
+  QList<Pair> second = {pairs.at(1)};
+  QTRY_VERIFY(predicted(first));
+  QTRY_VERIFY(predicted(second));
+
+  int count = kCacheSize + 1 - 2;
+  for (int i = 0; i < count; i += kBatchSize) {
+    QList<Pair> batch = pairs.mid(i + 2, qMin(kBatchSize, count - i));
+    QTRY_VERIFY(predicted(batch));
+    QVERIFY(predicted(first));
+  }
+
+  QVERIFY(predicted(first));
+  QVERIFY(!predicted(second));
+}
+
+TEST_MAIN(TestConflicts)
+
+#include "conflicts.moc"
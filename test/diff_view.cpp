@@ -0,0 +1,130 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "editor/TextEditor.h"
+#include "git/Index.h"
+#include "git/Patch.h"
+#include "ui/DiffView.h"
+#include "ui/MainWindow.h"
+#include "ui/RepoView.h"
+
+using namespace Test;
+using namespace QTest;
+
+namespace {
+
+const char *kNeedle = "needle";
+
+} // anon. namespace
+
+class TestDiffView : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void findAll();
+  void cleanupTestCase();
+
+private:
+  void write(const QString &name, const QByteArray &content);
+
+  ScratchRepository mRepo;
+  MainWindow *mWindow = nullptr;
+};
+
+void TestDiffView::write(const QString &name, const QByteArray &content)
+{
+  QFile file(mRepo->workdir().filePath(name));
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write(content);
+}
+
+void TestDiffView::initTestCase()
+{
+  // Commit a file with two regions that are far enough apart
+  // to be in separate hunks.
+  QByteArray content;
+  for (int i = 0; i < 40; ++i)
+    content += "line " + QByteArray::number(i) + '\n';
+  write("a.txt", content);
+  mRepo->index().setStaged({"a.txt"}, true);
+  QVERIFY(mRepo->commit("initial").isValid());
+
+  mWindow = new MainWindow(mRepo);
+  mWindow->show();
+  QVERIFY(qWaitForWindowActive(mWindow));
+}
+
+void TestDiffView::findAll()
+{
+  // Change only the second region of the tracked file.
+  QByteArray content;
+  for (int i = 0; i < 40; ++i)
+    content += (i == 3) ? "changed\n" : (i == 35) ? "needle\n" :
+                          "line " + QByteArray::number(i) + '\n';
+  write("a.txt", content);
+
+  // The untracked file has two matches. The other one is shown as
+  // binary because of its end, so it isn't searched either.
+  write("b.txt", "needle\nneedle\n");
+  QByteArray text(4096, 'x');
+  write("c.bin", kNeedle + text + QByteArray(16, '\0'));
+
+  // Let the view settle before searching a diff in a known order.
+  RepoView *repoView = mWindow->currentView();
+  refresh(repoView);
+
+  git::Diff diff = mRepo->status(mRepo->index(), nullptr);
+  QCOMPARE(diff.count(), 3);
+
+  DiffView *view = repoView->findChild<DiffView *>();
+  QVERIFY(view);
+  view->setDiff(diff);
+
+  // The view keeps generating patches from the same diff while the
+  // search runs.
+  QFuture<QList<EditorProvider::Hits>> future = view->findAll(kNeedle);
+  for (int i = 0; i < diff.count(); ++i)
+    QVERIFY(diff.patch(i).isValid());
+
+  future.waitForFinished();
+  QList<EditorProvider::Hits> hits = future.result();
+  QCOMPARE(hits.size(), 2);
+
+  QCOMPARE(hits.at(0).file, diff.indexOf("a.txt"));
+  QCOMPARE(hits.at(0).hunk, 1);
+  QCOMPARE(hits.at(0).count, 1);
+  QCOMPARE(hits.at(1).file, diff.indexOf("b.txt"));
+  QCOMPARE(hits.at(1).hunk, -1);
+  QCOMPARE(hits.at(1).count, 2);
+
+  // Hits map to the editor of the matching hunk.
+  TextEditor *editor = view->editor(hits.at(0));
+  QVERIFY(editor);
+  QVERIFY(editor->text().contains(kNeedle));
+  QVERIFY(!editor->text().contains("changed"));
+
+  editor = view->editor(hits.at(1));
+  QVERIFY(editor);
+  QCOMPARE(editor->text().count(kNeedle), 2);
+
+  // Hunks that don't exist don't map to another hunk.
+  QVERIFY(!view->editor({hits.at(0).file, 2, 1}));
+}
+
+void TestDiffView::cleanupTestCase()
+{
+  mWindow->close();
+}
+
+TEST_MAIN(TestDiffView)
+
+#include "diff_view.moc"
@@ -0,0 +1,392 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "git/FilterProcess.h"
+#include <QMap>
+#include <cstdio>
+#include <cstring>
+
+using namespace Test;
+
+namespace {
+
+const char *kServerArg = "--filter-server";
+
+// A stand-in filter that speaks the server side of the protocol on
+// stdin/stdout. Clean converts to lower case and smudge converts to
+// upper case. Paths that contain 'error' or 'abort' report that status.
+// Paths that contain 'delay' are delayed when the client allows it.
+// The mode selects which capabilities are advertised ('all' or one of
+// the commands) or breaks the handshake ('bad').
+class Server
+{
+public:
+  Server(const QByteArray &mode)
+    : mMode(mode)
+  {
+    mIn.open(stdin, QIODevice::ReadOnly | QIODevice::Unbuffered);
+    mOut.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+  }
+
+  int exec()
+  {
+    QList<QByteArray> lines;
+    if (!readList(lines) || lines.value(0) != "git-filter-client")
+      return 1;
+
+    if (mMode == "bad") {
+      writeText("not-a-filter");
+      writeFlush();
+      return 1;
+    }
+
+    writeText("git-filter-server");
+    writeText("version=2");
+    writeFlush();
+
+    if (!readList(lines))
+      return 1;
+
+    foreach (const QByteArray &line, lines) {
+      QByteArray cap = line.mid(11);
+      if (mMode == "all" || mMode == cap)
+        writeText(line);
+    }
+
+    writeFlush();
+
+    QMap<QByteArray,QByteArray> headers;
+    while (readHeaders(headers)) {
+      QByteArray cmd = headers.value("command");
+      QByteArray path = headers.value("pathname");
+      if (cmd == "list_available_blobs") {
+        foreach (const QByteArray &delayed, mDelayed.keys())
+          writeText("pathname=" + delayed);
+        writeFlush();
+        writeText("status=success");
+        writeFlush();
+        mAvailable = mDelayed;
+        mDelayed.clear();
+        continue;
+      }
+
+      QByteArray content;
+      if (!readContent(content))
+        return 1;
+
+      if (mAvailable.contains(path))
+        content = mAvailable.take(path);
+
+      if (path.contains("error") || path.contains("abort")) {
+        writeText(path.contains("error") ? "status=error" : "status=abort");
+        writeFlush();
+        continue;
+      }
+
+      if (path.contains("delay") && headers.value("can-delay") == "1") {
+        mDelayed.insert(path, content);
+        writeText("status=delayed");
+        writeFlush();
+        continue;
+      }
+
+      writeText("status=success");
+      writeFlush();
+      writeContent((cmd == "smudge") ? content.toUpper() : content.toLower());
+      writeFlush();
+    }
+
+    return 0;
+  }
+
+private:
+  bool read(int size, QByteArray &data)
+  {
+    data.clear();
+    while (data.length() < size) {
+      QByteArray chunk = mIn.read(size - data.length());
+      if (chunk.isEmpty())
+        return false;
+      data.append(chunk);
+    }
+
+    return true;
+  }
+
+  bool readPacket(QByteArray &data)
+  {
+    QByteArray header;
+    if (!read(4, header))
+      return false;
+
+    int size = header.toInt(nullptr, 16);
+    if (size == 0) {
+      data = QByteArray();
+      return true;
+    }
+
+    return read(size - 4, data);
+  }
+
+  bool readList(QList<QByteArray> &lines)
+  {
+    lines.clear();
+    forever {
+      QByteArray data;
+      if (!readPacket(data))
+        return false;
+
+      if (data.isNull())
+        return true;
+
+      lines.append(data.endsWith('\n') ? data.left(data.length() - 1) : data);
+    }
+  }
+
+  bool readHeaders(QMap<QByteArray,QByteArray> &headers)
+  {
+    QList<QByteArray> lines;
+    if (!readList(lines))
+      return false;
+
+    headers.clear();
+    foreach (const QByteArray &line, lines) {
+      int index = line.indexOf('=');
+      headers.insert(line.left(index), line.mid(index + 1));
+    }
+
+    return true;
+  }
+
+  bool readContent(QByteArray &content)
+  {
+    content.clear();
+    forever {
+      QByteArray data;
+      if (!readPacket(data))
+        return false;
+
+      if (data.isNull())
+        return true;
+
+      content.append(data);
+    }
+  }
+
+  void writePacket(const QByteArray &data)
+  {
+    QByteArray size = QByteArray::number(data.length() + 4, 16);
+    mOut.write(size.rightJustified(4, '0'));
+    mOut.write(data);
+  }
+
+  void writeText(const QByteArray &text)
+  {
+    writePacket(text + '\n');
+  }
+
+  void writeContent(const QByteArray &content)
+  {
+    for (int pos = 0; pos < content.length(); pos += 65516)
+      writePacket(content.mid(pos, 65516));
+    writeFlush();
+  }
+
+  void writeFlush()
+  {
+    mOut.write("0000");
+    mOut.flush();
+  }
+
+  QFile mIn;
+  QFile mOut;
+  QByteArray mMode;
+  QMap<QByteArray,QByteArray> mDelayed;
+  QMap<QByteArray,QByteArray> mAvailable;
+};
+
+} // anon. namespace
+
+class TestFilterProcess : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void handshake();
+  void capabilities();
+  void apply();
+  void status();
+  void delay();
+  void smudge();
+  void lfs();
+
+private:
+  git::FilterProcess *start(const QString &mode = "all");
+
+  QTemporaryDir mDir;
+};
+
+git::FilterProcess *TestFilterProcess::start(const QString &mode)
+{
+  QString program = QCoreApplication::applicationFilePath();
+  return new git::FilterProcess(program, {kServerArg, mode}, mDir.path());
+}
+
+void TestFilterProcess::handshake()
+{
+  QScopedPointer<git::FilterProcess> process(start());
+  QVERIFY(process->isValid());
+
+  // A process that doesn't speak the protocol is invalid.
+  QScopedPointer<git::FilterProcess> bad(start("bad"));
+  QVERIFY(!bad->isValid());
+}
+
+void TestFilterProcess::capabilities()
+{
+  QScopedPointer<git::FilterProcess> all(start());
+  QVERIFY(all->supports(GIT_FILTER_CLEAN));
+  QVERIFY(all->supports(GIT_FILTER_SMUDGE));
+
+  QScopedPointer<git::FilterProcess> smudge(start("smudge"));
+  QVERIFY(smudge->isValid());
+  QVERIFY(!smudge->supports(GIT_FILTER_CLEAN));
+  QVERIFY(smudge->supports(GIT_FILTER_SMUDGE));
+}
+
+void TestFilterProcess::apply()
+{
+  QScopedPointer<git::FilterProcess> process(start());
+
+  QByteArray result;
+  QByteArray input = "Mixed Case\n";
+  QCOMPARE(process->apply(GIT_FILTER_CLEAN, "a.txt",
+    input.constData(), input.length(), result), git::FilterProcess::Success);
+  QCOMPARE(result, QByteArray("mixed case\n"));
+
+  QCOMPARE(process->apply(GIT_FILTER_SMUDGE, "a.txt",
+    input.constData(), input.length(), result), git::FilterProcess::Success);
+  QCOMPARE(result, QByteArray("MIXED CASE\n"));
+
+  // Content larger than one packet is split and joined again.
+  QByteArray large(200000, 'a');
+  QCOMPARE(process->apply(GIT_FILTER_SMUDGE, "large.txt",
+    large.constData(), large.length(), result), git::FilterProcess::Success);
+  QCOMPARE(result, QByteArray(200000, 'A'));
+
+  // Empty content is still content.
+  QCOMPARE(process->apply(GIT_FILTER_CLEAN, "empty.txt",
+    nullptr, 0, result), git::FilterProcess::Success);
+  QVERIFY(!result.isNull());
+  QVERIFY(result.isEmpty());
+}
+
+void TestFilterProcess::status()
+{
+  QScopedPointer<git::FilterProcess> process(start());
+
+  QByteArray result;
+  QByteArray input = "content";
+  QCOMPARE(process->apply(GIT_FILTER_SMUDGE, "error.txt",
+    input.constData(), input.length(), result), git::FilterProcess::Error);
+  QVERIFY(result.isEmpty());
+
+  // The process is still usable after an error.
+  QVERIFY(process->supports(GIT_FILTER_SMUDGE));
+  QCOMPARE(process->apply(GIT_FILTER_SMUDGE, "a.txt",
+    input.constData(), input.length(), result), git::FilterProcess::Success);
+  QCOMPARE(result, QByteArray("CONTENT"));
+
+  // Abort disables the command for the rest of the process.
+  QCOMPARE(process->apply(GIT_FILTER_SMUDGE, "abort.txt",
+    input.constData(), input.length(), result), git::FilterProcess::Abort);
+  QVERIFY(!process->supports(GIT_FILTER_SMUDGE));
+  QVERIFY(process->supports(GIT_FILTER_CLEAN));
+}
+
+void TestFilterProcess::delay()
+{
+  QScopedPointer<git::FilterProcess> process(start());
+
+  // Delayed content is waited for.
+  QByteArray result;
+  QByteArray input = "delayed";
+  QCOMPARE(process->apply(GIT_FILTER_SMUDGE, "delay.txt",
+    input.constData(), input.length(), result), git::FilterProcess::Success);
+  QCOMPARE(result, QByteArray("DELAYED"));
+
+  // Clean is never delayed.
+  QCOMPARE(process->apply(GIT_FILTER_CLEAN, "delay.txt",
+    input.constData(), input.length(), result), git::FilterProcess::Success);
+  QCOMPARE(result, QByteArray("delayed"));
+}
+
+void TestFilterProcess::smudge()
+{
+  QScopedPointer<git::FilterProcess> process(start());
+
+  QList<git::FilterProcess::File> files = {
+    {"a.txt", "a", QByteArray()},
+    {"delay1.txt", "b", QByteArray()},
+    {"error.txt", "c", QByteArray()},
+    {"delay2.txt", "d", QByteArray()},
+    {"e.txt", "e", QByteArray()}
+  };
+
+  QVERIFY(process->smudge(files));
+  QCOMPARE(files.at(0).output, QByteArray("A"));
+  QCOMPARE(files.at(1).output, QByteArray("B"));
+  QVERIFY(files.at(2).output.isNull());
+  QCOMPARE(files.at(3).output, QByteArray("D"));
+  QCOMPARE(files.at(4).output, QByteArray("E"));
+}
+
+void TestFilterProcess::lfs()
+{
+#ifdef Q_OS_WIN
+  QSKIP("The stand-in git-lfs is a shell script.");
+#endif
+
+  // Put a stand-in git-lfs on the path.
+  QFile script(mDir.filePath("git-lfs"));
+  QVERIFY(script.open(QFile::WriteOnly));
+  QString program = QCoreApplication::applicationFilePath();
+  script.write(QString("#!/bin/sh\nexec \"%1\" %2 all\n")
+    .arg(program, kServerArg).toUtf8());
+  script.close();
+  script.setPermissions(script.permissions() | QFile::ExeOwner);
+
+  QByteArray path = qgetenv("PATH");
+  qputenv("PATH", mDir.path().toUtf8() + ':' + path);
+
+  // Objects aren't in local storage, so they're smudged in one batch.
+  // Delayed objects are collected after every request has been sent.
+  ScratchRepository repo;
+  QList<QByteArray> pointers = {"first", "second", "third", "first"};
+  QStringList files = {"a.png", "delay.png", "b.png", "c.png"};
+  QList<QByteArray> objects = repo->lfsSmudge(pointers, files);
+  qputenv("PATH", path);
+
+  QCOMPARE(objects, QList<QByteArray>({"FIRST", "SECOND", "THIRD", "FIRST"}));
+}
+
+int main(int argc, char *argv[])
+{
+  // Run as the stand-in filter.
+  if (argc > 2 && !strcmp(argv[1], kServerArg))
+    return Server(argv[2]).exec();
+
+  Application app(argc, argv);
+  TestFilterProcess test;
+  QTEST_SET_MAIN_SOURCE_PATH
+  return QTest::qExec(&test, app.arguments());
+}
+
+#include "filter_process.moc"
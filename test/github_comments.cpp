@@ -0,0 +1,323 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "host/GitHub.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+namespace {
+
+const QString kA = "1111111111111111111111111111111111111111";
+const QString kB = "2222222222222222222222222222222222222222";
+const QString kC = "3333333333333333333333333333333333333333";
+
+const QRegularExpression kObjectRe(
+  "(?:c(\\d+): )?object\\(oid: \"(\\w+)\"\\)\\s*\\{\\s*\\.\\.\\. on Commit\\s*"
+  "\\{\\s*comments\\((first|last): (\\d+)(?:, after: \"(\\d+)\")?\\)");
+
+} // anon. namespace
+
+// A local stand-in for the GraphQL endpoint. Each commit has a
+// number of generated comments. Edited comments have a later update
+// time and a different body. The connection is closed after each
+// response.
+class Server : public QTcpServer
+{
+  Q_OBJECT
+
+public:
+  Server()
+  {
+    listen(QHostAddress::LocalHost);
+    connect(this, &QTcpServer::newConnection, this, &Server::accept);
+  }
+
+  int requests() const { return mRequests; }
+
+  void setCount(const QString &oid, int count) { mCounts[oid] = count; }
+  void edit(const QString &oid, int i) { mEdits[oid].insert(i); }
+
+  void reset()
+  {
+    mCounts.clear();
+    mEdits.clear();
+    mRequests = 0;
+  }
+
+  QString url() const
+  {
+    return QString("http://127.0.0.1:%1/api/v3").arg(serverPort());
+  }
+
+private:
+  void accept()
+  {
+    while (QTcpSocket *socket = nextPendingConnection()) {
+      connect(socket, &QTcpSocket::readyRead, socket, [this, socket] {
+        QByteArray request = socket->property("request").toByteArray();
+        request.append(socket->readAll());
+        socket->setProperty("request", request);
+
+        int end = request.indexOf("\r\n\r\n");
+        if (end < 0)
+          return;
+
+        QRegularExpression re("Content-Length: (\\d+)",
+                              QRegularExpression::CaseInsensitiveOption);
+        int length = re.match(request).captured(1).toInt();
+        QByteArray body = request.mid(end + 4);
+        if (body.size() < length)
+          return;
+
+        ++mRequests;
+        QJsonObject obj = QJsonDocument::fromJson(body).object();
+        QByteArray response = QJsonDocument(
+          respond(obj.value("query").toString())).toJson();
+        socket->write(
+          "HTTP/1.1 200 OK\r\n"
+          "Content-Type: application/json\r\n"
+          "Content-Length: " + QByteArray::number(response.size()) + "\r\n"
+          "Connection: close\r\n\r\n" + response);
+        socket->disconnectFromHost();
+      });
+
+      connect(socket, &QTcpSocket::disconnected,
+              socket, &QTcpSocket::deleteLater);
+    }
+  }
+
+  QJsonObject respond(const QString &query)
+  {
+    QJsonObject repository;
+    QRegularExpressionMatchIterator it = kObjectRe.globalMatch(query);
+    while (it.hasNext()) {
+      QRegularExpressionMatch match = it.next();
+      QString alias = match.captured(1);
+      QString oid = match.captured(2);
+      bool last = (match.captured(3) == "last");
+      int limit = match.captured(4).toInt();
+      int after = match.captured(5).isEmpty() ? 0 : match.captured(5).toInt();
+
+      int count = mCounts.value(oid);
+      int first = last ? qMax(0, count - limit) : after;
+      int end = last ? count : qMin(count, after + limit);
+
+      QJsonArray nodes;
+      for (int i = first; i < end; ++i)
+        nodes.append(comment(i, mEdits.value(oid).contains(i)));
+
+      QJsonObject comments = {
+        {"totalCount", count},
+        {"nodes", nodes}
+      };
+
+      if (!last) {
+        comments.insert("pageInfo", QJsonObject({
+          {"hasNextPage", end < count},
+          {"endCursor", QString::number(end)}
+        }));
+      }
+
+      QString key = alias.isEmpty() ? "object" : QString("c%1").arg(alias);
+      repository.insert(key, QJsonObject({{"comments", comments}}));
+    }
+
+    return {{"data", QJsonObject({{"repository", repository}})}};
+  }
+
+  static QJsonObject comment(int i, bool edited)
+  {
+    QDateTime base(QDate(2017, 1, 1), QTime(0, 0), Qt::UTC);
+    QString date = base.addSecs(i).toString(Qt::ISODate);
+    QString updated = base.addDays(edited ? 1 : 0).addSecs(i)
+                      .toString(Qt::ISODate);
+    QString body = QString(edited ? "edited %1" : "comment %1").arg(i);
+    return {
+      {"path", QString()},
+      {"position", 0},
+      {"publishedAt", date},
+      {"updatedAt", updated},
+      {"body", body},
+      {"author", QJsonObject({{"login", "author"}})}
+    };
+  }
+
+  QMap<QString,int> mCounts;
+  QMap<QString,QSet<int>> mEdits;
+  int mRequests = 0;
+};
+
+// Skip authorization and record comment counts.
+class Host : public GitHub
+{
+public:
+  Host(const QString &url)
+    : GitHub("username")
+  {
+    setUrl(url);
+    mAccessToken = "token";
+    mRepo = addRepository("repo", "owner/repo");
+
+    QObject::connect(this, &Account::commentsReady, [this](
+      Repository *repo,
+      const QString &oid,
+      const CommitComments &comments)
+    {
+      mCounts.append(qMakePair(oid, comments.comments.size()));
+      mBodies.clear();
+      foreach (const Comment &comment, comments.comments)
+        mBodies.append(comment.body);
+    });
+  }
+
+  void request(const QStringList &oids) { requestComments(mRepo, oids); }
+
+  QList<QPair<QString,int>> counts() const { return mCounts; }
+
+  // The comment bodies of the last commit.
+  QStringList bodies() const { return mBodies; }
+
+private:
+  Repository *mRepo;
+  QList<QPair<QString,int>> mCounts;
+  QStringList mBodies;
+};
+
+class TestGitHubComments : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void init();
+  void batch();
+  void memory();
+  void disk();
+  void changed();
+  void edited();
+
+private:
+  // Fetch comments into the disk cache with a separate host.
+  void fill(const QStringList &oids);
+
+  Server mServer;
+};
+
+void TestGitHubComments::initTestCase()
+{
+  QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestGitHubComments::init()
+{
+  // Start every test without cached comments.
+  mServer.reset();
+  QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+  QVERIFY(QDir(dir.filePath("comments")).removeRecursively());
+}
+
+void TestGitHubComments::fill(const QStringList &oids)
+{
+  Host host(mServer.url());
+  host.request(oids);
+  QTRY_COMPARE(host.counts().size(), oids.size());
+}
+
+void TestGitHubComments::batch()
+{
+  mServer.setCount(kB, 2);
+  mServer.setCount(kC, 150);
+
+  // One query for the batch and one for the second page of C.
+  Host host(mServer.url());
+  host.request({kA, kB, kC});
+  host.request({kC});
+  QTRY_COMPARE(host.counts().size(), 3);
+  QCOMPARE(mServer.requests(), 2);
+
+  QMap<QString,int> counts;
+  foreach (const auto &pair, host.counts())
+    counts.insert(pair.first, pair.second);
+
+  QCOMPARE(counts.value(kA, -1), 0);
+  QCOMPARE(counts.value(kB), 2);
+  QCOMPARE(counts.value(kC), 150);
+}
+
+void TestGitHubComments::memory()
+{
+  mServer.setCount(kB, 2);
+
+  Host host(mServer.url());
+  host.request({kB});
+  QTRY_COMPARE(host.counts().size(), 1);
+  QCOMPARE(mServer.requests(), 1);
+
+  // Recently checked comments don't make a request.
+  host.request({kB});
+  QCOMPARE(host.counts().size(), 2);
+  QCOMPARE(host.counts().last().second, 2);
+  QCOMPARE(mServer.requests(), 1);
+}
+
+void TestGitHubComments::disk()
+{
+  mServer.setCount(kB, 2);
+  mServer.setCount(kC, 150);
+  fill({kB, kC});
+  int requests = mServer.requests();
+
+  // Cached comments are validated without fetching every page.
+  Host host(mServer.url());
+  host.request({kB, kC});
+  QTRY_COMPARE(host.counts().size(), 2);
+  QCOMPARE(mServer.requests(), requests + 1);
+  QCOMPARE(host.counts().at(0), qMakePair(kB, 2));
+  QCOMPARE(host.counts().at(1), qMakePair(kC, 150));
+}
+
+void TestGitHubComments::changed()
+{
+  mServer.setCount(kB, 2);
+  fill({kB});
+  int requests = mServer.requests();
+  mServer.setCount(kB, 3);
+
+  // The count doesn't match, so everything is requested again.
+  Host host(mServer.url());
+  host.request({kB});
+  QTRY_COMPARE(host.counts().size(), 1);
+  QCOMPARE(mServer.requests(), requests + 2);
+  QCOMPARE(host.counts().first(), qMakePair(kB, 3));
+}
+
+void TestGitHubComments::edited()
+{
+  mServer.setCount(kB, 3);
+  fill({kB});
+  int requests = mServer.requests();
+
+  // Editing an earlier comment changes the latest update time.
+  mServer.edit(kB, 0);
+  Host host(mServer.url());
+  host.request({kB});
+  QTRY_COMPARE(host.counts().size(), 1);
+  QCOMPARE(mServer.requests(), requests + 2);
+  QVERIFY(host.bodies().contains("edited 0"));
+}
+
+TEST_MAIN(TestGitHubComments)
+
+#include "github_comments.moc"
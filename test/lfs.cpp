@@ -0,0 +1,112 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include <QCryptographicHash>
+
+using namespace Test;
+
+namespace {
+
+const QByteArray kContent = "binary content";
+
+} // anon. namespace
+
+class TestLfs : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void pointer();
+  void object();
+  void tracked();
+
+private:
+  void write(const QString &path, const QByteArray &content);
+
+  QByteArray mOid;
+  QByteArray mPointer;
+  ScratchRepository mRepo;
+};
+
+void TestLfs::write(const QString &path, const QByteArray &content)
+{
+  QDir().mkpath(QFileInfo(path).path());
+
+  QFile file(path);
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write(content);
+}
+
+void TestLfs::initTestCase()
+{
+  mOid = QCryptographicHash::hash(kContent, QCryptographicHash::Sha256).toHex();
+  mPointer =
+    "version https://git-lfs.github.com/spec/v1\n"
+    "oid sha256:" + mOid + "\n"
+    "size " + QByteArray::number(kContent.length()) + "\n";
+}
+
+void TestLfs::pointer()
+{
+  QByteArray oid;
+  qint64 size = 0;
+  QVERIFY(git::Repository::lfsParsePointer(mPointer, oid, size));
+  QCOMPARE(oid, mOid);
+  QCOMPARE(size, qint64(kContent.length()));
+
+  // Reject other content.
+  QVERIFY(!git::Repository::lfsParsePointer(kContent, oid, size));
+  QVERIFY(!git::Repository::lfsParsePointer(
+    "version https://git-lfs.github.com/spec/v1\n"
+    "oid sha256:1234\n"
+    "size 14\n", oid, size));
+}
+
+void TestLfs::object()
+{
+  // Missing objects aren't found.
+  QVERIFY(mRepo->lfsObject(mPointer).isNull());
+
+  // Objects are read from local storage.
+  QString name = QString("lfs/objects/%1/%2/%3").arg(
+    QString(mOid.left(2)), QString(mOid.mid(2, 2)), QString(mOid));
+  write(mRepo->dir().filePath(name), kContent);
+  QCOMPARE(mRepo->lfsObject(mPointer), kContent);
+  QCOMPARE(mRepo->lfsSmudge(mPointer, "image.png"), kContent);
+
+  // Objects with the wrong size are ignored.
+  write(mRepo->dir().filePath(name), kContent + "truncated");
+  QVERIFY(mRepo->lfsObject(mPointer).isNull());
+}
+
+void TestLfs::tracked()
+{
+  write(mRepo->workdir().filePath(".gitattributes"),
+    "# comment\n"
+    "*.png filter=lfs diff=lfs merge=lfs -text\n"
+    "*.txt text\n"
+    "*.psd filter=lfs diff=lfs merge=lfs -text lockable\n");
+
+  QCOMPARE(mRepo->lfsTracked(), QStringList({"*.png", "*.psd"}));
+
+  // Patterns in nested attributes files are relative to their directory.
+  write(mRepo->workdir().filePath("art/.gitattributes"),
+    "*.tga filter=lfs diff=lfs merge=lfs -text\n"
+    "/cover.jpg filter=lfs diff=lfs merge=lfs -text\n");
+  mRepo->index().setStaged({"art/.gitattributes"}, true);
+
+  QCOMPARE(mRepo->lfsTracked(),
+    QStringList({"*.png", "*.psd", "art/*.tga", "art/cover.jpg"}));
+}
+
+TEST_MAIN(TestLfs)
+
+#include "lfs.moc"
@@ -26,6 +26,7 @@ private slots:
   void initTestCase();
   void copy();
   void copyAll();
+  void batch();
   void cleanupTestCase();
 
 private:
@@ -118,6 +119,44 @@ void  TestLog::copyEachEntry(LogView *logView, QList<QAbstractScrollArea *> qTex
   copyEachEntry(logView, qTextEdits, entries);
 }
 
+void TestLog::batch()
+{
+  LogEntry *root = new LogEntry;
+  LogView view(root);
+  QAbstractItemModel *model = view.model();
+  QSignalSpy spy(model, &QAbstractItemModel::rowsInserted);
+
+  LogEntry *entry = root->addEntry("Entry", "Batch");
+  QCOMPARE(spy.count(), 1);
+
+  for (int i = 0; i < 1000; ++i)
+    entry->queueEntry(LogEntry::File, QString::number(i), 'M');
+
+  // Entries are inserted at once.
+  QModelIndex index = model->index(0, 0);
+  QCOMPARE(model->rowCount(index), 0);
+  QTRY_COMPARE(spy.count(), 2);
+
+  // The rest are collapsed into a group.
+  QCOMPARE(model->rowCount(index), 501);
+  QModelIndex group = model->index(500, 0, index);
+  QCOMPARE(model->rowCount(group), 0);
+  QVERIFY(model->hasChildren(group));
+  QVERIFY(model->canFetchMore(group));
+
+  // Populate the group when the view asks for it.
+  model->fetchMore(group);
+  QCOMPARE(model->rowCount(group), 500);
+  QVERIFY(!model->canFetchMore(group));
+  QCOMPARE(spy.count(), 3);
+
+  // Entries added later go to the expanded group.
+  entry->queueEntry(LogEntry::File, "1000", 'M');
+  entry->setBusy(false);
+  QCOMPARE(model->rowCount(index), 501);
+  QCOMPARE(model->rowCount(group), 501);
+}
+
 void TestLog::cleanupTestCase()
 {
   qWait(closeDelay);
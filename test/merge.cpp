@@ -87,7 +87,7 @@ void TestMerge::secondCommit()
   QVERIFY(branch.isValid());
 
   view->checkout(branch);
-  QCOMPARE(mRepo->head().name(), QString("branch2"));
+  QTRY_COMPARE(mRepo->head().name(), QString("branch2"));
 
   QFile file(mRepo->workdir().filePath("test"));
   QVERIFY(file.open(QFile::WriteOnly));
@@ -124,7 +124,7 @@ void TestMerge::thirdCommit()
   QVERIFY(ref);
 
   view->checkout(ref);
-  QCOMPARE(mRepo->head().name(), QString("master"));
+  QTRY_COMPARE(mRepo->head().name(), QString("master"));
 
   QFile file(mRepo->workdir().filePath("test"));
   QVERIFY(file.open(QFile::WriteOnly));
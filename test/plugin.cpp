@@ -0,0 +1,137 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "plugins/Plugin.h"
+#include <QThread>
+
+using namespace Test;
+
+namespace {
+
+// Report every line unless the option is turned off.
+const char *kScript =
+  "function options(options)\n"
+  "  options:define_boolean('all', 'Report every line', true)\n"
+  "end\n"
+  "\n"
+  "function kinds(kinds, options)\n"
+  "  kinds:define_error('line', 'Line', 'line', 'Report every line', true)\n"
+  "end\n"
+  "\n"
+  "function hunk(hunk, options)\n"
+  "  if not options:value('all') then\n"
+  "    error('disabled')\n"
+  "  end\n"
+  "\n"
+  "  for _, line in ipairs(hunk:lines()) do\n"
+  "    line:add_error('line', 1, 1)\n"
+  "  end\n"
+  "end\n";
+
+} // anon. namespace
+
+class TestPlugin : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void values();
+  void error();
+
+private:
+  // Run the hunk function on a separate thread.
+  bool run(
+    const Plugin &plugin,
+    const Plugin::Values &values,
+    Plugin::Diagnostics &diags);
+
+  QTemporaryDir mDir;
+  QString mFile;
+  Plugin::Hunk mHunk;
+  ScratchRepository mRepo;
+};
+
+bool TestPlugin::run(
+  const Plugin &plugin,
+  const Plugin::Values &values,
+  Plugin::Diagnostics &diags)
+{
+  bool result = false;
+  QScopedPointer<QThread> thread(QThread::create([&] {
+    result = plugin.hunk(mHunk, values, diags);
+  }));
+
+  thread->start();
+  thread->wait();
+  return result;
+}
+
+void TestPlugin::initTestCase()
+{
+  mFile = QDir(mDir.path()).filePath("lines.lua");
+  QFile file(mFile);
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write(kScript);
+  file.close();
+
+  mHunk.lines.append({'+', "first\n", {}});
+  mHunk.lines.append({'-', "second\n", {}});
+}
+
+void TestPlugin::values()
+{
+  Plugin plugin(mFile, mRepo);
+  QVERIFY(plugin.isValid());
+  plugin.setOptionValue("all", true);
+
+  // The hunk uses the values that were read before the change.
+  Plugin::Values values = plugin.values();
+  plugin.setOptionValue("all", false);
+
+  Plugin::Diagnostics diags;
+  QVERIFY(run(plugin, values, diags));
+  QCOMPARE(diags.size(), 2);
+  QCOMPARE(diags.value(0).size(), 1);
+  QCOMPARE(diags.value(1).size(), 1);
+
+  // Disabled diagnostics aren't reported.
+  values.enabled["line"] = false;
+  diags.clear();
+  QVERIFY(run(plugin, values, diags));
+  QVERIFY(diags.isEmpty());
+}
+
+void TestPlugin::error()
+{
+  Plugin plugin(mFile, mRepo);
+  QVERIFY(plugin.isValid());
+  plugin.setOptionValue("all", false);
+
+  QThread *thread = nullptr;
+  QSignalSpy spy(&plugin, &Plugin::error);
+  connect(&plugin, &Plugin::error, [&thread] {
+    thread = QThread::currentThread();
+  });
+
+  Plugin::Diagnostics diags;
+  QVERIFY(!run(plugin, plugin.values(), diags));
+  QVERIFY(!plugin.isValid());
+  QVERIFY(plugin.errorString().contains("disabled"));
+
+  // The error is reported on the main thread.
+  QCOMPARE(spy.count(), 0);
+  QTRY_COMPARE(spy.count(), 1);
+  QCOMPARE(thread, QThread::currentThread());
+}
+
+TEST_MAIN(TestPlugin)
+
+#include "plugin.moc"
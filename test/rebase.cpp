@@ -0,0 +1,125 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "git/Branch.h"
+#include "git/Commit.h"
+#include "git/Index.h"
+#include "git/Rebase.h"
+
+using namespace Test;
+
+class TestRebase : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void inmemory();
+  void conflict();
+
+private:
+  void write(const QString &name, const QByteArray &content);
+  git::Commit commit(const QString &name, const QByteArray &content);
+  void switchTo(const QString &name);
+
+  ScratchRepository mRepo;
+};
+
+void TestRebase::write(const QString &name, const QByteArray &content)
+{
+  QFile file(mRepo->workdir().filePath(name));
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write(content);
+}
+
+git::Commit TestRebase::commit(const QString &name, const QByteArray &content)
+{
+  write(name, content);
+  mRepo->index().setStaged({name}, true);
+  return mRepo->commit(name);
+}
+
+void TestRebase::switchTo(const QString &name)
+{
+  git::Branch branch = mRepo->lookupBranch(name, GIT_BRANCH_LOCAL);
+  QVERIFY(mRepo->checkout(branch.target(), nullptr, {}, GIT_CHECKOUT_FORCE));
+  QVERIFY(mRepo->setHead(branch));
+}
+
+void TestRebase::initTestCase()
+{
+  QVERIFY(commit("a.txt", "a\n").isValid());
+  QVERIFY(mRepo->createBranch("upstream", mRepo->head().target()).isValid());
+
+  // Add a commit to each branch.
+  switchTo("upstream");
+  QVERIFY(commit("b.txt", "b\n").isValid());
+  switchTo("master");
+  QVERIFY(commit("c.txt", "c\n").isValid());
+}
+
+void TestRebase::inmemory()
+{
+  git::Commit head = mRepo->head().target();
+  git::Branch upstream = mRepo->lookupBranch("upstream", GIT_BRANCH_LOCAL);
+
+  git::Rebase rebase =
+    mRepo->rebase(upstream.annotatedCommit(), QString(), QString(), true);
+  QVERIFY(rebase.isValid());
+  QCOMPARE(rebase.count(), 1);
+
+  QVERIFY(rebase.hasNext());
+  QCOMPARE(rebase.next(), head);
+
+  git::Commit after = rebase.commit();
+  QVERIFY(after.isValid());
+  QVERIFY(after != head);
+  QCOMPARE(after.parents().first(), upstream.target());
+  QVERIFY(!rebase.hasNext());
+
+  // Nothing outside of the object database changed.
+  QCOMPARE(mRepo->head().target(), head);
+  QCOMPARE(mRepo->state(), static_cast<int>(GIT_REPOSITORY_STATE_NONE));
+  QVERIFY(!mRepo->workdir().exists("b.txt"));
+  QVERIFY(!mRepo->status(mRepo->index(), nullptr).isValid());
+}
+
+void TestRebase::conflict()
+{
+  switchTo("upstream");
+  QVERIFY(commit("a.txt", "upstream\n").isValid());
+  switchTo("master");
+  QVERIFY(commit("a.txt", "master\n").isValid());
+
+  git::Commit head = mRepo->head().target();
+  git::Branch upstream = mRepo->lookupBranch("upstream", GIT_BRANCH_LOCAL);
+
+  git::Rebase rebase =
+    mRepo->rebase(upstream.annotatedCommit(), QString(), QString(), true);
+  QVERIFY(rebase.isValid());
+  QCOMPARE(rebase.count(), 2);
+
+  // The first commit applies cleanly. The second conflicts.
+  QVERIFY(rebase.next().isValid());
+  QVERIFY(rebase.commit().isValid());
+  QVERIFY(rebase.next().isValid());
+  QVERIFY(!rebase.commit().isValid());
+  rebase.abort();
+
+  // The conflict isn't written to the working directory.
+  QCOMPARE(mRepo->head().target(), head);
+  QCOMPARE(mRepo->state(), static_cast<int>(GIT_REPOSITORY_STATE_NONE));
+  QVERIFY(!mRepo->index().hasConflicts());
+  QVERIFY(!mRepo->status(mRepo->index(), nullptr).isValid());
+}
+
+TEST_MAIN(TestRebase)
+
+#include "rebase.moc"
@@ -0,0 +1,151 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "git/Branch.h"
+#include "git/Commit.h"
+#include "git/Index.h"
+#include "git/Tree.h"
+#include "ui/ReferenceView.h"
+#include "git2/commit.h"
+#include "git2/repository.h"
+#include "git2/signature.h"
+#include "git2/tree.h"
+
+using namespace Test;
+
+class TestReferenceView : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void insert();
+  void remove();
+  void update();
+  void cleanupTestCase();
+
+private:
+  int rowCount() const;
+
+  ScratchRepository mRepo;
+  ReferenceView *mView = nullptr;
+};
+
+void TestReferenceView::initTestCase()
+{
+  QFile file(mRepo->workdir().filePath("a.txt"));
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write("a\n");
+  file.close();
+
+  // Date the initial commit an hour ago so that later commits are
+  // newer than it without waiting.
+  git::Index index = mRepo->index();
+  index.setStaged({"a.txt"}, true);
+  git::Tree tree = index.writeTree();
+  QVERIFY(tree.isValid());
+
+  git_repository *repo = nullptr;
+  QVERIFY(!git_repository_open(&repo, mRepo->dir().path().toUtf8()));
+
+  git_tree *raw = nullptr;
+  git_signature *signature = nullptr;
+  qint64 time = QDateTime::currentSecsSinceEpoch() - 3600;
+  QVERIFY(!git_tree_lookup(&raw, repo, tree.id()));
+  QVERIFY(!git_signature_new(&signature, "Test", "test@example.com", time, 0));
+
+  git_oid id;
+  QVERIFY(!git_commit_create_v(
+    &id, repo, "HEAD", signature, signature, nullptr, "initial", raw, 0));
+
+  git_signature_free(signature);
+  git_tree_free(raw);
+  git_repository_free(repo);
+  mRepo->invalidateRefs();
+
+  mView = new ReferenceView(mRepo, ReferenceView::LocalBranches);
+  QCOMPARE(rowCount(), 1);
+}
+
+void TestReferenceView::insert()
+{
+  QAbstractItemModel *model = mView->model();
+  QSignalSpy reset(model, &QAbstractItemModel::modelReset);
+  QSignalSpy inserted(model, &QAbstractItemModel::rowsInserted);
+
+  // A burst of new branches is inserted without a reset.
+  git::Commit commit = mRepo->head().target();
+  for (int i = 0; i < 10; ++i)
+    QVERIFY(mRepo->createBranch(QString("branch%1").arg(i), commit).isValid());
+
+  // They're contiguous, so they're inserted as one range.
+  QTRY_COMPARE(rowCount(), 11);
+  QCOMPARE(inserted.count(), 1);
+  QCOMPARE(inserted.first().at(1).toInt(), 0);
+  QCOMPARE(inserted.first().at(2).toInt(), 9);
+  QCOMPARE(reset.count(), 0);
+}
+
+void TestReferenceView::remove()
+{
+  QAbstractItemModel *model = mView->model();
+  QSignalSpy reset(model, &QAbstractItemModel::modelReset);
+  QSignalSpy removed(model, &QAbstractItemModel::rowsRemoved);
+
+  mRepo->lookupBranch("branch0", GIT_BRANCH_LOCAL).remove();
+  mRepo->lookupBranch("branch1", GIT_BRANCH_LOCAL).remove();
+
+  QTRY_COMPARE(rowCount(), 9);
+  QVERIFY(removed.count() > 0);
+  QCOMPARE(reset.count(), 0);
+}
+
+void TestReferenceView::update()
+{
+  QAbstractItemModel *model = mView->model();
+  QSignalSpy reset(model, &QAbstractItemModel::modelReset);
+  QSignalSpy moved(model, &QAbstractItemModel::rowsMoved);
+
+  // Committing to a branch moves it to the top.
+  git::Commit initial = mRepo->head().target();
+  git::Branch branch = mRepo->lookupBranch("branch9", GIT_BRANCH_LOCAL);
+  QVERIFY(mRepo->setHead(branch));
+  QVERIFY(mRepo->commit("second").isValid());
+
+  QModelIndex parent = model->index(0, 0);
+  QTRY_COMPARE(model->index(0, 0, parent).data().toString(), QString("branch9"));
+  QCOMPARE(rowCount(), 9);
+  QCOMPARE(moved.count(), 1);
+
+  // Moving it back down is also a single move.
+  moved.clear();
+  branch = mRepo->lookupBranch("branch9", GIT_BRANCH_LOCAL);
+  QVERIFY(branch.setTarget(initial, "reset").isValid());
+
+  QTRY_COMPARE(model->index(7, 0, parent).data().toString(), QString("branch9"));
+  QCOMPARE(model->index(0, 0, parent).data().toString(), QString("branch2"));
+  QCOMPARE(moved.count(), 1);
+  QCOMPARE(reset.count(), 0);
+}
+
+void TestReferenceView::cleanupTestCase()
+{
+  delete mView;
+}
+
+int TestReferenceView::rowCount() const
+{
+  QAbstractItemModel *model = mView->model();
+  return model->rowCount(model->index(0, 0));
+}
+
+TEST_MAIN(TestReferenceView)
+
+#include "reference_view.moc"
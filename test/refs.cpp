@@ -0,0 +1,149 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "git/Branch.h"
+#include "git/Commit.h"
+#include "git/Index.h"
+#include "git/ReferenceSnapshot.h"
+#include "git/TagRef.h"
+
+using namespace Test;
+
+class TestRefs : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void read();
+  void add();
+  void remove();
+  void rename();
+  void external();
+
+private:
+  git::Commit commit(const QString &name);
+  void writeRef(const QString &name, const git::Id &id);
+
+  ScratchRepository mRepo;
+  git::Commit mCommit;
+};
+
+void TestRefs::initTestCase()
+{
+  mCommit = commit("a.txt");
+  QVERIFY(mCommit.isValid());
+}
+
+void TestRefs::read()
+{
+  git::ReferenceSnapshot refs = mRepo->refSnapshot();
+  QVERIFY(refs.isValid());
+  QVERIFY(refs.contains("refs/heads/master"));
+  QCOMPARE(refs.target("refs/heads/master"), mCommit.id());
+  QCOMPARE(refs.refs(mCommit.id()).size(), 1);
+
+  // Reading again doesn't change the version.
+  QCOMPARE(mRepo->refSnapshot().version(), refs.version());
+}
+
+void TestRefs::add()
+{
+  git::ReferenceSnapshot before = mRepo->refSnapshot();
+  QVERIFY(mRepo->createBranch("branch", mCommit).isValid());
+  QVERIFY(mRepo->createTag(mCommit, "tag").isValid());
+
+  git::ReferenceSnapshot after = mRepo->refSnapshot();
+  QVERIFY(after.version() > before.version());
+  QCOMPARE(after.target("refs/heads/branch"), mCommit.id());
+  QCOMPARE(after.target("refs/tags/tag"), mCommit.id());
+  QCOMPARE(mCommit.refs().size(), 3);
+  QCOMPARE(mRepo->branches(GIT_BRANCH_LOCAL).size(), 2);
+  QCOMPARE(mRepo->tags().size(), 1);
+
+  // The old snapshot is unchanged.
+  QVERIFY(!before.contains("refs/heads/branch"));
+}
+
+void TestRefs::remove()
+{
+  mRepo->lookupBranch("branch", GIT_BRANCH_LOCAL).remove();
+  QVERIFY(mRepo->lookupTag("tag").remove());
+
+  git::ReferenceSnapshot refs = mRepo->refSnapshot();
+  QVERIFY(!refs.contains("refs/heads/branch"));
+  QVERIFY(!refs.contains("refs/tags/tag"));
+  QCOMPARE(refs.refs(mCommit.id()).size(), 1);
+}
+
+void TestRefs::rename()
+{
+  git::Branch branch = mRepo->createBranch("old", mCommit);
+  QVERIFY(branch.rename("new").isValid());
+
+  git::ReferenceSnapshot refs = mRepo->refSnapshot();
+  QVERIFY(!refs.contains("refs/heads/old"));
+  QVERIFY(refs.contains("refs/heads/new"));
+}
+
+void TestRefs::external()
+{
+  // Write a loose reference behind the repository's back.
+  writeRef("refs/heads/external", mCommit.id());
+  QVERIFY(!mRepo->refSnapshot().contains("refs/heads/external"));
+  mRepo->invalidateRefs();
+  QVERIFY(mRepo->refSnapshot().contains("refs/heads/external"));
+
+  // Point it somewhere else. The size is the same, so give the
+  // file a different modification time.
+  git::Commit next = commit("b.txt");
+  writeRef("refs/heads/external", next.id());
+  mRepo->invalidateRefs();
+  QCOMPARE(mRepo->refSnapshot().target("refs/heads/external"), next.id());
+
+  // A change made through the repository doesn't hide the external
+  // change to another reference.
+  writeRef("refs/heads/external", mCommit.id());
+  QVERIFY(mRepo->createBranch("internal", next).isValid());
+  QCOMPARE(mRepo->refSnapshot().target("refs/heads/external"), next.id());
+  mRepo->invalidateRefs();
+  QCOMPARE(mRepo->refSnapshot().target("refs/heads/external"), mCommit.id());
+  QCOMPARE(mRepo->refSnapshot().target("refs/heads/internal"), next.id());
+}
+
+git::Commit TestRefs::commit(const QString &name)
+{
+  QFile file(mRepo->workdir().filePath(name));
+  if (!file.open(QFile::WriteOnly))
+    return git::Commit();
+
+  file.write(name.toUtf8() + '\n');
+  file.close();
+
+  mRepo->index().setStaged({name}, true);
+  return mRepo->commit(name);
+}
+
+void TestRefs::writeRef(const QString &name, const git::Id &id)
+{
+  // Make the modification time differ from any earlier write.
+  static int offset = 0;
+  QDateTime time = QDateTime::currentDateTime().addSecs(++offset * 60);
+
+  QFile file(mRepo->dir().filePath(name));
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write(id.toString().toUtf8() + '\n');
+  file.flush();
+  QVERIFY(file.setFileTime(time, QFileDevice::FileModificationTime));
+}
+
+TEST_MAIN(TestRefs)
+
+#include "refs.moc"
@@ -0,0 +1,106 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "git/Index.h"
+#include "ui/MainWindow.h"
+#include "ui/RepoView.h"
+#include "ui/ResourceGovernor.h"
+
+using namespace Test;
+
+class TestResourceGovernor : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void queue();
+  void autoFetch();
+
+private:
+  ScratchRepository mRepo;
+  ScratchRepository mRemote;
+};
+
+void TestResourceGovernor::queue()
+{
+  ResourceGovernor *governor = ResourceGovernor::instance();
+  int limit = governor->limit();
+  QVERIFY(limit > 0);
+
+  // Jobs start immediately until the budget is used.
+  int started = 0;
+  QObject context;
+  for (int i = 0; i < limit; ++i)
+    governor->acquire(&context, [&started] { ++started; });
+  QCOMPARE(started, limit);
+  QCOMPARE(governor->running(), limit);
+
+  // The rest wait for a slot.
+  QScopedPointer<QObject> dropped(new QObject);
+  governor->acquire(dropped.data(), [&started] { ++started; });
+  governor->acquire(&context, [&started] { ++started; });
+  QCOMPARE(started, limit);
+  QCOMPARE(governor->queued(), 2);
+
+  // Jobs whose context is gone are skipped.
+  dropped.reset();
+  governor->release();
+  QCOMPARE(started, limit + 1);
+  QCOMPARE(governor->queued(), 0);
+
+  for (int i = 0; i < limit; ++i)
+    governor->release();
+  QCOMPARE(governor->running(), 0);
+}
+
+void TestResourceGovernor::autoFetch()
+{
+  QFile file(mRemote->workdir().filePath("a.txt"));
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write("a\n");
+  file.close();
+
+  mRemote->index().setStaged({"a.txt"}, true);
+  QVERIFY(mRemote->commit("a.txt").isValid());
+
+  git::Remote remote =
+    mRepo->addRemote("origin", mRemote->workdir().path());
+  QVERIFY(remote.isValid());
+
+  MainWindow window(mRepo);
+  RepoView *view = window.currentView();
+
+  // Hold every slot.
+  ResourceGovernor *governor = ResourceGovernor::instance();
+  int limit = governor->limit();
+  QObject context;
+  for (int i = 0; i < limit; ++i)
+    governor->acquire(&context, [] {});
+
+  // An automatic fetch waits for the running fetch without queueing.
+  QFutureWatcher<git::Result> watcher;
+  watcher.setFuture(view->fetch(remote));
+  view->startAutoFetch();
+  QCOMPARE(governor->queued(), 0);
+
+  // Then it waits for a slot.
+  QTRY_VERIFY(watcher.isFinished());
+  QTRY_COMPARE(governor->queued(), 1);
+
+  // The slot is held until the fetch finishes.
+  for (int i = 0; i < limit; ++i)
+    governor->release();
+  QCOMPARE(governor->queued(), 0);
+  QTRY_COMPARE(governor->running(), 0);
+}
+
+TEST_MAIN(TestResourceGovernor)
+
+#include "resource_governor.moc"
@@ -0,0 +1,139 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "ui/Scheduler.h"
+#include <QSemaphore>
+
+using namespace Test;
+
+namespace {
+
+// More than any bulk pool can run at once.
+const int kBulkCount = 64;
+
+} // anon. namespace
+
+class TestScheduler : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void result();
+  void priority();
+  void bulkLimit();
+  void cancel();
+
+private:
+  ScratchRepository mRepo;
+};
+
+void TestScheduler::result()
+{
+  Scheduler *scheduler = Scheduler::instance();
+  QFuture<int> future =
+    scheduler->run(Scheduler::Normal, mRepo, [] { return 42; });
+  future.waitForFinished();
+  QVERIFY(!future.isCanceled());
+  QCOMPARE(future.result(), 42);
+}
+
+void TestScheduler::priority()
+{
+  // Occupy the bulk class.
+  QSemaphore blocked;
+  Scheduler *scheduler = Scheduler::instance();
+  QList<QFuture<bool>> futures;
+  for (int i = 0; i < kBulkCount; ++i) {
+    futures.append(scheduler->run(Scheduler::Bulk, mRepo, [&blocked] {
+      blocked.acquire();
+      return true;
+    }));
+  }
+
+  // Interactive tasks don't queue behind bulk tasks.
+  QSemaphore done;
+  scheduler->run(Scheduler::Interactive, mRepo, [&done] {
+    done.release();
+    return true;
+  });
+
+  QVERIFY(done.tryAcquire(1, 5000));
+
+  // Release bulk tasks.
+  blocked.release(kBulkCount);
+  foreach (QFuture<bool> future, futures)
+    QVERIFY(future.result());
+}
+
+void TestScheduler::bulkLimit()
+{
+  // Queue more bulk tasks than the bulk class can run at once.
+  QMutex mutex;
+  int running = 0;
+  int maximum = 0;
+  Scheduler *scheduler = Scheduler::instance();
+  QList<QFuture<bool>> futures;
+  for (int i = 0; i < kBulkCount; ++i) {
+    futures.append(scheduler->run(Scheduler::Bulk, mRepo,
+    [&mutex, &running, &maximum] {
+      mutex.lock();
+      maximum = qMax(maximum, ++running);
+      mutex.unlock();
+
+      QThread::msleep(5);
+
+      QMutexLocker locker(&mutex);
+      --running;
+      return true;
+    }));
+  }
+
+  // Idle workers in the other classes look for work to steal.
+  QList<QFuture<bool>> others;
+  for (int i = 0; i < kBulkCount; ++i) {
+    Scheduler::Priority priority =
+      (i % 2) ? Scheduler::Interactive : Scheduler::Normal;
+    others.append(scheduler->run(priority, mRepo, [] { return true; }));
+  }
+
+  // Wait without running queued tasks on this thread.
+  foreach (QFuture<bool> future, futures + others)
+    QTRY_VERIFY(future.isFinished());
+
+  // Stolen tasks still count against the bulk limit.
+  QVERIFY(maximum <= qMax(1, QThread::idealThreadCount() / 4));
+}
+
+void TestScheduler::cancel()
+{
+  QSemaphore blocked;
+  Scheduler *scheduler = Scheduler::instance();
+  QList<QFuture<bool>> futures;
+  for (int i = 0; i < kBulkCount; ++i) {
+    futures.append(scheduler->run(Scheduler::Bulk, mRepo, [&blocked] {
+      blocked.acquire();
+      return true;
+    }));
+  }
+
+  // Queued tasks finish immediately with a default result.
+  scheduler->cancel(mRepo);
+  QVERIFY(futures.last().isFinished());
+  QVERIFY(futures.last().isCanceled());
+  QCOMPARE(futures.last().result(), false);
+
+  blocked.release(kBulkCount);
+  foreach (QFuture<bool> future, futures)
+    future.waitForFinished();
+}
+
+TEST_MAIN(TestScheduler)
+
+#include "scheduler.moc"
@@ -0,0 +1,131 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "conf/Settings.h"
+#include <QThread>
+
+namespace {
+
+const QString kKey = "test/value";
+const QString kGroup = "test/group";
+
+} // anon. namespace
+
+class TestSettings : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void write();
+  void threads();
+  void groups();
+  void cleanup();
+};
+
+void TestSettings::write()
+{
+  Settings *settings = Settings::instance();
+  QSignalSpy spy(settings, &Settings::valueChanged);
+
+  settings->setValue(kKey, 42);
+  QCOMPARE(settings->value(kKey).toInt(), 42);
+  QCOMPARE(settings->value<int>(kKey), 42);
+  QCOMPARE(settings->value<QString>(kKey), QString("42"));
+  QCOMPARE(spy.count(), 1);
+  QCOMPARE(spy.first().at(0).toString(), kKey);
+  QCOMPARE(spy.first().at(1).toInt(), 42);
+
+  // Writing the same value again doesn't notify.
+  settings->setValue(kKey, 42);
+  QCOMPARE(spy.count(), 1);
+
+  // The write goes through to QSettings.
+  QCOMPARE(QSettings().value(kKey).toInt(), 42);
+}
+
+void TestSettings::threads()
+{
+  Settings *settings = Settings::instance();
+  settings->setValue(kKey, 42);
+
+  // Another thread reads the value written on this thread.
+  int value = 0;
+  QScopedPointer<QThread> thread(QThread::create([settings, &value] {
+    value = settings->value<int>(kKey);
+  }));
+
+  thread->start();
+  QVERIFY(thread->wait());
+  QCOMPARE(value, 42);
+
+  // And the next write.
+  settings->setValue(kKey, 43);
+  thread.reset(QThread::create([settings, &value] {
+    value = settings->value<int>(kKey);
+  }));
+
+  thread->start();
+  QVERIFY(thread->wait());
+  QCOMPARE(value, 43);
+}
+
+void TestSettings::groups()
+{
+  Settings *settings = Settings::instance();
+  QSignalSpy spy(settings, &Settings::valueChanged);
+
+  // The signal has the full key.
+  settings->beginGroup(kGroup);
+  settings->setValue("value", 1);
+  QCOMPARE(settings->group(), kGroup);
+  QCOMPARE(settings->value<int>("value"), 1);
+  QCOMPARE(spy.count(), 1);
+  QCOMPARE(spy.first().at(0).toString(), kGroup + "/value");
+
+  // The group isn't visible to another thread.
+  QString group;
+  QVariant value;
+  QVariant grouped;
+  QScopedPointer<QThread> thread(QThread::create(
+  [settings, &group, &value, &grouped] {
+    group = settings->group();
+    value = settings->value("value");
+    grouped = settings->value(kGroup + "/value");
+
+    // Its own group doesn't leak back either.
+    settings->beginGroup("other");
+    settings->endGroup();
+  }));
+
+  thread->start();
+  QVERIFY(thread->wait());
+  QVERIFY(group.isEmpty());
+  QVERIFY(!value.isValid());
+  QCOMPARE(grouped.toInt(), 1);
+  QCOMPARE(settings->group(), kGroup);
+
+  settings->endGroup();
+  QVERIFY(settings->group().isEmpty());
+  QCOMPARE(settings->value<int>(kGroup + "/value"), 1);
+}
+
+void TestSettings::cleanup()
+{
+  // Writing the default removes the value.
+  Settings *settings = Settings::instance();
+  settings->setValue(kKey, QVariant());
+  settings->setValue(kGroup + "/value", QVariant());
+  QVERIFY(!settings->value(kKey).isValid());
+  QVERIFY(!QSettings().contains(kKey));
+}
+
+TEST_MAIN(TestSettings)
+
+#include "settings.moc"
@@ -0,0 +1,206 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "git/Config.h"
+#include "git/Index.h"
+#include "git/Patch.h"
+
+using namespace Test;
+
+namespace {
+
+class Callbacks : public git::Diff::Callbacks
+{
+public:
+  bool progress(const QString &oldPath, const QString &newPath) override
+  {
+    return true;
+  }
+
+  void partial(const git::Diff &diff) override
+  {
+    mPartial = diff;
+    mDeltasBeforePartial = mDeltas.size();
+  }
+
+  void delta(const QString &path) override
+  {
+    mDeltas.append(path);
+  }
+
+  git::Diff mPartial;
+  int mDeltasBeforePartial = -1;
+  QStringList mDeltas;
+};
+
+} // anon. namespace
+
+class TestStatus : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void paths();
+  void cache();
+  void partial();
+
+private:
+  void write(const QString &name, const QByteArray &content);
+
+  ScratchRepository mRepo;
+};
+
+void TestStatus::write(const QString &name, const QByteArray &content)
+{
+  QDir dir = mRepo->workdir();
+  dir.mkpath(QFileInfo(name).path());
+
+  QFile file(dir.filePath(name));
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write(content);
+}
+
+void TestStatus::initTestCase()
+{
+  write("a.txt", "a");
+  write("dir/b.txt", "b");
+  write("dir/sub/c.txt", "c");
+
+  git::Index index = mRepo->index();
+  index.setStaged({"a.txt", "dir/b.txt", "dir/sub/c.txt"}, true);
+  QVERIFY(mRepo->commit("initial").isValid());
+  QVERIFY(!mRepo->status(mRepo->index(), nullptr).isValid());
+}
+
+void TestStatus::paths()
+{
+  write("a.txt", "changed");
+  write("dir/sub/c.txt", "changed");
+  write("dir/sub/d.txt", "untracked");
+
+  // A full scan sees every change.
+  git::Diff full = mRepo->status(mRepo->index(), nullptr);
+  QVERIFY(full.isValid());
+  QCOMPARE(full.count(), 3);
+
+  // Only the given paths are examined.
+  git::Diff file = mRepo->status(mRepo->index(), nullptr, false, {"a.txt"});
+  QVERIFY(file.isValid());
+  QCOMPARE(file.count(), 1);
+  QCOMPARE(file.name(0), QString("a.txt"));
+
+  // Directories match everything below them.
+  git::Diff dir = mRepo->status(mRepo->index(), nullptr, false, {"dir/sub"});
+  QVERIFY(dir.isValid());
+  QCOMPARE(dir.count(), 2);
+
+  // Unchanged paths produce an empty status.
+  QVERIFY(!mRepo->status(mRepo->index(), nullptr, false, {"dir/b.txt"}));
+}
+
+void TestStatus::cache()
+{
+  mRepo->invalidateStatusCache();
+
+  // The first status has to scan everything.
+  git::StatusCache::Stats stats = mRepo->statusCacheStats();
+  git::Diff diff = mRepo->status(mRepo->index(), nullptr);
+  QVERIFY(diff.isValid());
+  QCOMPARE(diff.count(), 3);
+  QCOMPARE(mRepo->statusCacheStats().scans, stats.scans + 1);
+
+  // Recently modified directories are always rescanned.
+  QTest::qWait(2500);
+  mRepo->status(mRepo->index(), nullptr);
+
+  // Nothing changed. Every directory is a hit.
+  stats = mRepo->statusCacheStats();
+  diff = mRepo->status(mRepo->index(), nullptr);
+  QVERIFY(diff.isValid());
+  QCOMPARE(diff.count(), 3);
+  QCOMPARE(mRepo->statusCacheStats().misses, stats.misses);
+  QCOMPARE(mRepo->statusCacheStats().hits, stats.hits + 3);
+
+  // Adding an untracked file misses on its directory.
+  write("dir/e.txt", "untracked");
+  stats = mRepo->statusCacheStats();
+  diff = mRepo->status(mRepo->index(), nullptr);
+  QVERIFY(diff.isValid());
+  QCOMPARE(diff.count(), 4);
+  QVERIFY(diff.indexOf("dir/e.txt") >= 0);
+  QCOMPARE(mRepo->statusCacheStats().misses, stats.misses + 1);
+
+  // Changing the global excludes file requires a full scan.
+  QString excludes = mRepo->dir().filePath("excludes");
+  QFile file(excludes);
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write("e.txt\n");
+  file.close();
+
+  git::Config config = mRepo->config();
+  config.setValue("core.excludesFile", excludes);
+  stats = mRepo->statusCacheStats();
+  diff = mRepo->status(mRepo->index(), nullptr);
+  QVERIFY(diff.isValid());
+  QCOMPARE(diff.count(), 3);
+  QCOMPARE(mRepo->statusCacheStats().scans, stats.scans + 1);
+
+  QVERIFY(config.remove("core.excludesFile"));
+  stats = mRepo->statusCacheStats();
+  diff = mRepo->status(mRepo->index(), nullptr);
+  QCOMPARE(diff.count(), 4);
+  QCOMPARE(mRepo->statusCacheStats().scans, stats.scans + 1);
+}
+
+void TestStatus::partial()
+{
+  git::Index index = mRepo->index();
+  index.setStaged({"a.txt"}, true);
+  mRepo->invalidateStatusCache();
+
+  // The staged change is reported before the workdir is scanned.
+  Callbacks callbacks;
+  git::Diff diff = mRepo->status(index, &callbacks);
+  QVERIFY(callbacks.mPartial.isValid());
+  QCOMPARE(callbacks.mDeltasBeforePartial, 0);
+  QCOMPARE(callbacks.mPartial.count(), 1);
+  QCOMPARE(callbacks.mPartial.name(0), QString("a.txt"));
+  QVERIFY(callbacks.mPartial.index().isValid());
+
+  // Each workdir change is reported as it's found.
+  callbacks.mDeltas.sort();
+  QStringList deltas = {"dir/e.txt", "dir/sub/c.txt", "dir/sub/d.txt"};
+  QCOMPARE(callbacks.mDeltas, deltas);
+
+  // The partial diff isn't changed by the merge.
+  QVERIFY(diff.isValid());
+  QCOMPARE(diff.count(), 4);
+  QCOMPARE(callbacks.mPartial.count(), 1);
+
+  // The merged copy is the same as a status without callbacks.
+  mRepo->invalidateStatusCache();
+  git::Diff plain = mRepo->status(index, nullptr);
+  QCOMPARE(plain.count(), diff.count());
+  for (int i = 0; i < diff.count(); ++i) {
+    QCOMPARE(diff.name(i), plain.name(i));
+    QCOMPARE(diff.status(i), plain.status(i));
+    QCOMPARE(diff.patch(i).count(), plain.patch(i).count());
+  }
+
+  // The partial diff can still stage to the live index.
+  QCOMPARE(callbacks.mPartial.index().isStaged("a.txt"), git::Index::Staged);
+  callbacks.mPartial.index().setStaged({"a.txt"}, false);
+  QCOMPARE(mRepo->index().isStaged("a.txt"), git::Index::Unstaged);
+}
+
+TEST_MAIN(TestStatus)
+
+#include "status.moc"
@@ -0,0 +1,126 @@
+//
+//          Copyright (c) 2017, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "trace/Trace.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QThread>
+
+class TestTrace : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void disabled();
+  void write();
+  void cleanupTestCase();
+
+private:
+  QJsonArray events(const QString &path);
+};
+
+void TestTrace::initTestCase()
+{
+  Trace::setEnabled(true, false);
+  Trace::clear();
+}
+
+void TestTrace::disabled()
+{
+  Trace::setEnabled(false, false);
+  {
+    Trace::Span span("test", "disabled");
+    span.setArg("rows", 1);
+  }
+
+  Trace::counter("test", "disabled", 1);
+  Trace::setEnabled(true, false);
+
+  QTemporaryDir dir;
+  QString path = dir.path() + "/trace.json";
+  QVERIFY(Trace::write(path));
+
+  foreach (const QJsonValue &value, events(path))
+    QVERIFY(value.toObject().value("cat").toString() != "test");
+}
+
+void TestTrace::write()
+{
+  {
+    Trace::Span span("test", "main");
+    span.setArg("rows", 10);
+    span.setArg("bytes", 20);
+    span.setArg("ignored", 30);
+  }
+
+  QScopedPointer<QThread> thread(QThread::create([] {
+    Trace::Span span("test", "worker");
+    span.setArg("files", 5);
+  }));
+
+  thread->start();
+  thread->wait();
+
+  Trace::counter("test", "total", 15);
+
+  QTemporaryDir dir;
+  QString path = dir.path() + "/trace.json";
+  QVERIFY(Trace::write(path));
+
+  QHash<QString,QJsonObject> named;
+  foreach (const QJsonValue &value, events(path)) {
+    QJsonObject event = value.toObject();
+    if (event.value("cat").toString() == "test")
+      named.insert(event.value("name").toString(), event);
+  }
+
+  QJsonObject main = named.value("main");
+  QCOMPARE(main.value("ph").toString(), QString("X"));
+  QVERIFY(main.value("dur").toDouble() >= 0);
+  QCOMPARE(main.value("args").toObject().value("rows").toInt(), 10);
+  QCOMPARE(main.value("args").toObject().value("bytes").toInt(), 20);
+  QVERIFY(!main.value("args").toObject().contains("ignored"));
+
+  // Spans record the thread they ran on.
+  QJsonObject worker = named.value("worker");
+  QCOMPARE(worker.value("args").toObject().value("files").toInt(), 5);
+  QVERIFY(worker.value("tid") != main.value("tid"));
+
+  QJsonObject total = named.value("total");
+  QCOMPARE(total.value("ph").toString(), QString("C"));
+  QCOMPARE(total.value("args").toObject().value("total").toInt(), 15);
+}
+
+void TestTrace::cleanupTestCase()
+{
+  Trace::setEnabled(false, false);
+  Trace::clear();
+}
+
+QJsonArray TestTrace::events(const QString &path)
+{
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly))
+    return QJsonArray();
+
+  QJsonParseError error;
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+  if (error.error != QJsonParseError::NoError)
+    return QJsonArray();
+
+  return doc.object().value("traceEvents").toArray();
+}
+
+TEST_MAIN(TestTrace)
+
+#include "trace.moc"
@@ -0,0 +1,111 @@
+//
+//          Copyright (c) 2016, Scientific Toolworks, Inc.
+//
+// This software is licensed under the MIT License. The LICENSE.md file
+// describes the conditions under which this software may be distributed.
+//
+// Author: Jason Haslam
+//
+
+#include "Test.h"
+#include "git/Blob.h"
+#include "git/Commit.h"
+#include "git/Index.h"
+#include "git/Tree.h"
+#include "ui/TreeModel.h"
+
+using namespace Test;
+
+namespace {
+
+const int kFileCount = 1000;
+
+} // anon. namespace
+
+class TestTreeModel : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void rows();
+  void status();
+
+private:
+  void write(const QString &name, const QByteArray &content);
+
+  ScratchRepository mRepo;
+};
+
+void TestTreeModel::write(const QString &name, const QByteArray &content)
+{
+  QFile file(mRepo->workdir().filePath(name));
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write(content);
+}
+
+void TestTreeModel::initTestCase()
+{
+  QStringList paths;
+  QVERIFY(mRepo->workdir().mkpath("dir/sub"));
+  for (int i = 0; i < kFileCount; ++i) {
+    QString path = QString("dir/file%1.txt").arg(i, 4, 10, QChar('0'));
+    write(path, QByteArray::number(i) + '\n');
+    paths.append(path);
+  }
+
+  write("dir/sub/a.txt", "a\n");
+  paths.append("dir/sub/a.txt");
+
+  mRepo->index().setStaged(paths, true);
+  QVERIFY(mRepo->commit("initial").isValid());
+}
+
+void TestTreeModel::rows()
+{
+  TreeModel model(mRepo);
+  model.setTree(mRepo->head().target().tree());
+  QCOMPARE(model.rowCount(), 1);
+
+  QModelIndex dir = model.index(0, 0);
+  QCOMPARE(dir.data().toString(), QString("dir"));
+  QVERIFY(model.hasChildren(dir));
+  QCOMPARE(model.rowCount(dir), kFileCount + 1);
+
+  // Rows are found from the end without visiting the rest.
+  QModelIndex sub = model.index(kFileCount, 0, dir);
+  QCOMPARE(sub.data().toString(), QString("sub"));
+  QCOMPARE(model.parent(sub), dir);
+
+  QModelIndex file = model.index(0, 0, sub);
+  QCOMPARE(file.data(Qt::EditRole).toString(), QString("dir/sub/a.txt"));
+  QCOMPARE(model.parent(file), sub);
+  QVERIFY(!model.hasChildren(file));
+  QVERIFY(file.data(TreeModel::BlobRole).value<git::Blob>().isValid());
+}
+
+void TestTreeModel::status()
+{
+  write("dir/sub/a.txt", "b\n");
+
+  TreeModel model(mRepo);
+  git::Diff diff = mRepo->status(mRepo->index(), nullptr);
+  model.setTree(mRepo->head().target().tree(), diff);
+
+  QModelIndex dir = model.index(0, 0);
+  QModelIndex sub = model.index(kFileCount, 0, dir);
+  QModelIndex file = model.index(0, 0, sub);
+  QCOMPARE(dir.data(TreeModel::StatusRole).toString(), QString("M"));
+  QCOMPARE(file.data(TreeModel::StatusRole).toString(), QString("M"));
+  QCOMPARE(model.index(0, 0, dir).data(TreeModel::StatusRole).toString(),
+           QString());
+
+  // Staging the directory stages the file beneath it.
+  QCOMPARE(dir.data(Qt::CheckStateRole).toInt(), int(Qt::Unchecked));
+  QVERIFY(model.setData(dir, Qt::Checked, Qt::CheckStateRole));
+  QCOMPARE(file.data(Qt::CheckStateRole).toInt(), int(Qt::Checked));
+}
+
+TEST_MAIN(TestTreeModel)
+
+#include "tree_model.moc"